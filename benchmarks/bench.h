@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+namespace bench {
+
+// Written with results the compiler would otherwise be free to discard
+inline volatile size_t sink;
+
+// Shortest of runs wall times of f, in seconds. The shortest run is the one least
+// disturbed by other processes.
+template <typename F>
+double best_time(int runs, F&& f) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace bench
+
+#endif // BENCH_H
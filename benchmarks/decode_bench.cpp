@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <vector>
+
+#include "bench.h"
+#include "common/compat.h"
+#include "common/image_decoder.h"
+#include "common/u8tils.h"
+#include "common/vfs.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int RUNS = 5;
+
+// A large and a small image of each format the faster backends handle
+const char* const DEFAULT_IMAGES[] = {
+    "textures/earth_sphere10k.jpg",
+    "textures/container.jpg",
+    "textures/uv_checker_map_4k.png",
+    "textures/container2.png",
+};
+
+// Decodes path to RGBA, as textures are loaded, with every decoder that accepts it.
+// Throughput is given in compressed bytes read and in decoded bytes written.
+void bench_image(const fs::path& path) {
+    FileData file = vfs::read_copy(path);
+    for (auto& decoder : image_decoders()) {
+        DecodeOpts opts{.channels = 4};
+        std::optional<DecodedImage> image = decoder->decode(file.bytes(), opts);
+        if (!image)
+            continue;
+        double seconds = bench::best_time(RUNS, [&] {
+            bench::sink = decoder->decode(file.bytes(), opts)->pixels.size();
+        });
+        double in_mb = double(file.size()) * 1e-6;
+        double out_mb = double(image->pixels.size()) * 1e-6;
+        std::println("{:<32} {:<14} {:>5}x{:<5} {:>9.2f} {:>9.1f} {:>9.1f}",
+                     u8::path_to_string(path.filename()), decoder->name(), image->width,
+                     image->height, seconds * 1e3, in_mb / seconds, out_mb / seconds);
+    }
+}
+
+void run(const std::vector<fs::path>& args) {
+    std::vector<fs::path> images = args;
+    if (images.empty()) {
+        for (const char* image : DEFAULT_IMAGES)
+            images.push_back(fs::path(RESOURCES_DIR) / image);
+    }
+    std::println("best of {} runs, decoding to RGBA", RUNS);
+    std::println("{:<32} {:<14} {:>11} {:>9} {:>9} {:>9}", "image", "decoder", "size", "ms",
+                 "in MB/s", "out MB/s");
+    for (auto& image : images)
+        bench_image(image);
+}
+
+} // namespace
+
+int LGL_TMAIN(int argc, LGL_TCHAR* argv[]) {
+    try {
+        run(std::vector<fs::path>(argv + std::min(argc, 1), argv + argc));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cmath>
+#include <exception>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <print>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "bench.h"
+#include "common/primitives.h"
+#include "common/thread_pool.h"
+
+namespace {
+
+const int RUNS = 5;
+
+// make_sphere as it was before the writers: per-vertex trig, push_back into vectors,
+// and no tangents. Kept to measure against.
+void vector_sphere(int nlat, int nlon, std::vector<Vertex>& vertices,
+                   std::vector<unsigned int>& indices) {
+    vertices = {};
+    vertices.reserve((nlat + 1) * (nlon + 1));
+    for (int i = 0; i <= nlat; i++) {
+        for (int j = 0; j <= nlon; j++) {
+            float theta = float(j % nlon) / nlon * glm::two_pi<float>();
+            float phi = float(i) / nlat * glm::pi<float>();
+            float x = glm::cos(theta) * glm::sin(phi);
+            float y = -glm::cos(phi);
+            float z = -glm::sin(theta) * glm::sin(phi);
+            float u = float(j) / nlon;
+            float v = float(i) / nlat;
+            vertices.push_back(
+                Vertex{.position = {x, y, z}, .normal = {x, y, z}, .tex_coords = {u, v}});
+        }
+    }
+    indices = {};
+    indices.reserve(6 * nlat * nlon);
+    unsigned int rowlen = nlon + 1;
+    for (unsigned int i = 0; i < unsigned(nlat); i++) {
+        for (unsigned int j = 0; j < unsigned(nlon); j++) {
+            indices.push_back(rowlen * (i + 0) + (j + 0));
+            indices.push_back(rowlen * (i + 0) + (j + 1));
+            indices.push_back(rowlen * (i + 1) + (j + 1));
+            indices.push_back(rowlen * (i + 1) + (j + 1));
+            indices.push_back(rowlen * (i + 1) + (j + 0));
+            indices.push_back(rowlen * (i + 0) + (j + 0));
+        }
+    }
+}
+
+void report(std::string_view name, size_t num_vertices, double seconds) {
+    std::println("{:<28} {:>9} {:>9.2f} {:>10.1f}", name, num_vertices, seconds * 1e3,
+                 double(num_vertices) / seconds * 1e-6);
+}
+
+using Writer = std::function<void(std::span<Vertex>, std::span<unsigned int>, ThreadPool*)>;
+
+// Times a writer into preallocated storage, standing in for a mapped buffer, on the
+// calling thread and then on the pool
+void bench_writer(std::string_view name, MeshSize size, ThreadPool& pool,
+                  const Writer& write) {
+    std::vector<Vertex> vertices(size.vertices);
+    std::vector<unsigned int> indices(size.indices);
+    for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        double seconds = bench::best_time(RUNS, [&] { write(vertices, indices, p); });
+        bench::sink = indices.back() + size_t(vertices.back().position.x);
+        report(std::format("{} ({})", name, p ? "pool" : "serial"), size.vertices, seconds);
+    }
+}
+
+void run() {
+    ThreadPool pool;
+    std::println("{} pool threads, best of {} runs", pool.size(), RUNS);
+    std::println("{:<28} {:>9} {:>9} {:>10}", "mesh", "vertices", "ms", "Mvert/s");
+
+    const int NLAT = 1000, NLON = 1000;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    double seconds =
+        bench::best_time(RUNS, [&] { vector_sphere(NLAT, NLON, vertices, indices); });
+    bench::sink = indices.back() + size_t(vertices.back().position.x);
+    report("sphere (vector)", vertices.size(), seconds);
+
+    bench_writer("sphere", sphere_size(NLAT, NLON), pool, [&](auto v, auto i, auto p) {
+        write_sphere(NLAT, NLON, v, i, p);
+    });
+    bench_writer("icosphere", icosphere_size(320), pool, [](auto v, auto i, auto p) {
+        write_icosphere(320, v, i, p);
+    });
+    bench_writer("cylinder", cylinder_size(1000, 1000), pool, [](auto v, auto i, auto p) {
+        write_cylinder(1000, 1000, v, i, p);
+    });
+    bench_writer("torus", torus_size(1000, 1000), pool, [](auto v, auto i, auto p) {
+        write_torus(1.f, 0.25f, 1000, 1000, v, i, p);
+    });
+
+    const int SIDE = 1024;
+    std::vector<float> heights(size_t(SIDE) * SIDE);
+    for (size_t k = 0; k < heights.size(); k++)
+        heights[k] = std::sin(float(k % SIDE) * 0.05f) * std::cos(float(k / SIDE) * 0.05f);
+    bench_writer("heightfield", heightfield_size(SIDE, SIDE), pool,
+                 [&](auto v, auto i, auto p) {
+                     write_heightfield(heights, SIDE, SIDE, {1, 0.1f, 1}, v, i, p);
+                 });
+}
+
+} // namespace
+
+int main() {
+    try {
+        run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
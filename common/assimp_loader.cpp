@@ -1,8 +1,15 @@
 #include "assimp_loader.h"
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
 
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/material.h>
 #include <assimp/postprocess.h>
@@ -10,22 +17,80 @@
 
 #include "errutils.h"
 #include "mesh.h"
+#include "mipmap.h"
 #include "model.h"
+#include "tangents.h"
+#include "texture.h"
 #include "u8tils.h"
+#include "vfs.h"
 
 namespace fs = std::filesystem;
 
 namespace {
 
+// Assimp stream reading from a file in memory
+class MemoryStream : public Assimp::IOStream {
+  public:
+    explicit MemoryStream(FileData file) : file_(std::move(file)) {}
+
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if (size == 0)
+            return 0;
+        count = std::min(count, (file_.size() - pos_) / size);
+        std::memcpy(buffer, file_.data() + pos_, size * count);
+        pos_ += size * count;
+        return count;
+    }
+    size_t Write(const void*, size_t, size_t) override { return 0; }
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t base = origin == aiOrigin_SET   ? 0
+                      : origin == aiOrigin_CUR ? pos_
+                                               : file_.size();
+        if (offset > file_.size() - base)
+            return aiReturn_FAILURE;
+        pos_ = base + offset;
+        return aiReturn_SUCCESS;
+    }
+    size_t Tell() const override { return pos_; }
+    size_t FileSize() const override { return file_.size(); }
+    void Flush() override {}
+
+  private:
+    FileData file_;
+    size_t pos_ = 0;
+};
+
+// Opens the model and the files it references (buffers, material libraries) through
+// the vfs instead of stdio
+class VfsIOSystem : public Assimp::IOSystem {
+  public:
+    bool Exists(const char* file) const override { return vfs::exists(u8::to_path(file)); }
+    char getOsSeparator() const override { return char(fs::path::preferred_separator); }
+    Assimp::IOStream* Open(const char* file, const char* mode) override {
+        // Read-only
+        if (std::string_view(mode).find_first_of("wa+") != std::string_view::npos)
+            return nullptr;
+        try {
+            return new MemoryStream(vfs::read(u8::to_path(file)));
+        } catch (const std::exception&) {
+            // Assimp reports missing files itself
+            return nullptr;
+        }
+    }
+    void Close(Assimp::IOStream* file) override { delete file; }
+};
+
 class ModelLoader {
   public:
-    ModelLoader() {}
+    explicit ModelLoader(ThreadPool* pool) : pool_(pool) {}
 
     Model load(const fs::path& path, unsigned int flags) {
         materials_.clear();
         meshes_.clear();
 
         Assimp::Importer importer;
+        // The importer takes ownership
+        importer.SetIOHandler(new VfsIOSystem);
         flags |= aiProcess_PreTransformVertices;
         const aiScene* scene = importer.ReadFile(u8::path_to_char(path), flags);
         err::check(scene && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE),
@@ -54,16 +119,63 @@ class ModelLoader {
         }
     }
 
-    static Texture get_texture(aiMaterial* mat, const fs::path& directory,
-                               aiTextureType type, unsigned int index = 0) {
+    static std::optional<fs::path> get_texture_path(aiMaterial* mat,
+                                                    const fs::path& directory,
+                                                    aiTextureType type,
+                                                    unsigned int index = 0) {
         aiString ai_path;
         if (mat->GetTexture(type, index, &ai_path) != AI_SUCCESS)
-            return Texture();
+            return std::nullopt;
         fs::path path = directory / u8::to_path(ai_path.C_Str());
         // Assume relative filename if wrong path is hard-coded
-        if (!fs::exists(path))
+        if (!vfs::exists(path))
             path = directory / path.filename();
-        return Texture(path);
+        return path;
+    }
+
+    static Texture get_texture(aiMaterial* mat, const fs::path& directory,
+                               aiTextureType type, const TextureOpts& opts = {}) {
+        auto path = get_texture_path(mat, directory, type);
+        return path ? Texture(*path, opts) : Texture();
+    }
+
+    // Packs glTF occlusion (R) and metallic-roughness (G, B) into one texture, so the
+    // shader samples them together. Missing channels are left at 1.
+    Texture pack_orm(const std::optional<fs::path>& occlusion_path,
+                     const std::optional<fs::path>& metal_rough_path) const {
+        // Exporters often write both into one image already
+        if (occlusion_path && occlusion_path == metal_rough_path)
+            return Texture(*occlusion_path, {.pool = pool_});
+        TextureOpts opts{.channels = 3, .gen_mipmaps = false};
+        TextureData occlusion{}, metal_rough{};
+        if (occlusion_path)
+            occlusion = load_texture_data(*occlusion_path, opts);
+        if (metal_rough_path)
+            metal_rough = load_texture_data(*metal_rough_path, opts);
+
+        TextureData orm{std::max(occlusion.width, metal_rough.width),
+                        std::max(occlusion.height, metal_rough.height), 3, false, {}, {}};
+        orm.pixels.assign(size_t(orm.width) * orm.height * 3, 255);
+        // Nearest sample of src, a channel of which is copied into each texel
+        auto copy_channels = [&](const TextureData& src, int first, int last) {
+            for (int y = 0; y < orm.height; y++) {
+                size_t src_y = size_t(y) * src.height / orm.height;
+                for (int x = 0; x < orm.width; x++) {
+                    size_t src_x = size_t(x) * src.width / orm.width;
+                    const uint8_t* in = &src.pixels[(src_y * src.width + src_x) * 3];
+                    uint8_t* out = &orm.pixels[(size_t(y) * orm.width + x) * 3];
+                    for (int c = first; c <= last; c++)
+                        out[c] = in[c];
+                }
+            }
+        };
+        if (occlusion_path)
+            copy_channels(occlusion, 0, 0);
+        if (metal_rough_path)
+            copy_channels(metal_rough, 1, 2);
+        orm.mips = generate_mips(orm.pixels, orm.width, orm.height, 3, false, pool_);
+        // No filename: the packed image isn't a file the atlas could load
+        return Texture(upload_texture(orm));
     }
 
     std::shared_ptr<Material> convert_material(aiMaterial* mat,
@@ -81,12 +193,37 @@ class ModelLoader {
         get_color(mat, AI_MATKEY_COLOR_AMBIENT, res->ambient_color);
         get_color(mat, AI_MATKEY_COLOR_EMISSIVE, res->emissive_color);
 
-        res->diffuse_texture = get_texture(mat, directory, aiTextureType_DIFFUSE);
-        res->specular_texture = get_texture(mat, directory, aiTextureType_SPECULAR);
-        res->ambient_texture = get_texture(mat, directory, aiTextureType_AMBIENT);
-        res->emissive_texture = get_texture(mat, directory, aiTextureType_EMISSIVE);
-        res->ao_texture = get_texture(mat, directory, aiTextureType_LIGHTMAP);
-        res->normal_texture = get_texture(mat, directory, aiTextureType_NORMALS);
+        // glTF metallic-roughness
+        res->pbr = mat->Get(AI_MATKEY_METALLIC_FACTOR, res->metallic) == AI_SUCCESS;
+        if (res->pbr) {
+            mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, res->roughness);
+            aiColor4D base_color;
+            if (mat->Get(AI_MATKEY_BASE_COLOR, base_color) == AI_SUCCESS)
+                res->diffuse_color = {base_color.r, base_color.g, base_color.b};
+        }
+
+        // Color textures are sRGB in glTF. The importer lists the base color as diffuse.
+        TextureOpts opts{.pool = pool_}, color_opts{.srgb = res->pbr, .pool = pool_};
+        res->diffuse_texture = get_texture(mat, directory, aiTextureType_DIFFUSE, color_opts);
+        res->specular_texture = get_texture(mat, directory, aiTextureType_SPECULAR, opts);
+        res->ambient_texture = get_texture(mat, directory, aiTextureType_AMBIENT, opts);
+        res->emissive_texture =
+            get_texture(mat, directory, aiTextureType_EMISSIVE, color_opts);
+        res->normal_texture = get_texture(mat, directory, aiTextureType_NORMALS, opts);
+
+        auto occlusion_path = get_texture_path(mat, directory, aiTextureType_LIGHTMAP);
+        std::optional<fs::path> metal_rough_path;
+        if (res->pbr) {
+            // Older importers list the metallic-roughness texture as unknown
+            metal_rough_path = get_texture_path(mat, directory, aiTextureType_METALNESS);
+            if (!metal_rough_path)
+                metal_rough_path = get_texture_path(mat, directory, aiTextureType_UNKNOWN);
+        }
+        if (res->pbr && (occlusion_path || metal_rough_path))
+            res->orm_texture = pack_orm(occlusion_path, metal_rough_path);
+        else if (occlusion_path)
+            res->ao_texture = Texture(*occlusion_path, opts);
+        res->update_features();
         return res;
     }
 
@@ -102,6 +239,16 @@ class ModelLoader {
                 aiVector3D& tc = mesh->mTextureCoords[0][i];
                 vertex.tex_coords = {tc.x, tc.y};
             }
+            if (mesh->HasTangentsAndBitangents()) {
+                aiVector3D& t = mesh->mTangents[i];
+                aiVector3D& b = mesh->mBitangents[i];
+                glm::vec3 tangent(t.x, t.y, t.z);
+                // Re-orthogonalized, since smoothing bends normals away from tangents
+                tangent -= vertex.normal * glm::dot(vertex.normal, tangent);
+                float sign = glm::dot(glm::cross(vertex.normal, tangent),
+                                      glm::vec3(b.x, b.y, b.z)) < 0 ? -1.f : 1.f;
+                vertex.tangent = pack_tangent(tangent, sign);
+            }
             vertices.push_back(vertex);
         }
 
@@ -113,6 +260,12 @@ class ModelLoader {
             }
         }
 
+        // Assimp leaves tangents out without texture coordinates; generated ones fall
+        // back to any direction in the normal's plane
+        if (!mesh->HasTangentsAndBitangents() &&
+            mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+            generate_tangents(vertices, indices, pool_);
+
         std::string_view name = mesh->mName.C_Str();
         auto material = materials_[mesh->mMaterialIndex];
         return std::make_shared<Mesh>(name, vertices, indices, std::move(material));
@@ -120,10 +273,11 @@ class ModelLoader {
 
     std::vector<std::shared_ptr<Material>> materials_;
     std::vector<std::shared_ptr<Mesh>> meshes_;
+    ThreadPool* pool_;
 };
 
 } // namespace
 
-Model load_model(const fs::path& path, unsigned int flags) {
-    return ModelLoader().load(path, flags);
+Model load_model(const fs::path& path, unsigned int flags, ThreadPool* pool) {
+    return ModelLoader(pool).load(path, flags);
 }
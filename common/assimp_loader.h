@@ -4,11 +4,15 @@
 #include <assimp/postprocess.h>
 
 #include "model.h"
+#include "thread_pool.h"
 
 inline constexpr int DEFAULT_FLAGS =
-    aiProcess_GenNormals | aiProcess_JoinIdenticalVertices | aiProcess_Triangulate |
-    aiProcess_PreTransformVertices;
+    aiProcess_GenNormals | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices |
+    aiProcess_Triangulate | aiProcess_PreTransformVertices;
 
-Model load_model(const std::filesystem::path& path, unsigned int flags = DEFAULT_FLAGS);
+// Textures are decoded and mipmapped, and missing tangents generated, on the pool if
+// there is one
+Model load_model(const std::filesystem::path& path, unsigned int flags = DEFAULT_FLAGS,
+                 ThreadPool* pool = nullptr);
 
 #endif // ASSIMP_LOADER_H
@@ -0,0 +1,193 @@
+#include "async_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "errutils.h"
+
+#ifdef HAS_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Queue depth of the ring; more reads wait for free submission slots
+constexpr unsigned RING_ENTRIES = 64;
+// Largest single read, below the kernel's limit of just under 2 GiB
+constexpr size_t MAX_READ = 1 << 30;
+
+} // namespace
+
+struct AsyncReader::Request {
+    uint64_t offset;
+    std::vector<std::byte> data;
+    // Bytes read so far; reads may come back short
+    size_t done = 0;
+    Callback callback;
+};
+
+#ifdef HAS_LIBURING
+
+struct AsyncReader::Ring {
+    io_uring ring;
+    int fd;
+
+    explicit Ring(const fs::path& path) {
+        fd = err::check_posix(open(path.c_str(), O_RDONLY | O_CLOEXEC),
+                              "failed to open file {}: {}", path.string());
+        if (int res = io_uring_queue_init(RING_ENTRIES, &ring, 0); res < 0) {
+            close(fd);
+            err::error("io_uring_queue_init failed: {}",
+                       std::generic_category().message(-res));
+        }
+    }
+    ~Ring() {
+        io_uring_queue_exit(&ring);
+        close(fd);
+    }
+};
+
+#else
+
+struct AsyncReader::Ring {};
+
+#endif
+
+AsyncReader::AsyncReader(const fs::path& path, ThreadPool& pool) : path_(path), pool_(pool) {
+#ifdef HAS_LIBURING
+    // Kernels without io_uring, or sandboxes that block it, get the fallback
+    try {
+        ring_ = std::make_unique<Ring>(path);
+        completion_thread_ = std::thread([this] { complete_loop(); });
+        return;
+    } catch (const std::exception&) {
+        ring_.reset();
+    }
+#endif
+    file_ = MappedFile(path, MappedFile::Access::Random);
+}
+
+AsyncReader::~AsyncReader() {
+    {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [&] { return in_flight_ == 0; });
+    }
+#ifdef HAS_LIBURING
+    if (ring_) {
+        // A no-op without a request tells the completion thread to exit
+        {
+            std::lock_guard lock(submit_mutex_);
+            io_uring_sqe* sqe;
+            while (!(sqe = io_uring_get_sqe(&ring_->ring)))
+                io_uring_submit(&ring_->ring);
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_data(sqe, nullptr);
+            io_uring_submit(&ring_->ring);
+        }
+        completion_thread_.join();
+    }
+#endif
+}
+
+void AsyncReader::read(uint64_t offset, size_t size, Callback callback) {
+    {
+        std::lock_guard lock(mutex_);
+        ++in_flight_;
+    }
+    auto* request = new Request{offset, std::vector<std::byte>(size), 0, std::move(callback)};
+    if (size == 0) {
+        finish(request, nullptr);
+    } else if (ring_) {
+        submit(request);
+    } else {
+        pool_.submit([this, request] {
+            std::exception_ptr error;
+            try {
+                auto bytes = file_.bytes(request->offset, request->data.size());
+                std::memcpy(request->data.data(), bytes.data(), bytes.size());
+            } catch (...) {
+                error = std::current_exception();
+            }
+            finish(request, error);
+        });
+    }
+}
+
+std::future<std::vector<std::byte>> AsyncReader::read(uint64_t offset, size_t size) {
+    auto promise = std::make_shared<std::promise<std::vector<std::byte>>>();
+    auto future = promise->get_future();
+    read(offset, size, [promise](std::vector<std::byte> data, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(std::move(data));
+    });
+    return future;
+}
+
+void AsyncReader::submit([[maybe_unused]] Request* request) {
+#ifdef HAS_LIBURING
+    std::lock_guard lock(submit_mutex_);
+    io_uring_sqe* sqe;
+    // When the queue is full, handing it to the kernel frees its slots
+    while (!(sqe = io_uring_get_sqe(&ring_->ring)))
+        io_uring_submit(&ring_->ring);
+    size_t remaining = std::min(request->data.size() - request->done, MAX_READ);
+    io_uring_prep_read(sqe, ring_->fd, request->data.data() + request->done,
+                       unsigned(remaining), request->offset + request->done);
+    io_uring_sqe_set_data(sqe, request);
+    io_uring_submit(&ring_->ring);
+#endif
+}
+
+void AsyncReader::complete_loop() {
+#ifdef HAS_LIBURING
+    for (;;) {
+        io_uring_cqe* cqe;
+        int res = io_uring_wait_cqe(&ring_->ring, &cqe);
+        if (res == -EINTR)
+            continue;
+        if (res < 0)
+            err::error("io_uring_wait_cqe failed: {}", std::generic_category().message(-res));
+        auto* request = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+        int result = cqe->res;
+        io_uring_cqe_seen(&ring_->ring, cqe);
+        if (!request)
+            return;
+
+        if (result <= 0) {
+            std::string reason = result < 0 ? std::generic_category().message(-result)
+                                            : std::string("unexpected end of file");
+            auto error = std::runtime_error(
+                std::format("failed to read {}: {}", path_.string(), reason));
+            finish(request, std::make_exception_ptr(error));
+            continue;
+        }
+        request->done += size_t(result);
+        if (request->done < request->data.size())
+            submit(request);
+        else
+            finish(request, nullptr);
+    }
+#endif
+}
+
+void AsyncReader::finish(Request* request, std::exception_ptr error) {
+    std::unique_ptr<Request> owned(request);
+    if (error)
+        owned->data.clear();
+    owned->callback(std::move(owned->data), error);
+    owned.reset();
+
+    std::lock_guard lock(mutex_);
+    if (--in_flight_ == 0)
+        idle_.notify_all();
+}
@@ -0,0 +1,64 @@
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+// Asynchronous reads of ranges of one file. Built with liburing on Linux, reads are
+// queued on an io_uring and a completion thread hands them back, so no thread blocks
+// on the disk. Elsewhere, or when the kernel refuses a ring, reads are copies out of a
+// mapping on the thread pool.
+class AsyncReader {
+  public:
+    // Called with the bytes read, or with error set and no bytes
+    using Callback =
+        std::function<void(std::vector<std::byte> data, std::exception_ptr error)>;
+
+    AsyncReader(const std::filesystem::path& path, ThreadPool& pool);
+    // Waits for reads in flight
+    ~AsyncReader();
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Reads size bytes at offset. callback runs on the completion thread or the pool,
+    // so it should be short or hand its work to the pool, and must not throw.
+    void read(uint64_t offset, size_t size, Callback callback);
+    std::future<std::vector<std::byte>> read(uint64_t offset, size_t size);
+
+    bool uses_io_uring() const { return ring_ != nullptr; }
+
+  private:
+    struct Ring;
+    struct Request;
+
+    void submit(Request* request);
+    void complete_loop();
+    void finish(Request* request, std::exception_ptr error);
+
+    std::filesystem::path path_;
+    ThreadPool& pool_;
+    // Fallback when there's no ring
+    MappedFile file_;
+
+    std::unique_ptr<Ring> ring_;
+    std::mutex submit_mutex_;
+    std::thread completion_thread_;
+
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    size_t in_flight_ = 0;
+};
+
+#endif // ASYNC_READER_H
@@ -0,0 +1,51 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <limits>
+#include <span>
+
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box. Default constructed boxes are empty (min > max).
+struct Bounds {
+    glm::vec3 min{std::numeric_limits<float>::infinity()};
+    glm::vec3 max{-std::numeric_limits<float>::infinity()};
+
+    bool empty() const { return min.x > max.x; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    void expand(glm::vec3 p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void expand(const Bounds& b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    // Bounds of this box after an affine transform
+    Bounds transform(const glm::mat4& m) const {
+        glm::vec3 c = m * glm::vec4(center(), 1);
+        glm::vec3 ext = extents();
+        glm::vec3 e = glm::abs(glm::vec3(m[0])) * ext.x + glm::abs(glm::vec3(m[1])) * ext.y +
+                      glm::abs(glm::vec3(m[2])) * ext.z;
+        return {c - e, c + e};
+    }
+
+    // Whether the box may intersect the view frustum of a model-view-projection
+    // matrix. Conservative: only rejects boxes fully outside one clip plane.
+    bool intersects_frustum(const glm::mat4& model_view_projection) const {
+        glm::bvec3 all_below{true}, all_above{true};
+        for (int i = 0; i < 8; ++i) {
+            glm::vec4 clip = model_view_projection * glm::vec4(i & 1 ? max.x : min.x,
+                                                               i & 2 ? max.y : min.y,
+                                                               i & 4 ? max.z : min.z, 1);
+            all_below = all_below && glm::lessThan(glm::vec3(clip), glm::vec3(-clip.w));
+            all_above = all_above && glm::greaterThan(glm::vec3(clip), glm::vec3(clip.w));
+        }
+        return !glm::any(all_below) && !glm::any(all_above);
+    }
+};
+
+#endif // BOUNDS_H
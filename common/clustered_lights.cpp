@@ -0,0 +1,246 @@
+#include "clustered_lights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+
+template <typename T>
+void upload(GLuint buffer, std::span<const T> data) {
+    // Keep buffers non-empty so they can always be bound
+    glNamedBufferData(buffer, std::max<GLsizeiptr>(data.size_bytes(), sizeof(T)), nullptr,
+                      GL_DYNAMIC_DRAW);
+    glNamedBufferSubData(buffer, 0, data.size_bytes(), data.data());
+}
+
+// Lights overlapping one depth slice, in structure-of-arrays form so the sphere/box
+// tests below vectorize
+struct SliceLights {
+    std::vector<uint32_t> index;
+    std::vector<float> x, y, z, r2;
+    std::vector<uint8_t> hit;
+
+    void clear() {
+        index.clear();
+        x.clear();
+        y.clear();
+        z.clear();
+        r2.clear();
+    }
+    void push(uint32_t i, glm::vec4 sphere) {
+        index.push_back(i);
+        x.push_back(sphere.x);
+        y.push_back(sphere.y);
+        z.push_back(sphere.z);
+        r2.push_back(sphere.w * sphere.w);
+    }
+};
+
+} // namespace
+
+ClusteredLights::ClusteredLights(ThreadPool& pool, glm::uvec3 dims,
+                                 unsigned int max_lights_per_cluster)
+    : pool_(pool), dims_(dims), max_lights_per_cluster_(max_lights_per_cluster) {
+    glCreateBuffers(1, &point_buffer_.reset_as_ref());
+    glCreateBuffers(1, &spot_buffer_.reset_as_ref());
+    glCreateBuffers(1, &cluster_buffer_.reset_as_ref());
+    glCreateBuffers(1, &index_buffer_.reset_as_ref());
+    clusters_.resize(num_clusters());
+}
+
+void ClusteredLights::set_lights(std::span<const PointLight> point_lights,
+                                 std::span<const SpotLight> spot_lights) {
+    spheres_.clear();
+    spheres_.reserve(point_lights.size() + spot_lights.size());
+
+    std::vector<PackedPointLight> points;
+    points.reserve(point_lights.size());
+    for (auto& light : point_lights) {
+        float range = light.range();
+        spheres_.emplace_back(light.position, range);
+        points.push_back({
+            .position = {light.position, range},
+            .attenuation = {light.constant, light.linear, light.quadratic, 0},
+            .ambient = glm::vec4(light.ambient, 0),
+            .diffuse = glm::vec4(light.diffuse, 0),
+            .specular = glm::vec4(light.specular, 0),
+        });
+    }
+    std::vector<PackedSpotLight> spots;
+    spots.reserve(spot_lights.size());
+    for (auto& light : spot_lights) {
+        float range = light.range();
+        spheres_.emplace_back(light.position, range);
+        spots.push_back({
+            .position = {light.position, range},
+            .direction = {light.direction, light.innerCutoff},
+            .attenuation = {light.constant, light.linear, light.quadratic,
+                            light.outerCutoff},
+            .ambient = glm::vec4(light.ambient, 0),
+            .diffuse = glm::vec4(light.diffuse, 0),
+            .specular = glm::vec4(light.specular, 0),
+        });
+    }
+    num_point_lights_ = unsigned(point_lights.size());
+    upload(*point_buffer_, std::span<const PackedPointLight>(points));
+    upload(*spot_buffer_, std::span<const PackedSpotLight>(spots));
+}
+
+float ClusteredLights::slice_depth(unsigned int slice) const {
+    return znear_ * std::pow(zfar_ / znear_, float(slice) / float(dims_.z));
+}
+
+void ClusteredLights::update_bounds(const glm::mat4& projection, float znear,
+                                    float zfar, glm::vec2 viewport) {
+    if (!bounds_.empty() && projection == bounds_projection_ &&
+        viewport == bounds_viewport_ && znear == znear_ && zfar == zfar_)
+        return;
+    bounds_projection_ = projection;
+    bounds_viewport_ = viewport;
+    znear_ = znear;
+    zfar_ = zfar;
+
+    // View-space ray directions through the tile corners, scaled to unit depth
+    glm::mat4 inv_projection = glm::inverse(projection);
+    auto corner_dir = [&](unsigned int x, unsigned int y) {
+        glm::vec2 ndc = glm::vec2(x, y) / glm::vec2(dims_) * 2.0f - 1.0f;
+        glm::vec4 p = inv_projection * glm::vec4(ndc, -1, 1);
+        glm::vec3 v = glm::vec3(p) / p.w;
+        return glm::vec2(v) / -v.z;
+    };
+
+    // Bounds are stored with z as positive view depth
+    bounds_.resize(num_clusters());
+    for (unsigned int z = 0; z < dims_.z; z++) {
+        float slice_near = slice_depth(z), slice_far = slice_depth(z + 1);
+        for (unsigned int y = 0; y < dims_.y; y++) {
+            for (unsigned int x = 0; x < dims_.x; x++) {
+                glm::vec2 dirs[] = {corner_dir(x, y), corner_dir(x + 1, y),
+                                    corner_dir(x, y + 1), corner_dir(x + 1, y + 1)};
+                ClusterBounds b{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+                for (glm::vec2 dir : dirs) {
+                    for (float depth : {slice_near, slice_far}) {
+                        glm::vec3 p(dir * depth, depth);
+                        b.min = glm::min(b.min, p);
+                        b.max = glm::max(b.max, p);
+                    }
+                }
+                bounds_[x + dims_.x * (y + dims_.y * z)] = b;
+            }
+        }
+    }
+}
+
+void ClusteredLights::assign(const glm::mat4& view, const glm::mat4& projection,
+                             float znear, float zfar, glm::vec2 viewport) {
+    update_bounds(projection, znear, zfar, viewport);
+
+    // View-space spheres with z flipped to positive depth
+    std::vector<glm::vec4> view_spheres(spheres_.size());
+    for (size_t i = 0; i < spheres_.size(); i++) {
+        glm::vec3 p = view * glm::vec4(glm::vec3(spheres_[i]), 1);
+        view_spheres[i] = {p.x, p.y, -p.z, spheres_[i].w};
+    }
+
+    // Each slice is assigned independently into its own index list, then the lists
+    // are concatenated
+    std::vector<std::vector<uint32_t>> slice_indices(dims_.z);
+    pool_.parallel_for(dims_.z, [&](size_t z) {
+        float slice_near = slice_depth(unsigned(z));
+        float slice_far = slice_depth(unsigned(z + 1));
+        SliceLights lights;
+        for (uint32_t i = 0; i < view_spheres.size(); i++) {
+            glm::vec4 s = view_spheres[i];
+            if (s.z + s.w > slice_near && s.z - s.w < slice_far)
+                lights.push(i, s);
+        }
+        size_t n = lights.index.size();
+        lights.hit.resize(n);
+
+        auto& out = slice_indices[z];
+        size_t cluster_begin = z * dims_.x * dims_.y;
+        for (size_t c = cluster_begin; c < cluster_begin + dims_.x * dims_.y; c++) {
+            const ClusterBounds& b = bounds_[c];
+            // Branch-free squared distance from each sphere center to the box, written
+            // as a separate pass from the compaction below so it vectorizes
+            auto dist = [](float lo, float hi, float v) {
+                return std::max(std::max(lo - v, v - hi), 0.0f);
+            };
+            for (size_t k = 0; k < n; k++) {
+                float dx = dist(b.min.x, b.max.x, lights.x[k]);
+                float dy = dist(b.min.y, b.max.y, lights.y[k]);
+                float dz = dist(b.min.z, b.max.z, lights.z[k]);
+                lights.hit[k] = dx * dx + dy * dy + dz * dz <= lights.r2[k];
+            }
+            uint32_t offset = uint32_t(out.size());
+            for (size_t k = 0; k < n; k++) {
+                if (lights.hit[k])
+                    out.push_back(lights.index[k]);
+            }
+            clusters_[c] = {offset, uint32_t(out.size()) - offset};
+        }
+    }, 1);
+
+    indices_.clear();
+    for (unsigned int z = 0; z < dims_.z; z++) {
+        uint32_t base = uint32_t(indices_.size());
+        size_t cluster_begin = z * dims_.x * dims_.y;
+        for (size_t c = cluster_begin; c < cluster_begin + dims_.x * dims_.y; c++) {
+            clusters_[c].x += base;
+        }
+        indices_.insert(indices_.end(), slice_indices[z].begin(), slice_indices[z].end());
+    }
+
+    upload(*cluster_buffer_, std::span<const glm::uvec2>(clusters_));
+    upload(*index_buffer_, std::span<const uint32_t>(indices_));
+}
+
+ShaderDefines ClusteredLights::compute_defines() const {
+    return {{"MAX_LIGHTS_PER_CLUSTER", std::to_string(max_lights_per_cluster_)}};
+}
+
+void ClusteredLights::assign_gpu(const Shader& compute, const glm::mat4& view,
+                                 const glm::mat4& projection, float znear, float zfar,
+                                 glm::vec2 viewport) {
+    // Each cluster gets a fixed-size slot of max_lights_per_cluster indices
+    size_t clusters_size = num_clusters() * sizeof(glm::uvec2);
+    size_t indices_size = num_clusters() * max_lights_per_cluster_ * sizeof(uint32_t);
+    glNamedBufferData(*cluster_buffer_, clusters_size, nullptr, GL_DYNAMIC_DRAW);
+    glNamedBufferData(*index_buffer_, indices_size, nullptr, GL_DYNAMIC_DRAW);
+
+    compute.use();
+    compute.set_mat4("view", view);
+    compute.set_mat4("inverseProjection", glm::inverse(projection));
+    compute.set_uvec3("clusterDims", dims_);
+    compute.set_float("zNear", znear);
+    compute.set_float("zFar", zfar);
+    compute.set_uint("numPointLights", num_point_lights_);
+    compute.set_uint("numSpotLights", unsigned(spheres_.size()) - num_point_lights_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, *point_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *spot_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, *cluster_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, *index_buffer_);
+    glDispatchCompute(GLuint((num_clusters() + 63) / 64), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    bounds_viewport_ = viewport;
+    znear_ = znear;
+    zfar_ = zfar;
+}
+
+void ClusteredLights::bind(const Shader& shader) const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, *point_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, *spot_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, *cluster_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, *index_buffer_);
+
+    float log_ratio = std::log(zfar_ / znear_);
+    shader.set_uvec3("clusterDims", dims_);
+    shader.set_vec2("clusterTileSize", bounds_viewport_ / glm::vec2(dims_));
+    shader.set_float("clusterZScale", float(dims_.z) / log_ratio);
+    shader.set_float("clusterZBias", -float(dims_.z) * std::log(znear_) / log_ratio);
+    shader.set_float("zNear", znear_);
+    shader.set_float("zFar", zfar_);
+    shader.set_uint("numClusterPointLights", num_point_lights_);
+}
@@ -0,0 +1,92 @@
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "lights.h"
+#include "mesh.h"
+#include "shader.h"
+#include "thread_pool.h"
+
+// Clustered forward shading. Point and spot lights are uploaded to SSBOs and assigned
+// to a 3D grid of view-space clusters (screen tiles x exponential depth slices), so
+// each fragment only loops over the lights overlapping its cluster. Shaders opt in
+// with the defines() below; see resources/shaders/clustered.glsl for the GPU side.
+//
+// SSBO bindings: 0 point lights, 1 spot lights, 2 cluster (offset, count) pairs,
+// 3 light index list. Spot light indices are offset by the number of point lights.
+class ClusteredLights {
+  public:
+    explicit ClusteredLights(ThreadPool& pool, glm::uvec3 dims = {16, 9, 24},
+                             unsigned int max_lights_per_cluster = 256);
+
+    // Uploads light data. Call whenever lights change, before assign().
+    void set_lights(std::span<const PointLight> point_lights,
+                    std::span<const SpotLight> spot_lights);
+
+    // Assigns lights to clusters on the CPU, one depth slice per pool task
+    void assign(const glm::mat4& view, const glm::mat4& projection, float znear,
+                float zfar, glm::vec2 viewport);
+    // Assigns lights to clusters with the compute shader built from
+    // resources/shaders/cluster_lights.comp and compute_defines()
+    void assign_gpu(const Shader& compute, const glm::mat4& view,
+                    const glm::mat4& projection, float znear, float zfar,
+                    glm::vec2 viewport);
+
+    // Binds the SSBOs and sets the cluster lookup uniforms on the active shader
+    void bind(const Shader& shader) const;
+
+    ShaderDefines defines() const { return {{"CLUSTERED_LIGHTING", "1"}}; }
+    ShaderDefines compute_defines() const;
+
+    size_t num_lights() const { return spheres_.size(); }
+    size_t num_clusters() const { return size_t(dims_.x) * dims_.y * dims_.z; }
+    // Total light indices written by the last CPU assign()
+    size_t num_light_indices() const { return indices_.size(); }
+
+  private:
+    // Layouts match the std430 structs in clustered.glsl
+    struct PackedPointLight {
+        glm::vec4 position;    // xyz: position, w: range
+        glm::vec4 attenuation; // constant, linear, quadratic
+        glm::vec4 ambient, diffuse, specular;
+    };
+    struct PackedSpotLight {
+        glm::vec4 position;    // xyz: position, w: range
+        glm::vec4 direction;   // xyz: direction, w: inner cutoff
+        glm::vec4 attenuation; // constant, linear, quadratic, outer cutoff
+        glm::vec4 ambient, diffuse, specular;
+    };
+    struct ClusterBounds {
+        glm::vec3 min, max;
+    };
+
+    void update_bounds(const glm::mat4& projection, float znear, float zfar,
+                       glm::vec2 viewport);
+    float slice_depth(unsigned int slice) const;
+
+    ThreadPool& pool_;
+    glm::uvec3 dims_;
+    unsigned int max_lights_per_cluster_;
+    BufferHandle point_buffer_, spot_buffer_, cluster_buffer_, index_buffer_;
+    unsigned int num_point_lights_ = 0;
+
+    // World-space bounding spheres of all lights, xyz: center, w: radius
+    std::vector<glm::vec4> spheres_;
+    // View-space cluster bounds, cached until the projection changes
+    std::vector<ClusterBounds> bounds_;
+    glm::mat4 bounds_projection_{0};
+    glm::vec2 bounds_viewport_{0};
+    float znear_ = 0, zfar_ = 0;
+
+    // (offset, count) per cluster, and the light index list they point into
+    std::vector<glm::uvec2> clusters_;
+    std::vector<uint32_t> indices_;
+};
+
+#endif // CLUSTERED_LIGHTS_H
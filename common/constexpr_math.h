@@ -0,0 +1,92 @@
+#ifndef CONSTEXPR_MATH_H
+#define CONSTEXPR_MATH_H
+
+#include <numbers>
+
+// Trigonometry and square roots usable in constant expressions, where <cmath> isn't
+// (portably) before C++26. Everything is evaluated in double and rounded once, so
+// float results are within an ulp of the correctly rounded value; see the checks at
+// the end. Slow at runtime: use <cmath> there.
+namespace cx {
+
+namespace detail {
+
+// pi/2 split into a head exact in double and the tail it leaves out, so reducing
+// moderate arguments doesn't lose bits
+inline constexpr double HALF_PI_HI = 1.5707963267948966;
+inline constexpr double HALF_PI_LO = 6.123233995736766e-17;
+
+// Taylor series on [-pi/4, pi/4], where the first omitted term is below 1e-19
+constexpr double sin_poly(double x) {
+    double x2 = x * x, term = x, sum = x;
+    for (int n = 2; n <= 18; n += 2) {
+        term *= -x2 / (n * (n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos_poly(double x) {
+    double x2 = x * x, term = 1, sum = 1;
+    for (int n = 1; n <= 17; n += 2) {
+        term *= -x2 / (n * (n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// x = k * pi/2 + r with |r| <= pi/4; returns k mod 4
+constexpr int reduce(double x, double& r) {
+    auto k = static_cast<long long>(x / HALF_PI_HI + (x < 0 ? -0.5 : 0.5));
+    r = (x - double(k) * HALF_PI_HI) - double(k) * HALF_PI_LO;
+    return int(k & 3);
+}
+
+} // namespace detail
+
+constexpr double sin(double x) {
+    double r = 0;
+    switch (detail::reduce(x, r)) {
+    case 0: return detail::sin_poly(r);
+    case 1: return detail::cos_poly(r);
+    case 2: return -detail::sin_poly(r);
+    default: return -detail::cos_poly(r);
+    }
+}
+
+constexpr double cos(double x) {
+    double r = 0;
+    switch (detail::reduce(x, r)) {
+    case 0: return detail::cos_poly(r);
+    case 1: return -detail::sin_poly(r);
+    case 2: return -detail::cos_poly(r);
+    default: return detail::sin_poly(r);
+    }
+}
+
+// Newton's method from an exponent-based first guess; x must be >= 0
+constexpr double sqrt(double x) {
+    if (x == 0 || x != x)
+        return x;
+    double guess = 1;
+    for (double y = x; y > 4; y /= 4) guess *= 2;
+    for (double y = x; y < 0.25; y *= 4) guess /= 2;
+    for (int i = 0; i < 8; i++) guess = 0.5 * (guess + x / guess);
+    return guess;
+}
+
+constexpr float sin(float x) { return float(sin(double(x))); }
+constexpr float cos(float x) { return float(cos(double(x))); }
+constexpr float sqrt(float x) { return float(sqrt(double(x))); }
+
+static_assert(float(sin(std::numbers::pi / 6)) == 0.5f);
+static_assert(cos(0.0) == 1 && sin(0.0) == 0);
+static_assert(float(cos(std::numbers::pi)) == -1.f && float(sin(std::numbers::pi / 2)) == 1.f);
+static_assert(float(cos(std::numbers::pi / 3)) == 0.5f);
+static_assert(float(sin(-std::numbers::pi / 4)) == -float(std::numbers::sqrt2 / 2));
+static_assert(float(sin(100.0)) == -0.506365657f);
+static_assert(float(sqrt(2.0)) == float(std::numbers::sqrt2) && sqrt(1e-6) == 1e-3);
+
+} // namespace cx
+
+#endif // CONSTEXPR_MATH_H
@@ -0,0 +1,174 @@
+#include "deferred.h"
+
+#include <array>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glutils.h"
+#include "primitives.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum GBufferUnit {
+    ALBEDO_AO_UNIT = 0,
+    NORMAL_UNIT = 1,
+    SPECULAR_UNIT = 2,
+    DEPTH_UNIT = 3,
+    ACCUMULATION_UNIT = 4,
+};
+
+Shader load_light_shader(const fs::path& dir, const char* type, bool volume) {
+    ShaderDefines defines{{type, "1"}};
+    if (volume)
+        defines.emplace_back("LIGHT_VOLUME", "1");
+    Shader shader = Shader::load(dir / "deferred_light.vs", dir / "deferred_light.fs", {},
+                                 defines);
+    shader.use();
+    shader.set_int("gAlbedoAO", ALBEDO_AO_UNIT);
+    shader.set_int("gNormal", NORMAL_UNIT);
+    shader.set_int("gSpecularShininess", SPECULAR_UNIT);
+    shader.set_int("gDepth", DEPTH_UNIT);
+    shader.set_int("accumulation", ACCUMULATION_UNIT);
+    return shader;
+}
+
+} // namespace
+
+DeferredRenderer::DeferredRenderer(const fs::path& shader_dir)
+    : geometry_shaders_(shader_dir / "shader.vs", shader_dir / "gbuffer.fs"),
+      dir_shader_(load_light_shader(shader_dir, "DIR_LIGHT", false)),
+      point_shader_(load_light_shader(shader_dir, "POINT_LIGHT", true)),
+      spot_shader_(load_light_shader(shader_dir, "SPOT_LIGHT", true)),
+      composite_shader_(load_light_shader(shader_dir, "COMPOSITE", false)),
+      light_volume_(make_sphere<8, 16>()) {
+    glCreateVertexArrays(1, &empty_vao_.reset_as_ref());
+    glCreateFramebuffers(1, &fbo_.reset_as_ref());
+}
+
+void DeferredRenderer::resize(GLsizei width, GLsizei height) {
+    if (width == width_ && height == height_)
+        return;
+    width_ = width;
+    height_ = height;
+    albedo_ao_ = make_render_texture(GL_RGBA8, width, height);
+    normal_ = make_render_texture(GL_RG16F, width, height);
+    specular_ = make_render_texture(GL_RGBA16F, width, height);
+    accumulation_ = make_render_texture(GL_RGBA16F, width, height);
+    depth_ = make_render_texture(GL_DEPTH_COMPONENT32F, width, height);
+
+    glNamedFramebufferTexture(*fbo_, GL_COLOR_ATTACHMENT0, *albedo_ao_, 0);
+    glNamedFramebufferTexture(*fbo_, GL_COLOR_ATTACHMENT1, *normal_, 0);
+    glNamedFramebufferTexture(*fbo_, GL_COLOR_ATTACHMENT2, *specular_, 0);
+    glNamedFramebufferTexture(*fbo_, GL_COLOR_ATTACHMENT3, *accumulation_, 0);
+    glNamedFramebufferTexture(*fbo_, GL_DEPTH_ATTACHMENT, *depth_, 0);
+    check_framebuffer(*fbo_);
+}
+
+void DeferredRenderer::set_light_uniforms(const Shader& shader, const glm::mat4& view,
+                                          const glm::mat4& projection,
+                                          glm::vec3 view_pos) const {
+    shader.use();
+    shader.set_mat4("view", view);
+    shader.set_mat4("projection", projection);
+    shader.set_mat4("inverseViewProjection", glm::inverse(projection * view));
+    shader.set_vec3("viewPos", view_pos);
+}
+
+void DeferredRenderer::render(const Model& model, const glm::mat4& model_matrix,
+                              const glm::mat4& view, const glm::mat4& projection,
+                              glm::vec3 view_pos, const SceneLights& lights) {
+    auto [x, y, width, height] = util::gl_get<GLint, 4>(GL_VIEWPORT);
+    auto target_fbo = util::gl_get<GLint>(GL_DRAW_FRAMEBUFFER_BINDING);
+    auto read_fbo = util::gl_get<GLint>(GL_READ_FRAMEBUFFER_BINDING);
+    resize(width, height);
+
+    // Geometry pass
+    constexpr std::array<GLenum, 4> all_buffers = {
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+        GL_COLOR_ATTACHMENT3};
+    glBindFramebuffer(GL_FRAMEBUFFER, *fbo_);
+    glViewport(0, 0, width, height);
+    glNamedFramebufferDrawBuffers(*fbo_, GLsizei(all_buffers.size()), all_buffers.data());
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::vec3 scene_ambient{0};
+    for (auto& light : lights.dir) scene_ambient += light.ambient;
+    for (auto& light : lights.point) scene_ambient += light.ambient;
+    for (auto& light : lights.spot) scene_ambient += light.ambient;
+    model.draw(geometry_shaders_, [&](const Shader& shader) {
+        shader.set_mat4("projection", projection);
+        shader.set_mat4("view", view);
+        shader.set_mat4("model", model_matrix);
+        shader.set_vec3("sceneAmbient", scene_ambient);
+    });
+
+    // Light accumulation: additive, reading the G-buffer and writing only to the
+    // accumulation target
+    glNamedFramebufferDrawBuffer(*fbo_, GL_COLOR_ATTACHMENT3);
+    glBindTextureUnit(ALBEDO_AO_UNIT, *albedo_ao_);
+    glBindTextureUnit(NORMAL_UNIT, *normal_);
+    glBindTextureUnit(SPECULAR_UNIT, *specular_);
+    glBindTextureUnit(DEPTH_UNIT, *depth_);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(*empty_vao_);
+    set_light_uniforms(dir_shader_, view, projection, view_pos);
+    for (auto& light : lights.dir) {
+        light.apply(dir_shader_, "light");
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // Volumes are drawn as back faces that are behind the stored depth, which works
+    // with the camera inside the volume. Depth clamping keeps volumes that cross the
+    // far plane from being clipped. Culling is the caller's to leave off, so it is
+    // turned on here and put back afterwards.
+    GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+    auto cull_mode = util::gl_get<GLint>(GL_CULL_FACE_MODE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    // The sphere mesh is inscribed in the unit sphere, so pad it to cover the range
+    constexpr float volume_scale = 1.1f;
+    auto draw_volume = [&](const Shader& shader, glm::vec3 position, float range) {
+        glm::mat4 volume_model = glm::translate(glm::mat4(1), position);
+        volume_model = glm::scale(volume_model, glm::vec3(range * volume_scale));
+        shader.set_mat4("model", volume_model);
+        light_volume_.draw();
+    };
+    set_light_uniforms(point_shader_, view, projection, view_pos);
+    for (auto& light : lights.point) {
+        light.apply(point_shader_, "light");
+        draw_volume(point_shader_, light.position, light.range());
+    }
+    set_light_uniforms(spot_shader_, view, projection, view_pos);
+    for (auto& light : lights.spot) {
+        light.apply(spot_shader_, "light");
+        draw_volume(spot_shader_, light.position, light.range());
+    }
+    glCullFace(GLenum(cull_mode));
+    if (!cull_face)
+        glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_CLAMP);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+
+    // Composite into the caller's framebuffer
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(target_fbo));
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(read_fbo));
+    glViewport(x, y, width, height);
+    glDisable(GL_DEPTH_TEST);
+    glBindTextureUnit(ACCUMULATION_UNIT, *accumulation_);
+    composite_shader_.use();
+    glBindVertexArray(*empty_vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+}
@@ -0,0 +1,67 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include <filesystem>
+#include <span>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "framebuffer.h"
+#include "lights.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "texture.h"
+
+enum class RenderPath {
+    Forward,
+    Deferred,
+};
+
+struct SceneLights {
+    std::span<const DirLight> dir;
+    std::span<const PointLight> point{};
+    std::span<const SpotLight> spot{};
+};
+
+// Deferred shading as an alternative to the forward shader. A geometry pass writes
+// surface attributes to a G-buffer:
+//   0: RGBA8   diffuse albedo, ambient occlusion
+//   1: RG16F   octahedral-packed normal
+//   2: RGBA16F specular color, shininess
+//   3: RGBA16F light accumulation, seeded with ambient and emissive terms
+//   depth: DEPTH32F, used to reconstruct positions
+// Directional lights are then applied with fullscreen passes and point/spot lights
+// with sphere volumes bounded by their range, so lighting cost scales with covered
+// pixels rather than scene depth complexity.
+class DeferredRenderer {
+  public:
+    // shader_dir must contain shader.vs, gbuffer.fs and deferred_light.vs/fs
+    explicit DeferredRenderer(const std::filesystem::path& shader_dir);
+
+    // Renders model into the bound draw framebuffer at the current viewport. Pixels not
+    // covered by geometry are left untouched.
+    void render(const Model& model, const glm::mat4& model_matrix, const glm::mat4& view,
+                const glm::mat4& projection, glm::vec3 view_pos,
+                const SceneLights& lights);
+
+    ShaderVariants& geometry_shaders() { return geometry_shaders_; }
+
+  private:
+    void resize(GLsizei width, GLsizei height);
+    void set_light_uniforms(const Shader& shader, const glm::mat4& view,
+                            const glm::mat4& projection, glm::vec3 view_pos) const;
+
+    ShaderVariants geometry_shaders_;
+    Shader dir_shader_, point_shader_, spot_shader_, composite_shader_;
+    Mesh light_volume_;
+    VaoHandle empty_vao_;
+
+    FramebufferHandle fbo_;
+    TextureHandle albedo_ao_, normal_, specular_, accumulation_, depth_;
+    GLsizei width_ = 0, height_ = 0;
+};
+
+#endif // DEFERRED_H
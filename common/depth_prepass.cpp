@@ -0,0 +1,60 @@
+#include "depth_prepass.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void set_matrices(const Shader& shader, const glm::mat4& model_matrix,
+                  const glm::mat4& view, const glm::mat4& projection) {
+    shader.use();
+    shader.set_mat4("model", model_matrix);
+    shader.set_mat4("view", view);
+    shader.set_mat4("projection", projection);
+}
+
+} // namespace
+
+DepthPrepass::DepthPrepass(const fs::path& shader_dir)
+    : depth_shader_(Shader::load(shader_dir / "depth.vs", shader_dir / "depth.fs")),
+      overdraw_shader_(Shader::load(shader_dir / "depth.vs", shader_dir / "overdraw.fs")) {}
+
+void DepthPrepass::begin(Model& model, const glm::mat4& model_matrix,
+                         const glm::mat4& view, const glm::mat4& projection) const {
+    model.sort_front_to_back(view * model_matrix);
+    begin(model_matrix, view, projection, [&] { model.draw_depth(); });
+}
+
+void DepthPrepass::begin(const glm::mat4& model_matrix, const glm::mat4& view,
+                         const glm::mat4& projection, util::function_ref<void()> draw) const {
+    set_matrices(depth_shader_, model_matrix, view, projection);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    draw();
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+}
+
+void DepthPrepass::end() const {
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+void DepthPrepass::draw_overdraw(const Model& model, const glm::mat4& model_matrix,
+                                 const glm::mat4& view, const glm::mat4& projection,
+                                 glm::vec3 step) const {
+    draw_overdraw(model_matrix, view, projection, [&] { model.draw_depth(); }, step);
+}
+
+void DepthPrepass::draw_overdraw(const glm::mat4& model_matrix, const glm::mat4& view,
+                                 const glm::mat4& projection,
+                                 util::function_ref<void()> draw, glm::vec3 step) const {
+    set_matrices(overdraw_shader_, model_matrix, view, projection);
+    overdraw_shader_.set_vec3("overdrawStep", step);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    draw();
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,47 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "shader.h"
+#include "utils.h"
+
+// Optional depth-only pre-pass. Depth is laid down front to back with a minimal
+// position-only shader, then the main pass runs with GL_EQUAL so the expensive
+// lighting shader runs at most once per pixel.
+class DepthPrepass {
+  public:
+    // shader_dir must contain depth.vs, depth.fs and overdraw.fs
+    explicit DepthPrepass(const std::filesystem::path& shader_dir);
+
+    // Sorts model front to back and fills the depth buffer with color writes off.
+    // Leaves GL_EQUAL depth testing with depth writes off for the main pass; call
+    // end() once it is drawn.
+    void begin(Model& model, const glm::mat4& model_matrix, const glm::mat4& view,
+               const glm::mat4& projection) const;
+    // Like begin(), but draw issues the depth draws, e.g. OcclusionCuller::draw, with
+    // the position-only program current and its matrices set. Nothing is sorted.
+    void begin(const glm::mat4& model_matrix, const glm::mat4& view,
+               const glm::mat4& projection, util::function_ref<void()> draw) const;
+    // Restores GL_LESS depth testing with depth writes on
+    void end() const;
+
+    // Draws the model additively with a constant color instead of shading it, so
+    // brightness shows how many times each pixel is shaded. Uses the current depth
+    // state, so call between begin() and end() to see the pre-pass savings.
+    void draw_overdraw(const Model& model, const glm::mat4& model_matrix,
+                       const glm::mat4& view, const glm::mat4& projection,
+                       glm::vec3 step = glm::vec3(0.1f)) const;
+    // Like draw_overdraw(), with draw issuing the draws as for begin()
+    void draw_overdraw(const glm::mat4& model_matrix, const glm::mat4& view,
+                       const glm::mat4& projection, util::function_ref<void()> draw,
+                       glm::vec3 step = glm::vec3(0.1f)) const;
+
+  private:
+    Shader depth_shader_, overdraw_shader_;
+};
+
+#endif // DEPTH_PREPASS_H
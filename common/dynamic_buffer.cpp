@@ -0,0 +1,54 @@
+#include "dynamic_buffer.h"
+
+#include <algorithm>
+
+#include "errutils.h"
+#include "glutils.h"
+
+DynamicBuffer::DynamicBuffer(GLenum target, size_t frame_size) : target_(target) {
+    GLenum alignment_name = target == GL_SHADER_STORAGE_BUFFER
+                                ? GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+                                : GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT;
+    alignment_ = size_t(util::gl_get<GLint>(alignment_name));
+    // Keep every region aligned so offsets within it only depend on offset_
+    frame_size_ = (frame_size + alignment_ - 1) / alignment_ * alignment_;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer_.reset_as_ref());
+    glNamedBufferStorage(*buffer_, frame_size_ * FRAMES, nullptr, flags);
+    mapped_ = static_cast<std::byte*>(
+        glMapNamedBufferRange(*buffer_, 0, frame_size_ * FRAMES, flags));
+    err::check(mapped_, "failed to map dynamic buffer");
+}
+
+void DynamicBuffer::begin_frame() {
+    frame_ = (frame_ + 1) % FRAMES;
+    offset_ = 0;
+    if (auto& fence = fences_[frame_]) {
+        GLenum status = glClientWaitSync(*fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            auto start = std::chrono::steady_clock::now();
+            do {
+                status = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+            ++stats_.stalls;
+            stats_.stall_time += std::chrono::steady_clock::now() - start;
+        }
+        err::check(status != GL_WAIT_FAILED, "dynamic buffer fence wait failed");
+        fence.reset();
+    }
+}
+
+void DynamicBuffer::end_frame() {
+    fences_[frame_].reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+DynamicBuffer::Allocation DynamicBuffer::allocate(size_t size) {
+    size_t offset = (offset_ + alignment_ - 1) / alignment_ * alignment_;
+    err::check(offset + size <= frame_size_,
+               "dynamic buffer frame overflow: {} + {} > {} bytes", offset, size, frame_size_);
+    offset_ = offset + size;
+    stats_.high_water = std::max(stats_.high_water, offset_);
+    size_t start = frame_ * frame_size_ + offset;
+    return {mapped_ + start, GLintptr(start), GLsizeiptr(size)};
+}
@@ -0,0 +1,76 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "query.h"
+
+// Ring buffer for data streamed to the GPU every frame (per-draw transforms, instance
+// and light data). The buffer is persistently and coherently mapped and split into
+// one region per frame in flight; CPU writes go straight into mapped memory and are
+// bound with glBindBufferRange, with no glBufferSubData or uniform calls per draw.
+//
+// Each region is fenced at end_frame() and begin_frame() waits for the fence before
+// reusing it. Those waits are counted as stalls; if they happen, the ring needs more
+// frames (or the GPU is the bottleneck).
+class DynamicBuffer {
+  public:
+    static constexpr size_t FRAMES = 3;
+
+    struct Allocation {
+        std::byte* data;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+    struct Stats {
+        size_t stalls = 0;
+        std::chrono::nanoseconds stall_time{0};
+        // Most bytes allocated in a single frame
+        size_t high_water = 0;
+    };
+
+    // target is GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER and decides the offset
+    // alignment; frame_size is the capacity of each frame's region
+    DynamicBuffer(GLenum target, size_t frame_size);
+
+    // Switches to the next region, waiting for the GPU to finish with it first
+    void begin_frame();
+    // Fences the current region. Call after the last draw reading from it.
+    void end_frame();
+
+    // Allocates size bytes in the current region at an offset aligned for binding.
+    // Throws if the region is full.
+    Allocation allocate(size_t size);
+    template <typename T>
+    Allocation push(const T& value) {
+        Allocation a = allocate(sizeof(T));
+        std::memcpy(a.data, &value, sizeof(T));
+        return a;
+    }
+
+    // Binds an allocation to an indexed binding point of the buffer's target
+    void bind(GLuint index, const Allocation& allocation) const {
+        glBindBufferRange(target_, index, *buffer_, allocation.offset, allocation.size);
+    }
+
+    GLuint buffer() const { return buffer_.get(); }
+    size_t frame_size() const { return frame_size_; }
+    const Stats& stats() const { return stats_; }
+
+  private:
+    GLenum target_;
+    size_t frame_size_, alignment_;
+    BufferHandle buffer_;
+    std::byte* mapped_ = nullptr;
+    std::array<SyncHandle, FRAMES> fences_;
+    size_t frame_ = 0, offset_ = 0;
+    Stats stats_;
+};
+
+#endif // DYNAMIC_BUFFER_H
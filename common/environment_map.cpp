@@ -0,0 +1,534 @@
+#include "environment_map.h"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+
+#include "errutils.h"
+#include "mapped_file.h"
+#include "vfs.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'G', 'E', 'M'};
+constexpr char BRDF_LUT_MAGIC[4] = {'L', 'G', 'B', 'L'};
+constexpr uint32_t VERSION = 1;
+constexpr float PI = std::numbers::pi_v<float>;
+
+// Written to the cache as is
+static_assert(sizeof(SH9) == 27 * sizeof(float));
+
+// On-disk header of a baked environment, native byte order. The SH9 coefficients and
+// then every level's faces follow.
+struct EnvironmentHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t face_size, levels, samples;
+    uint32_t reserved;
+    // Identifies the source image
+    uint64_t source_size, source_hash;
+};
+
+// On-disk header of a BRDF LUT, native byte order. The texels follow.
+struct BrdfLutHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t size, samples;
+};
+
+// 64-bit FNV-1a
+uint64_t hash_bytes(std::span<const std::byte> bytes) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (std::byte b : bytes)
+        hash = (hash ^ uint64_t(b)) * 0x100000001b3;
+    return hash;
+}
+
+// Unit direction through texel coordinates u, v in [-1, 1] of a face
+glm::vec3 face_direction(int face, float u, float v) {
+    glm::vec3 dir;
+    switch (face) {
+    case 0:
+        dir = {1, -v, -u};
+        break;
+    case 1:
+        dir = {-1, -v, u};
+        break;
+    case 2:
+        dir = {u, 1, v};
+        break;
+    case 3:
+        dir = {u, -1, -v};
+        break;
+    case 4:
+        dir = {u, -v, 1};
+        break;
+    default:
+        dir = {-u, -v, -1};
+        break;
+    }
+    return glm::normalize(dir);
+}
+
+// Direction through the center of texel x, y of a size x size face
+glm::vec3 texel_direction(int face, int x, int y, int size) {
+    return face_direction(face, 2.f * (float(x) + 0.5f) / float(size) - 1.f,
+                          2.f * (float(y) + 0.5f) / float(size) - 1.f);
+}
+
+// Bilinear sample of an RGB image at texel coordinates (texel centers at + 0.5), with x
+// wrapping or clamping and y clamping
+glm::vec3 sample_bilinear(const float* pixels, int width, int height, float x, float y,
+                          bool wrap_x) {
+    x -= 0.5f;
+    y = std::clamp(y - 0.5f, 0.f, float(height - 1));
+    if (!wrap_x)
+        x = std::clamp(x, 0.f, float(width - 1));
+    float fx = std::floor(x), fy = std::floor(y);
+    float tx = x - fx, ty = y - fy;
+    int x0 = int(fx), y0 = int(fy);
+    int x1 = x0 + 1, y1 = std::min(y0 + 1, height - 1);
+    if (wrap_x) {
+        x0 = (x0 % width + width) % width;
+        x1 = x1 % width;
+    } else {
+        x1 = std::min(x1, width - 1);
+    }
+    auto texel = [&](int tx_, int ty_) {
+        const float* p = pixels + (size_t(ty_) * width + tx_) * 3;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    return glm::mix(glm::mix(texel(x0, y0), texel(x1, y0), tx),
+                    glm::mix(texel(x0, y1), texel(x1, y1), tx), ty);
+}
+
+void store_rgb(float* out, const glm::vec3& color) {
+    out[0] = color.x;
+    out[1] = color.y;
+    out[2] = color.z;
+}
+
+// Face and face coordinates in [0, 1] hit by a direction, as GL selects them
+struct CubeCoord {
+    int face;
+    float s, t;
+};
+
+CubeCoord cube_coord(const glm::vec3& dir) {
+    glm::vec3 a = glm::abs(dir);
+    int face;
+    float sc, tc, ma;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = dir.x > 0 ? 0 : 1;
+        sc = dir.x > 0 ? -dir.z : dir.z;
+        tc = -dir.y;
+        ma = a.x;
+    } else if (a.y >= a.z) {
+        face = dir.y > 0 ? 2 : 3;
+        sc = dir.x;
+        tc = dir.y > 0 ? dir.z : -dir.z;
+        ma = a.y;
+    } else {
+        face = dir.z > 0 ? 4 : 5;
+        sc = dir.z > 0 ? dir.x : -dir.x;
+        tc = -dir.y;
+        ma = a.z;
+    }
+    return {face, 0.5f * (sc / ma + 1.f), 0.5f * (tc / ma + 1.f)};
+}
+
+// Trilinear sample of a cube map. Filtering doesn't cross face edges; at the sizes
+// sampled here the seams are averaged away by the many samples per texel.
+glm::vec3 sample_cubemap(const CubemapData& cubemap, const CubeCoord& coord, float lod) {
+    int max_level = int(cubemap.levels.size()) - 1;
+    lod = std::clamp(lod, 0.f, float(max_level));
+    int level0 = int(lod);
+    int level1 = std::min(level0 + 1, max_level);
+    auto sample_level = [&](int level) {
+        int size = cubemap.level_size(level);
+        return sample_bilinear(cubemap.levels[level][coord.face].data(), size, size,
+                               coord.s * float(size), coord.t * float(size), false);
+    };
+    glm::vec3 color = sample_level(level0);
+    if (level1 == level0 || lod == float(level0))
+        return color;
+    return glm::mix(color, sample_level(level1), lod - float(level0));
+}
+
+// Low-discrepancy point i of n in [0, 1)^2
+glm::vec2 hammersley(uint32_t i, uint32_t n) {
+    uint32_t bits = i << 16 | i >> 16;
+    bits = (bits & 0x55555555u) << 1 | (bits & 0xaaaaaaaau) >> 1;
+    bits = (bits & 0x33333333u) << 2 | (bits & 0xccccccccu) >> 2;
+    bits = (bits & 0x0f0f0f0fu) << 4 | (bits & 0xf0f0f0f0u) >> 4;
+    bits = (bits & 0x00ff00ffu) << 8 | (bits & 0xff00ff00u) >> 8;
+    return {float(i) / float(n), float(bits) * 0x1p-32f};
+}
+
+// GGX importance-sampled half vector around +Z for the point xi, with a2 the squared
+// alpha (roughness^4)
+glm::vec3 ggx_half_vector(const glm::vec2& xi, float a2) {
+    float phi = 2.f * PI * xi.x;
+    float cos_theta = std::sqrt((1.f - xi.y) / (1.f + (a2 - 1.f) * xi.y));
+    float sin_theta = std::sqrt(1.f - cos_theta * cos_theta);
+    return {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+}
+
+// Real SH basis, bands 0-2
+std::array<float, 9> sh_basis(const glm::vec3& n) {
+    return {0.282095f,
+            0.488603f * n.y,
+            0.488603f * n.z,
+            0.488603f * n.x,
+            1.092548f * n.x * n.y,
+            1.092548f * n.y * n.z,
+            0.315392f * (3.f * n.z * n.z - 1.f),
+            1.092548f * n.x * n.z,
+            0.546274f * (n.x * n.x - n.y * n.y)};
+}
+
+} // namespace
+
+CubemapData equirect_to_cubemap(const FloatImage& equirect, int face_size, ThreadPool& pool) {
+    err::check(face_size > 0 && std::has_single_bit(unsigned(face_size)),
+               "cube map size {} isn't a power of two", face_size);
+    CubemapData cubemap{face_size, std::vector<std::array<std::vector<float>, 6>>(1)};
+    for (auto& face : cubemap.levels[0])
+        face.resize(size_t(face_size) * face_size * 3);
+
+    // 2x2 samples per texel keep large sources from aliasing
+    constexpr float OFFSETS[2] = {0.25f, 0.75f};
+    pool.parallel_for(size_t(6 * face_size), [&](size_t row) {
+        int face = int(row) / face_size, y = int(row) % face_size;
+        float* out = cubemap.levels[0][face].data() + size_t(y) * face_size * 3;
+        for (int x = 0; x < face_size; x++) {
+            glm::vec3 color(0);
+            for (float oy : OFFSETS) {
+                for (float ox : OFFSETS) {
+                    glm::vec3 dir = face_direction(face, 2.f * (x + ox) / face_size - 1.f,
+                                                   2.f * (y + oy) / face_size - 1.f);
+                    float u = std::atan2(dir.z, dir.x) / (2.f * PI) + 0.5f;
+                    float v = std::acos(std::clamp(dir.y, -1.f, 1.f)) / PI;
+                    color += sample_bilinear(equirect.pixels.data(), equirect.width,
+                                             equirect.height, u * float(equirect.width),
+                                             v * float(equirect.height), true);
+                }
+            }
+            store_rgb(out + size_t(x) * 3, color * 0.25f);
+        }
+    });
+    return cubemap;
+}
+
+void generate_cubemap_mips(CubemapData& cubemap, ThreadPool& pool) {
+    int num_levels = int(std::bit_width(unsigned(cubemap.face_size)));
+    cubemap.levels.resize(num_levels);
+    for (int level = 1; level < num_levels; level++) {
+        int size = cubemap.level_size(level), src_size = cubemap.level_size(level - 1);
+        for (auto& face : cubemap.levels[level])
+            face.resize(size_t(size) * size * 3);
+        pool.parallel_for(size_t(6 * size), [&](size_t row) {
+            int face = int(row) / size, y = int(row) % size;
+            const float* src = cubemap.levels[level - 1][face].data();
+            float* out = cubemap.levels[level][face].data() + size_t(y) * size * 3;
+            for (int x = 0; x < size; x++) {
+                for (int c = 0; c < 3; c++) {
+                    auto at = [&](int sx, int sy) {
+                        return src[(size_t(sy) * src_size + sx) * 3 + c];
+                    };
+                    out[x * 3 + c] = 0.25f * (at(2 * x, 2 * y) + at(2 * x + 1, 2 * y) +
+                                              at(2 * x, 2 * y + 1) + at(2 * x + 1, 2 * y + 1));
+                }
+            }
+        });
+    }
+}
+
+CubemapData prefilter_specular(const CubemapData& radiance, int levels, int samples,
+                               ThreadPool& pool) {
+    int face_size = radiance.face_size;
+    err::check(levels >= 1 && levels <= int(std::bit_width(unsigned(face_size))),
+               "{} specular levels don't fit a {} texel cube map", levels, face_size);
+    err::check(radiance.levels.size() == std::bit_width(unsigned(face_size)),
+               "prefiltering needs the radiance mip chain");
+    CubemapData result{face_size, std::vector<std::array<std::vector<float>, 6>>(levels)};
+    // Roughness 0 is a mirror
+    result.levels[0] = radiance.levels[0];
+
+    // Solid angle of a level 0 texel, to pick the mip matching each sample's footprint
+    float texel_solid_angle = 4.f * PI / (6.f * float(face_size) * float(face_size));
+    struct Sample {
+        glm::vec3 dir;
+        float weight, lod;
+    };
+    std::vector<Sample> table;
+    for (int level = 1; level < levels; level++) {
+        // GGX importance samples around +Z, with the normal and view along it
+        float roughness = float(level) / float(levels - 1);
+        float a = roughness * roughness, a2 = a * a;
+        table.clear();
+        for (int i = 0; i < samples; i++) {
+            glm::vec3 h = ggx_half_vector(hammersley(uint32_t(i), uint32_t(samples)), a2);
+            float cos_theta = h.z;
+            glm::vec3 l = 2.f * cos_theta * h - glm::vec3(0, 0, 1);
+            if (l.z <= 0)
+                continue;
+            float d = cos_theta * cos_theta * (a2 - 1.f) + 1.f;
+            float pdf = a2 / (PI * d * d) / 4.f;
+            float sample_solid_angle = 1.f / (float(samples) * pdf);
+            float lod = 0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1.f;
+            table.push_back({l, l.z, std::max(lod, 0.f)});
+        }
+        float total_weight = 0;
+        for (const Sample& sample : table)
+            total_weight += sample.weight;
+
+        int size = result.level_size(level);
+        for (auto& face : result.levels[level])
+            face.resize(size_t(size) * size * 3);
+        pool.parallel_for(size_t(6 * size), [&](size_t row) {
+            int face = int(row) / size, y = int(row) % size;
+            float* out = result.levels[level][face].data() + size_t(y) * size * 3;
+            for (int x = 0; x < size; x++) {
+                glm::vec3 n = texel_direction(face, x, y, size);
+                glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0, 0, 1)
+                                                      : glm::vec3(1, 0, 0);
+                glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+                glm::vec3 bitangent = glm::cross(n, tangent);
+                glm::vec3 color(0);
+                for (const Sample& sample : table) {
+                    glm::vec3 dir = tangent * sample.dir.x + bitangent * sample.dir.y +
+                                    n * sample.dir.z;
+                    color += sample_cubemap(radiance, cube_coord(dir), sample.lod) *
+                             sample.weight;
+                }
+                store_rgb(out + size_t(x) * 3, color / total_weight);
+            }
+        });
+    }
+    return result;
+}
+
+SH9 project_irradiance(const CubemapData& radiance, ThreadPool& pool) {
+    int size = radiance.face_size;
+    // Per-row sums, added up in order so the result doesn't depend on scheduling
+    struct RowSum {
+        SH9 sh{};
+        float weight = 0;
+    };
+    std::vector<RowSum> rows(size_t(6 * size));
+    pool.parallel_for(rows.size(), [&](size_t row) {
+        int face = int(row) / size, y = int(row) % size;
+        const float* pixels = radiance.levels[0][face].data() + size_t(y) * size * 3;
+        RowSum& sum = rows[row];
+        for (int x = 0; x < size; x++) {
+            float u = 2.f * (float(x) + 0.5f) / float(size) - 1.f;
+            float v = 2.f * (float(y) + 0.5f) / float(size) - 1.f;
+            // Solid angle of the texel, up to the constant (2 / size)^2 that the
+            // normalization below cancels
+            float weight = std::pow(1.f + u * u + v * v, -1.5f);
+            glm::vec3 color(pixels[x * 3], pixels[x * 3 + 1], pixels[x * 3 + 2]);
+            auto basis = sh_basis(face_direction(face, u, v));
+            for (int i = 0; i < 9; i++)
+                sum.sh[i] += color * (basis[i] * weight);
+            sum.weight += weight;
+        }
+    });
+
+    SH9 sh{};
+    float total_weight = 0;
+    for (const RowSum& row : rows) {
+        for (int i = 0; i < 9; i++)
+            sh[i] += row.sh[i];
+        total_weight += row.weight;
+    }
+    // Clamped cosine convolution per band (pi, 2pi/3, pi/4), then divided by pi
+    constexpr float BAND_SCALE[3] = {1.f, 2.f / 3.f, 1.f / 4.f};
+    for (int i = 0; i < 9; i++) {
+        int band = i == 0 ? 0 : i < 4 ? 1 : 2;
+        sh[i] *= 4.f * PI / total_weight * BAND_SCALE[band];
+    }
+    return sh;
+}
+
+EnvironmentData load_environment(const fs::path& path, const fs::path& cache_path,
+                                 ThreadPool& pool, const EnvironmentOpts& opts) {
+    FileData source = vfs::read(path);
+    EnvironmentHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.face_size = opts.face_size;
+    header.levels = opts.levels;
+    header.samples = opts.samples;
+    header.source_size = source.size();
+    header.source_hash = hash_bytes(source.bytes());
+
+    EnvironmentData data;
+    data.specular.face_size = opts.face_size;
+    size_t data_size = sizeof(header) + sizeof(SH9);
+    for (int level = 0; level < opts.levels; level++) {
+        size_t size = size_t(data.specular.level_size(level));
+        data_size += 6 * size * size * 3 * sizeof(float);
+    }
+
+    std::error_code ec;
+    if (fs::is_regular_file(cache_path, ec)) {
+        MappedFile cache(cache_path);
+        if (cache.size() == data_size &&
+            std::memcmp(cache.data(), &header, sizeof(header)) == 0) {
+            size_t offset = sizeof(header);
+            std::memcpy(&data.irradiance, cache.data() + offset, sizeof(SH9));
+            offset += sizeof(SH9);
+            data.specular.levels.resize(size_t(opts.levels));
+            for (int level = 0; level < opts.levels; level++) {
+                size_t size = size_t(data.specular.level_size(level));
+                for (auto& face : data.specular.levels[level]) {
+                    face.resize(size * size * 3);
+                    size_t bytes = face.size() * sizeof(float);
+                    std::memcpy(face.data(), cache.data() + offset, bytes);
+                    offset += bytes;
+                }
+            }
+            return data;
+        }
+    }
+
+    FloatImage equirect;
+    try {
+        equirect = decode_float_image(source.bytes());
+    } catch (const std::exception& e) {
+        err::error("failed to load environment {}: {}", path.string(), e.what());
+    }
+    CubemapData radiance = equirect_to_cubemap(equirect, opts.face_size, pool);
+    generate_cubemap_mips(radiance, pool);
+    data.specular = prefilter_specular(radiance, opts.levels, opts.samples, pool);
+    data.irradiance = project_irradiance(radiance, pool);
+
+    std::ofstream file(cache_path, std::ios::binary);
+    err::check(file.is_open(), "failed to create environment cache {}", cache_path.string());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&data.irradiance), sizeof(SH9));
+    for (auto& level : data.specular.levels) {
+        for (auto& face : level) {
+            file.write(reinterpret_cast<const char*>(face.data()),
+                       std::streamsize(face.size() * sizeof(float)));
+        }
+    }
+    err::check(file.good(), "failed to write environment cache {}", cache_path.string());
+    return data;
+}
+
+BrdfLut compute_brdf_lut(int size, int samples, ThreadPool& pool) {
+    err::check(size > 0 && samples > 0, "bad BRDF LUT size {} or sample count {}", size,
+               samples);
+    BrdfLut lut{size, std::vector<float>(size_t(size) * size * 2)};
+    pool.parallel_for(size_t(size), [&](size_t y) {
+        float roughness = (float(y) + 0.5f) / float(size);
+        float a = roughness * roughness, a2 = a * a;
+        // Schlick-Smith visibility with k remapped for image-based lighting
+        float k = a / 2.f;
+        float* out = lut.texels.data() + y * size * 2;
+        for (int x = 0; x < size; x++) {
+            float n_dot_v = (float(x) + 0.5f) / float(size);
+            glm::vec3 v(std::sqrt(1.f - n_dot_v * n_dot_v), 0, n_dot_v);
+            float scale = 0, bias = 0;
+            for (int i = 0; i < samples; i++) {
+                glm::vec3 h =
+                    ggx_half_vector(hammersley(uint32_t(i), uint32_t(samples)), a2);
+                float v_dot_h = glm::dot(v, h);
+                glm::vec3 l = 2.f * v_dot_h * h - v;
+                if (l.z <= 0)
+                    continue;
+                float g = n_dot_v / (n_dot_v * (1.f - k) + k) * l.z / (l.z * (1.f - k) + k);
+                float g_vis = g * std::max(v_dot_h, 0.f) / (h.z * n_dot_v);
+                float fresnel = std::pow(1.f - std::max(v_dot_h, 0.f), 5.f);
+                scale += (1.f - fresnel) * g_vis;
+                bias += fresnel * g_vis;
+            }
+            out[x * 2] = scale / float(samples);
+            out[x * 2 + 1] = bias / float(samples);
+        }
+    });
+    return lut;
+}
+
+BrdfLut load_brdf_lut(const fs::path& cache_path, ThreadPool& pool, int size,
+                      int samples) {
+    BrdfLutHeader header{};
+    std::memcpy(header.magic, BRDF_LUT_MAGIC, sizeof(BRDF_LUT_MAGIC));
+    header.version = VERSION;
+    header.size = size;
+    header.samples = samples;
+    size_t texels_size = size_t(size) * size * 2 * sizeof(float);
+
+    std::error_code ec;
+    if (fs::is_regular_file(cache_path, ec)) {
+        MappedFile cache(cache_path);
+        if (cache.size() == sizeof(header) + texels_size &&
+            std::memcmp(cache.data(), &header, sizeof(header)) == 0) {
+            BrdfLut lut{size, std::vector<float>(size_t(size) * size * 2)};
+            std::memcpy(lut.texels.data(), cache.data() + sizeof(header), texels_size);
+            return lut;
+        }
+    }
+
+    BrdfLut lut = compute_brdf_lut(size, samples, pool);
+    std::ofstream file(cache_path, std::ios::binary);
+    err::check(file.is_open(), "failed to create BRDF LUT cache {}", cache_path.string());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(lut.texels.data()),
+               std::streamsize(texels_size));
+    err::check(file.good(), "failed to write BRDF LUT cache {}", cache_path.string());
+    return lut;
+}
+
+EnvironmentLighting::EnvironmentLighting(const EnvironmentData& data, const BrdfLut& brdf_lut)
+    : levels_(int(data.specular.levels.size())), irradiance_(data.irradiance) {
+    const CubemapData& cubemap = data.specular;
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture_.reset_as_ref());
+    // Positive floats in 4 bytes a texel, half of GL_RGB16F
+    glTextureStorage2D(*texture_, levels_, GL_R11F_G11F_B10F, cubemap.face_size,
+                       cubemap.face_size);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int level = 0; level < levels_; level++) {
+        int size = cubemap.level_size(level);
+        for (int face = 0; face < 6; face++) {
+            glTextureSubImage3D(*texture_, level, 0, 0, face, size, size, 1, GL_RGB, GL_FLOAT,
+                                cubemap.levels[level][face].data());
+        }
+    }
+    glTextureParameteri(*texture_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(*texture_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*texture_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*texture_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*texture_, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Rough levels are tiny, so filtering has to cross face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &brdf_lut_.reset_as_ref());
+    glTextureStorage2D(*brdf_lut_, 1, GL_RG16F, brdf_lut.size, brdf_lut.size);
+    glTextureSubImage2D(*brdf_lut_, 0, 0, 0, brdf_lut.size, brdf_lut.size, GL_RG, GL_FLOAT,
+                        brdf_lut.texels.data());
+    glTextureParameteri(*brdf_lut_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(*brdf_lut_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*brdf_lut_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*brdf_lut_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+ShaderDefines EnvironmentLighting::defines() {
+    return {{"IMAGE_BASED_LIGHTING", "1"}};
+}
+
+void EnvironmentLighting::apply(const Shader& shader, GLuint unit) const {
+    glBindTextureUnit(unit, *texture_);
+    shader.set_int("environmentMap", int(unit));
+    shader.set_float("environmentMaxLod", float(levels_ - 1));
+    glBindTextureUnit(unit + 1, *brdf_lut_);
+    shader.set_int("brdfLut", int(unit + 1));
+    for (size_t i = 0; i < irradiance_.size(); i++)
+        shader.set_vec3(UniformName("irradianceSH[{}]", i)(""), irradiance_[i]);
+}
@@ -0,0 +1,101 @@
+#ifndef ENVIRONMENT_MAP_H
+#define ENVIRONMENT_MAP_H
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "image_decoder.h"
+#include "shader.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// Float RGB cube map with its mip chain. Faces are in GL order (+X, -X, +Y, -Y, +Z, -Z)
+// and rows run from t = 0, as glTextureSubImage3D takes them.
+struct CubemapData {
+    int face_size = 0;
+    // levels[level][face], level_size(level)^2 RGB texels each
+    std::vector<std::array<std::vector<float>, 6>> levels;
+
+    int level_size(int level) const { return std::max(face_size >> level, 1); }
+};
+
+// Diffuse lighting as order 2 spherical harmonics: radiance convolved with a clamped
+// cosine and divided by pi, so a Lambertian surface reflects albedo times the SH
+// evaluated at its normal
+using SH9 = std::array<glm::vec3, 9>;
+
+// Resamples an equirectangular image, top row looking up, into a one-level cube map.
+// face_size must be a power of two.
+CubemapData equirect_to_cubemap(const FloatImage& equirect, int face_size, ThreadPool& pool);
+// Fills in the mip chain below level 0 with a 2x2 box filter
+void generate_cubemap_mips(CubemapData& cubemap, ThreadPool& pool);
+// Prefilters radiance, which needs its full mip chain, for split-sum GGX specular: level
+// l of the result is convolved for roughness l / (levels - 1). Each texel takes samples
+// importance-sampled directions, each read from the radiance mip matching its footprint
+// so few samples don't alias.
+CubemapData prefilter_specular(const CubemapData& radiance, int levels, int samples,
+                               ThreadPool& pool);
+// Projects level 0 of radiance onto SH9 irradiance
+SH9 project_irradiance(const CubemapData& radiance, ThreadPool& pool);
+
+struct EnvironmentOpts {
+    int face_size = 256;
+    // Specular levels from roughness 0 to 1
+    int levels = 6;
+    int samples = 128;
+};
+
+struct EnvironmentData {
+    CubemapData specular;
+    SH9 irradiance;
+};
+
+// Bakes the equirectangular environment image at path, or reads the bake back from
+// cache_path if that was made from the same image with the same opts. A new bake is
+// written to cache_path.
+EnvironmentData load_environment(const std::filesystem::path& path,
+                                 const std::filesystem::path& cache_path, ThreadPool& pool,
+                                 const EnvironmentOpts& opts = {});
+
+// Split-sum environment BRDF for GGX: the scale and bias applied to F0 as RG pairs,
+// cos(theta) of the view direction along x and roughness along y
+struct BrdfLut {
+    int size = 0;
+    std::vector<float> texels;
+};
+
+BrdfLut compute_brdf_lut(int size, int samples, ThreadPool& pool);
+// Reads the LUT back from cache_path if it was computed with the same size and samples,
+// otherwise computes it and writes it there
+BrdfLut load_brdf_lut(const std::filesystem::path& cache_path, ThreadPool& pool,
+                      int size = 128, int samples = 512);
+
+// Image-based ambient lighting from a baked environment. Shaders built with defines()
+// read it through ibl.glsl: one filtered cube map fetch for specular and a few
+// multiply-adds for diffuse, with no per-frame convolution.
+class EnvironmentLighting {
+  public:
+    EnvironmentLighting(const EnvironmentData& data, const BrdfLut& brdf_lut);
+
+    static ShaderDefines defines();
+
+    // Binds the specular cube map to unit and the BRDF LUT to unit + 1, and sets the
+    // uniforms read by ibl.glsl
+    void apply(const Shader& shader, GLuint unit) const;
+
+    GLuint texture() const { return *texture_; }
+    const SH9& irradiance() const { return irradiance_; }
+
+  private:
+    TextureHandle texture_;
+    TextureHandle brdf_lut_;
+    int levels_;
+    SH9 irradiance_;
+};
+
+#endif // ENVIRONMENT_MAP_H
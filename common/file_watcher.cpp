@@ -0,0 +1,97 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "errutils.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+
+void FileWatcher::FdDeleter::operator()(int fd) const { close(fd); }
+
+FileWatcher::FileWatcher()
+    : fd_(err::check_posix(inotify_init1(IN_NONBLOCK | IN_CLOEXEC),
+                           "inotify_init1 failed: {}")) {}
+
+void FileWatcher::add(const fs::path& path) {
+    fs::path canonical = fs::weakly_canonical(path);
+    if (!files_.insert(canonical).second)
+        return;
+    fs::path dir = canonical.parent_path();
+    for (auto& [wd, watched] : dirs_) {
+        if (watched == dir)
+            return;
+    }
+    int wd = err::check_posix(
+        inotify_add_watch(*fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO),
+        "failed to watch directory {}: {}", dir.string());
+    dirs_[wd] = dir;
+}
+
+std::vector<fs::path> FileWatcher::poll() {
+    std::vector<fs::path> changed;
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t len = read(*fd_, buf, sizeof(buf));
+        if (len <= 0)
+            break;
+        for (char* p = buf; p < buf + len;) {
+            auto* event = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            auto* dir = util::get_or_null(dirs_, event->wd);
+            if (!dir || !event->len)
+                continue;
+            fs::path path = *dir / event->name;
+            if (files_.contains(path) &&
+                std::find(changed.begin(), changed.end(), path) == changed.end())
+                changed.push_back(std::move(path));
+        }
+    }
+    return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher() = default;
+
+void FileWatcher::add(const fs::path& path) {
+    fs::path canonical = fs::weakly_canonical(path);
+    if (!files_.insert(canonical).second)
+        return;
+    std::error_code ec;
+    mtimes_[canonical] = fs::last_write_time(canonical, ec);
+}
+
+std::vector<fs::path> FileWatcher::poll() {
+    using namespace std::chrono_literals;
+    std::vector<fs::path> changed;
+    // Stat-ing every file each frame is wasteful, so rate limit the polling
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_poll_ < 250ms)
+        return changed;
+    last_poll_ = now;
+    for (auto& [path, mtime] : mtimes_) {
+        std::error_code ec;
+        auto new_mtime = fs::last_write_time(path, ec);
+        if (!ec && new_mtime != mtime) {
+            mtime = new_mtime;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+
+#endif // __linux__
+
+bool FileWatcher::contains(const fs::path& path) const {
+    return files_.contains(fs::weakly_canonical(path));
+}
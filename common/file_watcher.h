@@ -0,0 +1,43 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "raii.h"
+
+// Watches a set of files for modification. Uses inotify on Linux, watching the
+// parent directories so editors that save by renaming a temp file are picked up.
+// Other platforms fall back to polling modification times.
+class FileWatcher {
+  public:
+    FileWatcher();
+
+    // Starts watching a file. Paths are canonicalized, so different spellings of
+    // the same file are only watched once.
+    void add(const std::filesystem::path& path);
+    bool contains(const std::filesystem::path& path) const;
+
+    // Returns the canonical paths of watched files that changed since the last call.
+    // Never blocks.
+    std::vector<std::filesystem::path> poll();
+
+  private:
+    std::set<std::filesystem::path> files_;
+#ifdef __linux__
+    struct FdDeleter {
+        void operator()(int fd) const;
+    };
+    Handle<int, FdDeleter> fd_;
+    // inotify watch descriptor -> directory
+    std::map<int, std::filesystem::path> dirs_;
+#else
+    std::map<std::filesystem::path, std::filesystem::file_time_type> mtimes_;
+    std::chrono::steady_clock::time_point last_poll_;
+#endif
+};
+
+#endif // FILE_WATCHER_H
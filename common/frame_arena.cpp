@@ -0,0 +1,75 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+namespace {
+
+size_t align_up(size_t n, size_t alignment) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+LinearArena::LinearArena(size_t block_size) : block_size_(block_size) {}
+
+void LinearArena::reset() {
+    high_water_ = high_water();
+    if (blocks_.size() > 1) {
+        size_t size = align_up(capacity(), alignof(std::max_align_t));
+        blocks_.clear();
+        blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+    }
+    block_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+size_t LinearArena::capacity() const {
+    return std::accumulate(blocks_.begin(), blocks_.end(), size_t(0),
+                           [](size_t sum, const Block& b) { return sum + b.size; });
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment) {
+    while (block_ < blocks_.size()) {
+        Block& block = blocks_[block_];
+        auto base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t start = align_up(base + offset_, alignment) - base;
+        if (start + bytes <= block.size) {
+            used_ += start + bytes - offset_;
+            offset_ = start + bytes;
+            return block.data.get() + start;
+        }
+        // Skip the unused tail of this block
+        used_ += block.size - offset_;
+        ++block_;
+        offset_ = 0;
+    }
+    size_t size = std::max(block_size_, bytes + alignment);
+    blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+    block_ = blocks_.size() - 1;
+    offset_ = 0;
+    return do_allocate(bytes, alignment);
+}
+
+FrameArena::FrameArena(size_t num_threads, size_t block_size) {
+    arenas_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+        arenas_.push_back(std::make_unique<LinearArena>(block_size));
+}
+
+void FrameArena::reset() {
+    for (auto& arena : arenas_)
+        arena->reset();
+}
+
+size_t FrameArena::used() const {
+    return std::accumulate(arenas_.begin(), arenas_.end(), size_t(0),
+                           [](size_t sum, auto& a) { return sum + a->used(); });
+}
+
+size_t FrameArena::high_water() const {
+    return std::accumulate(arenas_.begin(), arenas_.end(), size_t(0),
+                           [](size_t sum, auto& a) { return sum + a->high_water(); });
+}
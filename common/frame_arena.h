@@ -0,0 +1,69 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for data that lives until the next reset(). Deallocation is a no-op;
+// reset() rewinds to the start and keeps the memory. When a frame needed more than one
+// block, reset() merges them into a single block of the high-water size, so after a
+// few frames the arena stops touching the heap altogether.
+//
+// Use it through std::pmr containers, e.g. std::pmr::vector<T> v(&arena). Not
+// thread-safe; give each thread its own arena (see FrameArena).
+class LinearArena : public std::pmr::memory_resource {
+  public:
+    explicit LinearArena(size_t block_size = 64 * 1024);
+
+    void reset();
+
+    // Bytes handed out since the last reset, including alignment padding
+    size_t used() const { return used_; }
+    // Largest used() seen across resets
+    size_t high_water() const { return std::max(high_water_, used_); }
+    // Bytes currently reserved from the heap
+    size_t capacity() const;
+
+  private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t block_ = 0, offset_ = 0;
+    size_t used_ = 0, high_water_ = 0;
+};
+
+// One LinearArena per thread, indexed like ThreadPool::thread_index(), so workers can
+// allocate transient data without locking. Reset once per frame while no thread is
+// using it.
+class FrameArena {
+  public:
+    FrameArena(size_t num_threads, size_t block_size = 64 * 1024);
+
+    LinearArena& local(size_t thread_index) { return *arenas_[thread_index]; }
+    size_t num_threads() const { return arenas_.size(); }
+
+    void reset();
+
+    size_t used() const;
+    // Sum of the per-thread high-water marks
+    size_t high_water() const;
+
+  private:
+    // Separate allocations keep the arenas' bookkeeping off each other's cache lines
+    std::vector<std::unique_ptr<LinearArena>> arenas_;
+};
+
+#endif // FRAME_ARENA_H
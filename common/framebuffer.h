@@ -0,0 +1,30 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h>
+
+#include "errutils.h"
+#include "raii.h"
+#include "texture.h"
+
+using FramebufferHandle = Handle<GLuint, gl_delete_array_functor<glDeleteFramebuffers>>;
+
+// Creates an immutable single-level 2D texture for use as a render target
+inline TextureHandle make_render_texture(GLenum internal_format, GLsizei width,
+                                         GLsizei height, GLenum filter = GL_NEAREST) {
+    TextureHandle tex;
+    glCreateTextures(GL_TEXTURE_2D, 1, &tex.reset_as_ref());
+    glTextureStorage2D(*tex, 1, internal_format, width, height);
+    glTextureParameteri(*tex, GL_TEXTURE_MIN_FILTER, filter);
+    glTextureParameteri(*tex, GL_TEXTURE_MAG_FILTER, filter);
+    glTextureParameteri(*tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+inline void check_framebuffer(GLuint fbo) {
+    GLenum status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+    err::check(status == GL_FRAMEBUFFER_COMPLETE, "incomplete framebuffer: {:#x}", status);
+}
+
+#endif // FRAMEBUFFER_H
@@ -0,0 +1,62 @@
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <cstdint>
+
+BufferHandle make_buffer(std::span<const std::byte> data, GLbitfield storage_flags) {
+    BufferHandle buffer;
+    // Zero-sized storage is an error; keep empty buffers bindable instead
+    GLsizeiptr size = std::max<GLsizeiptr>(data.size_bytes(), 1);
+    const void* bytes = data.empty() ? nullptr : data.data();
+    if (has_dsa()) {
+        glCreateBuffers(1, &buffer.reset_as_ref());
+        glNamedBufferStorage(*buffer, size, bytes, storage_flags);
+    } else {
+        // GL_COPY_WRITE_BUFFER is not used for drawing, so borrowing it is harmless
+        glGenBuffers(1, &buffer.reset_as_ref());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, *buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, bytes, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return buffer;
+}
+
+VaoHandle make_vertex_array(GLuint vbo, GLsizei stride, std::span<const VertexAttrib> attribs,
+                            GLuint ebo) {
+    VaoHandle vao;
+    if (has_dsa()) {
+        glCreateVertexArrays(1, &vao.reset_as_ref());
+        glVertexArrayVertexBuffer(*vao, 0, vbo, 0, stride);
+        for (auto& attrib : attribs) {
+            glEnableVertexArrayAttrib(*vao, attrib.index);
+            if (attrib.integer)
+                glVertexArrayAttribIFormat(*vao, attrib.index, attrib.size, attrib.type,
+                                           attrib.offset);
+            else
+                glVertexArrayAttribFormat(*vao, attrib.index, attrib.size, attrib.type,
+                                          attrib.normalized, attrib.offset);
+            glVertexArrayAttribBinding(*vao, attrib.index, 0);
+        }
+        if (ebo)
+            glVertexArrayElementBuffer(*vao, ebo);
+        return vao;
+    }
+
+    glGenVertexArrays(1, &vao.reset_as_ref());
+    glBindVertexArray(*vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    for (auto& attrib : attribs) {
+        glEnableVertexAttribArray(attrib.index);
+        auto offset = reinterpret_cast<void*>(uintptr_t(attrib.offset));
+        if (attrib.integer)
+            glVertexAttribIPointer(attrib.index, attrib.size, attrib.type, stride, offset);
+        else
+            glVertexAttribPointer(attrib.index, attrib.size, attrib.type, attrib.normalized,
+                                  stride, offset);
+    }
+    if (ebo)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vao;
+}
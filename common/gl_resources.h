@@ -0,0 +1,48 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <span>
+
+#include <glad/glad.h>
+
+#include "raii.h"
+
+using VaoHandle = Handle<GLuint, gl_delete_array_functor<glDeleteVertexArrays>>;
+using BufferHandle = Handle<GLuint, gl_delete_array_functor<glDeleteBuffers>>;
+
+// Whether the context supports direct state access (GL 4.5 or
+// ARB_direct_state_access). The helpers below create resources through DSA when it is
+// there and fall back to bind-to-edit otherwise, so GL 3.3 contexts keep working.
+inline bool has_dsa() {
+#ifdef GL_ARB_direct_state_access
+    if (GLAD_GL_ARB_direct_state_access)
+        return true;
+#endif
+    return GLAD_GL_VERSION_4_5;
+}
+
+// Creates a buffer holding data. With DSA it gets immutable storage with the given
+// glBufferStorage flags; without, mutable GL_STATIC_DRAW storage.
+BufferHandle make_buffer(std::span<const std::byte> data, GLbitfield storage_flags = 0);
+
+template <typename T>
+BufferHandle make_buffer(std::span<const T> data, GLbitfield storage_flags = 0) {
+    return make_buffer(std::as_bytes(data), storage_flags);
+}
+
+struct VertexAttrib {
+    GLuint index;
+    GLint size;
+    GLenum type;
+    GLuint offset;
+    GLboolean normalized = GL_FALSE;
+    // Read as uint or int by the shader instead of converted to float
+    bool integer = false;
+};
+
+// Creates a vertex array reading attribs from vbo (binding 0) with the given stride,
+// and ebo as its element buffer if non-zero
+VaoHandle make_vertex_array(GLuint vbo, GLsizei stride, std::span<const VertexAttrib> attribs,
+                            GLuint ebo = 0);
+
+#endif // GL_RESOURCES_H
@@ -8,15 +8,15 @@
 namespace util {
 
 namespace detail {
-void gl_get_impl(GLenum pname, GLint* data) { glGetIntegerv(pname, data); }
+inline void gl_get_impl(GLenum pname, GLint* data) { glGetIntegerv(pname, data); }
 
-void gl_get_impl(GLenum pname, GLint64* data) { glGetInteger64v(pname, data); }
+inline void gl_get_impl(GLenum pname, GLint64* data) { glGetInteger64v(pname, data); }
 
-void gl_get_impl(GLenum pname, GLfloat* data) { glGetFloatv(pname, data); }
+inline void gl_get_impl(GLenum pname, GLfloat* data) { glGetFloatv(pname, data); }
 
-void gl_get_impl(GLenum pname, GLdouble* data) { glGetDoublev(pname, data); }
+inline void gl_get_impl(GLenum pname, GLdouble* data) { glGetDoublev(pname, data); }
 
-void gl_get_impl(GLenum pname, GLboolean* data) { glGetBooleanv(pname, data); }
+inline void gl_get_impl(GLenum pname, GLboolean* data) { glGetBooleanv(pname, data); }
 } // namespace detail
 
 template <typename T, size_t N = 0>
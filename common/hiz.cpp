@@ -0,0 +1,77 @@
+#include "hiz.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "errutils.h"
+
+HiZPyramid::HiZPyramid(std::span<const float> depth, int width, int height) {
+    err::check(width > 0 && height > 0 && depth.size() == size_t(width) * height,
+               "invalid depth buffer size {}x{} ({} texels)", width, height, depth.size());
+    levels_.reserve(hiz_num_levels(width, height));
+    levels_.push_back({{width, height}, {depth.begin(), depth.end()}});
+
+    while (width > 1 || height > 1) {
+        const Level& src = levels_.back();
+        glm::ivec2 size{std::max(width / 2, 1), std::max(height / 2, 1)};
+        Level dst{size, std::vector<float>(size_t(size.x) * size.y)};
+        // Odd source sizes fold the last row/column into the last destination texel,
+        // so no source texel is skipped
+        for (int y = 0; y < size.y; ++y) {
+            int y0 = y * 2;
+            int y1 = y == size.y - 1 ? height - 1 : std::min(y0 + 1, height - 1);
+            for (int x = 0; x < size.x; ++x) {
+                int x0 = x * 2;
+                int x1 = x == size.x - 1 ? width - 1 : std::min(x0 + 1, width - 1);
+                float m = 0;
+                for (int sy = y0; sy <= y1; ++sy)
+                    for (int sx = x0; sx <= x1; ++sx)
+                        m = std::max(m, src.texels[size_t(sy) * width + sx]);
+                dst.texels[size_t(y) * size.x + x] = m;
+            }
+        }
+        width = size.x;
+        height = size.y;
+        levels_.push_back(std::move(dst));
+    }
+}
+
+bool HiZPyramid::visible(const Bounds& bounds, const glm::mat4& model_view_projection) const {
+    glm::vec3 ndc_min{1}, ndc_max{-1};
+    glm::bvec3 all_below{true}, all_above{true};
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner{i & 1 ? bounds.max.x : bounds.min.x,
+                         i & 2 ? bounds.max.y : bounds.min.y,
+                         i & 4 ? bounds.max.z : bounds.min.z};
+        glm::vec4 clip = model_view_projection * glm::vec4(corner, 1);
+        // Boxes crossing the near plane can't be projected; keep them
+        if (clip.w <= 0)
+            return true;
+        all_below = all_below && glm::lessThan(glm::vec3(clip), glm::vec3(-clip.w));
+        all_above = all_above && glm::greaterThan(glm::vec3(clip), glm::vec3(clip.w));
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndc_min = glm::min(ndc_min, ndc);
+        ndc_max = glm::max(ndc_max, ndc);
+    }
+    if (glm::any(all_below) || glm::any(all_above))
+        return false;
+
+    glm::vec2 size0 = levels_[0].size;
+    glm::vec2 uv_min = glm::clamp(glm::vec2(ndc_min) * 0.5f + 0.5f, 0.f, 1.f);
+    glm::vec2 uv_max = glm::clamp(glm::vec2(ndc_max) * 0.5f + 0.5f, 0.f, 1.f);
+    glm::vec2 extent = (uv_max - uv_min) * size0;
+    // Pick the level where the box spans at most one texel, so 2x2 texels cover it
+    int level = int(std::ceil(std::log2(std::max({extent.x, extent.y, 1.f}))));
+    level = std::clamp(level, 0, num_levels() - 1);
+
+    glm::ivec2 size = levels_[level].size;
+    glm::ivec2 lo = glm::clamp(glm::ivec2(uv_min * glm::vec2(size)), glm::ivec2(0), size - 1);
+    glm::ivec2 hi = glm::clamp(glm::ivec2(uv_max * glm::vec2(size)), glm::ivec2(0), size - 1);
+    float max_depth = 0;
+    for (int y = lo.y; y <= hi.y; ++y)
+        for (int x = lo.x; x <= hi.x; ++x)
+            max_depth = std::max(max_depth, at(level, x, y));
+
+    float box_depth = ndc_min.z * 0.5f + 0.5f;
+    return box_depth <= max_depth;
+}
@@ -0,0 +1,52 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+// CPU reference for the hierarchical-Z occlusion test in
+// resources/shaders/occlusion_cull.comp and hiz_downsample.comp. Needs no GL context,
+// so the GPU results can be checked headlessly against it.
+//
+// Level 0 is the depth buffer itself (window-space depth in [0, 1], row 0 at the
+// bottom), each following level stores the max of the 2x2 (up to 3x3 on odd edges)
+// texels below it, down to 1x1.
+class HiZPyramid {
+  public:
+    HiZPyramid(std::span<const float> depth, int width, int height);
+
+    int num_levels() const { return int(levels_.size()); }
+    glm::ivec2 level_size(int level) const { return levels_[level].size; }
+    float at(int level, int x, int y) const {
+        auto& l = levels_[level];
+        return l.texels[size_t(y) * l.size.x + x];
+    }
+
+    // Whether a box transformed by model_view_projection may be visible: false if it
+    // is fully outside the frustum or behind the stored depth
+    bool visible(const Bounds& bounds, const glm::mat4& model_view_projection) const;
+
+  private:
+    struct Level {
+        glm::ivec2 size;
+        std::vector<float> texels;
+    };
+    std::vector<Level> levels_;
+};
+
+// Number of levels in a pyramid for a width x height depth buffer
+inline int hiz_num_levels(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = glm::max(width / 2, 1);
+        height = glm::max(height / 2, 1);
+        ++levels;
+    }
+    return levels;
+}
+
+#endif // HIZ_H
@@ -0,0 +1,264 @@
+#include "image_decoder.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#ifdef HAS_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+#ifdef HAS_SPNG
+#include <spng.h>
+#endif
+#ifdef HAS_TINYEXR
+#include <tinyexr.h>
+#endif
+#include <stb_image.h>
+
+#include "errutils.h"
+#include "raii.h"
+
+namespace {
+
+// Unused when no optional decoder is built in
+[[maybe_unused]] bool has_signature(std::span<const std::byte> data,
+                                    std::span<const uint8_t> signature) {
+    return data.size() >= signature.size() &&
+           std::ranges::equal(data.first(signature.size()), signature, {},
+                              [](std::byte b) { return uint8_t(b); });
+}
+
+#ifdef HAS_TURBOJPEG
+
+// SIMD IDCT, upsampling and color conversion
+class TurboJpegDecoder : public ImageDecoder {
+  public:
+    std::string_view name() const override { return "libjpeg-turbo"; }
+
+    std::optional<DecodedImage> decode(std::span<const std::byte> data,
+                                       const DecodeOpts& opts) const override {
+        static constexpr std::array<uint8_t, 3> SIGNATURE{0xff, 0xd8, 0xff};
+        // No gray + alpha pixel format
+        if (!has_signature(data, SIGNATURE) || opts.channels == 2)
+            return std::nullopt;
+
+        // Handles hold scratch buffers, so each thread keeps one
+        thread_local Handle<tjhandle, functor<tj3Destroy>> handle;
+        if (!handle) {
+            handle.reset(tj3Init(TJINIT_DECOMPRESS));
+            err::check(handle.get(), "tj3Init failed: {}", tj3GetErrorStr(nullptr));
+        }
+        tjhandle tj = handle.get();
+        auto jpeg = reinterpret_cast<const unsigned char*>(data.data());
+        err::check(tj3DecompressHeader(tj, jpeg, data.size()) == 0, "corrupt JPEG: {}",
+                   tj3GetErrorStr(tj));
+        int colorspace = tj3Get(tj, TJPARAM_COLORSPACE);
+        // stb_image reports these as unsupported, with a better message
+        if (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK)
+            return std::nullopt;
+
+        DecodedImage image;
+        image.width = tj3Get(tj, TJPARAM_JPEGWIDTH);
+        image.height = tj3Get(tj, TJPARAM_JPEGHEIGHT);
+        image.channels = opts.channels ? opts.channels : colorspace == TJCS_GRAY ? 1 : 3;
+        int pixel_format = std::array{TJPF_GRAY, TJPF_GRAY, TJPF_RGB,
+                                      TJPF_RGBA}[image.channels - 1];
+        image.pixels.resize(size_t(image.width) * image.height * image.channels);
+        tj3Set(tj, TJPARAM_BOTTOMUP, opts.flip);
+        // Truncated files decode with the missing rows gray, like stb_image
+        tj3Set(tj, TJPARAM_STOPONWARNING, 0);
+        int res = tj3Decompress8(tj, jpeg, data.size(), image.pixels.data(), 0, pixel_format);
+        if (res < 0 && tj3GetErrorCode(tj) == TJERR_FATAL)
+            err::error("corrupt JPEG: {}", tj3GetErrorStr(tj));
+        return image;
+    }
+};
+
+#endif // HAS_TURBOJPEG
+
+#ifdef HAS_SPNG
+
+// SIMD unfiltering, and rows written straight to their flipped position. PNG is a
+// single deflate stream, so inflating can't be split across threads.
+class SpngDecoder : public ImageDecoder {
+  public:
+    std::string_view name() const override { return "libspng"; }
+
+    std::optional<DecodedImage> decode(std::span<const std::byte> data,
+                                       const DecodeOpts& opts) const override {
+        static constexpr std::array<uint8_t, 8> SIGNATURE{0x89, 'P',  'N',  'G',
+                                                          '\r', '\n', 0x1a, '\n'};
+        if (!has_signature(data, SIGNATURE))
+            return std::nullopt;
+
+        // zlib's checksum only guards against corruption that the PNG chunk CRCs catch
+        using SpngHandle = Handle<spng_ctx*, functor<spng_ctx_free>>;
+        SpngHandle ctx(spng_ctx_new(SPNG_CTX_IGNORE_ADLER32));
+        err::check(ctx.get(), "spng_ctx_new failed");
+        auto check = [](int res) {
+            err::check(res == 0, "corrupt PNG: {}", spng_strerror(res));
+        };
+        check(spng_set_png_buffer(*ctx, data.data(), data.size()));
+        spng_ihdr ihdr;
+        check(spng_get_ihdr(*ctx, &ihdr));
+        spng_trns trns;
+        bool has_trns = spng_get_trns(*ctx, &trns) == 0;
+
+        bool gray = ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE ||
+                    ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA;
+        bool alpha = has_trns || ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA ||
+                     ihdr.color_type == SPNG_COLOR_TYPE_TRUECOLOR_ALPHA;
+        int channels = opts.channels ? opts.channels : (gray ? 1 : 3) + int(alpha);
+        int format;
+        if (channels == 4)
+            format = SPNG_FMT_RGBA8;
+        else if (channels == 3)
+            format = SPNG_FMT_RGB8;
+        else if (channels == 2 && gray)
+            format = SPNG_FMT_GA8;
+        else if (channels == 1 && ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE &&
+                 ihdr.bit_depth <= 8)
+            format = SPNG_FMT_G8;
+        else
+            // Color to gray, and 16-bit gray to 8, are left to stb_image
+            return std::nullopt;
+
+        DecodedImage image{int(ihdr.width), int(ihdr.height), channels, {}};
+        size_t size;
+        check(spng_decoded_image_size(*ctx, format, &size));
+        size_t stride = size_t(image.width) * channels;
+        err::check(size == stride * image.height, "unexpected PNG size");
+        image.pixels.resize(size);
+
+        check(spng_decode_image(*ctx, nullptr, 0, format,
+                                SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE));
+        int res;
+        do {
+            spng_row_info row_info;
+            res = spng_get_row_info(*ctx, &row_info);
+            if (res)
+                break;
+            size_t row = opts.flip ? image.height - 1 - row_info.row_num : row_info.row_num;
+            res = spng_decode_row(*ctx, image.pixels.data() + row * stride, stride);
+        } while (res == 0);
+        err::check(res == SPNG_EOI, "corrupt PNG: {}", spng_strerror(res));
+        return image;
+    }
+};
+
+#endif // HAS_SPNG
+
+// Fallback for every format stb_image reads
+class StbDecoder : public ImageDecoder {
+  public:
+    std::string_view name() const override { return "stb_image"; }
+
+    std::optional<DecodedImage> decode(std::span<const std::byte> data,
+                                       const DecodeOpts& opts) const override {
+        err::check(data.size() <= INT_MAX, "image is too large");
+        DecodedImage image;
+        stbi_set_flip_vertically_on_load_thread(opts.flip);
+        unsigned char* pixels =
+            stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()),
+                                  int(data.size()), &image.width, &image.height,
+                                  &image.channels, opts.channels);
+        err::check(pixels, "{}", stbi_failure_reason());
+        ScopeGuard free_pixels([&] { stbi_image_free(pixels); });
+        if (opts.channels)
+            image.channels = opts.channels;
+        image.pixels.assign(pixels,
+                            pixels + size_t(image.width) * image.height * image.channels);
+        return image;
+    }
+};
+
+std::mutex decoders_mutex;
+std::vector<std::shared_ptr<const ImageDecoder>> decoders = {
+#ifdef HAS_TURBOJPEG
+    std::make_shared<TurboJpegDecoder>(),
+#endif
+#ifdef HAS_SPNG
+    std::make_shared<SpngDecoder>(),
+#endif
+    std::make_shared<StbDecoder>(),
+};
+
+} // namespace
+
+void register_image_decoder(std::shared_ptr<const ImageDecoder> decoder) {
+    std::lock_guard lock(decoders_mutex);
+    decoders.insert(decoders.begin(), std::move(decoder));
+}
+
+std::vector<std::shared_ptr<const ImageDecoder>> image_decoders() {
+    std::lock_guard lock(decoders_mutex);
+    return decoders;
+}
+
+DecodedImage decode_image(std::span<const std::byte> data, const DecodeOpts& opts) {
+    err::check(opts.channels >= 0 && opts.channels <= 4, "can't decode to {} channels",
+               opts.channels);
+    for (auto& decoder : image_decoders()) {
+        if (auto image = decoder->decode(data, opts))
+            return std::move(*image);
+    }
+    // stb_image never declines
+    err::error("no decoder for this image");
+}
+
+FloatImage decode_float_image(std::span<const std::byte> data, bool flip) {
+    FloatImage image;
+#ifdef HAS_TINYEXR
+    static constexpr std::array<uint8_t, 4> EXR_SIGNATURE{0x76, 0x2f, 0x31, 0x01};
+    if (has_signature(data, EXR_SIGNATURE)) {
+        float* rgba;
+        const char* error = nullptr;
+        int res = LoadEXRFromMemory(&rgba, &image.width, &image.height,
+                                    reinterpret_cast<const unsigned char*>(data.data()),
+                                    data.size(), &error);
+        if (res != TINYEXR_SUCCESS) {
+            std::string message = error ? error : "unknown error";
+            FreeEXRErrorMessage(error);
+            err::error("corrupt EXR: {}", message);
+        }
+        ScopeGuard free_rgba([&] { std::free(rgba); });
+        // Alpha is dropped
+        image.pixels.resize(size_t(image.width) * image.height * 3);
+        for (size_t y = 0; y < size_t(image.height); y++) {
+            size_t src_y = flip ? image.height - 1 - y : y;
+            const float* src = rgba + src_y * image.width * 4;
+            float* dst = image.pixels.data() + y * image.width * 3;
+            for (size_t x = 0; x < size_t(image.width); x++) {
+                for (size_t c = 0; c < 3; c++)
+                    dst[x * 3 + c] = src[x * 4 + c];
+            }
+        }
+        return image;
+    }
+#endif
+
+    err::check(data.size() <= INT_MAX, "image is too large");
+    auto bytes = reinterpret_cast<const stbi_uc*>(data.data());
+    int size = int(data.size()), channels;
+    stbi_set_flip_vertically_on_load_thread(flip);
+    if (stbi_is_16_bit_from_memory(bytes, size)) {
+        stbi_us* pixels = stbi_load_16_from_memory(bytes, size, &image.width, &image.height,
+                                                   &channels, 3);
+        err::check(pixels, "{}", stbi_failure_reason());
+        ScopeGuard free_pixels([&] { stbi_image_free(pixels); });
+        image.pixels.resize(size_t(image.width) * image.height * 3);
+        std::ranges::transform(std::span(pixels, image.pixels.size()), image.pixels.begin(),
+                               [](stbi_us value) { return float(value) / 65535.f; });
+        return image;
+    }
+    // Radiance files come out as stored; 8-bit images through stb's gamma curve
+    float* pixels =
+        stbi_loadf_from_memory(bytes, size, &image.width, &image.height, &channels, 3);
+    err::check(pixels, "{}", stbi_failure_reason());
+    ScopeGuard free_pixels([&] { stbi_image_free(pixels); });
+    image.pixels.assign(pixels, pixels + size_t(image.width) * image.height * 3);
+    return image;
+}
@@ -0,0 +1,55 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// 8 bits per channel image, rows tightly packed
+struct DecodedImage {
+    int width = 0, height = 0, channels = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Linear RGB image, 32-bit float per channel, rows tightly packed
+struct FloatImage {
+    int width = 0, height = 0;
+    std::vector<float> pixels;
+};
+
+struct DecodeOpts {
+    // Channels to decode to, 1-4, or 0 for the image's own. Converting in the decoder
+    // saves a repack pass, e.g. RGB straight to RGBA.
+    int channels = 0;
+    // Bottom row first, as GL expects
+    bool flip = false;
+};
+
+// One image format backend. Implementations must be safe to call from several threads
+// at once.
+class ImageDecoder {
+  public:
+    virtual ~ImageDecoder() = default;
+    virtual std::string_view name() const = 0;
+    // nullopt if data isn't in this decoder's format, or opts asks for a conversion it
+    // can't do, so the next decoder gets a go. Throws if the data is corrupt.
+    virtual std::optional<DecodedImage> decode(std::span<const std::byte> data,
+                                               const DecodeOpts& opts) const = 0;
+};
+
+// Decoders are tried latest registered first, then the built-in ones: libjpeg-turbo and
+// libspng when the build has them, and stb_image, which takes anything left
+void register_image_decoder(std::shared_ptr<const ImageDecoder> decoder);
+// The decoders in the order decode_image tries them
+std::vector<std::shared_ptr<const ImageDecoder>> image_decoders();
+DecodedImage decode_image(std::span<const std::byte> data, const DecodeOpts& opts = {});
+
+// Decodes high dynamic range images: Radiance .hdr, OpenEXR when built with tinyexr, and
+// 16-bit images, which are taken as linear. 8-bit images are linearized with gamma 2.2.
+FloatImage decode_float_image(std::span<const std::byte> data, bool flip = false);
+
+#endif // IMAGE_DECODER_H
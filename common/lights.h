@@ -1,12 +1,59 @@
 #ifndef LIGHTS_H
 #define LIGHTS_H
 
-#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 #include <glm/glm.hpp>
 
 #include "shader.h"
 
+// Distance at which 1 / (constant + linear*d + quadratic*d^2) scaled by intensity drops
+// below cutoff, clamped to max_range. Lights without falloff get max_range.
+inline float attenuation_range(float constant, float linear, float quadratic,
+                               float intensity, float cutoff, float max_range) {
+    float k = intensity / cutoff;
+    if (k <= constant)
+        return 0.0f;
+    float range;
+    if (quadratic > 0) {
+        float disc = linear * linear - 4 * quadratic * (constant - k);
+        range = (-linear + std::sqrt(disc)) / (2 * quadratic);
+    } else if (linear > 0) {
+        range = (k - constant) / linear;
+    } else {
+        range = max_range;
+    }
+    return std::min(range, max_range);
+}
+
+// Cascaded shadow map settings for a DirLight, rendered by CascadedShadowMap
+struct DirShadow {
+    bool enabled = false;
+    // Shadowed view depth range is split into up to MAX_CASCADES cascades, one layer of
+    // resolution^2 depth texels each
+    uint32_t cascades = 4;
+    uint32_t resolution = 2048;
+    float max_distance = 50.f;
+    // Blend between uniform (0) and logarithmic (1) split distances
+    float split_lambda = 0.8f;
+    // Receivers are offset along their normal by normal_bias texels, and compared
+    // against depth_bias less than their depth
+    float normal_bias = 1.5f;
+    float depth_bias = 0.0005f;
+    // Casters are rendered with slope-scaled depth offset
+    float slope_bias = 2.f;
+    // PCF kernel of (2 * pcf_radius + 1)^2 filtered taps
+    int pcf_radius = 1;
+    // Shadow draw calls per frame across all cascades, nearest cascade first
+    size_t max_draws = 4096;
+
+    static constexpr uint32_t MAX_CASCADES = 4;
+};
+
 struct DirLight {
     glm::vec3 direction{0, -1, 0};
 
@@ -14,7 +61,9 @@ struct DirLight {
     glm::vec3 diffuse{1};
     glm::vec3 specular = diffuse;
 
-    void apply(const Shader& shader, const std::string& name) const;
+    DirShadow shadow{};
+
+    void apply(const Shader& shader, std::string_view name) const;
 };
 
 struct PointLight {
@@ -28,7 +77,15 @@ struct PointLight {
     glm::vec3 diffuse{1};
     glm::vec3 specular = diffuse;
 
-    void apply(const Shader& shader, const std::string& name) const;
+    void apply(const Shader& shader, std::string_view name) const;
+    // Radius of influence for light culling. Ambient light is not attenuated by the
+    // shader, so it is ignored beyond this range.
+    float range(float cutoff = 1.0f / 256.0f, float max_range = 1000.0f) const {
+        float intensity = std::max({diffuse.r, diffuse.g, diffuse.b,
+                                    specular.r, specular.g, specular.b});
+        return attenuation_range(constant, linear, quadratic, intensity, cutoff,
+                                 max_range);
+    }
 };
 
 struct SpotLight {
@@ -45,37 +102,47 @@ struct SpotLight {
     glm::vec3 diffuse{1};
     glm::vec3 specular = diffuse;
 
-    void apply(const Shader& shader, const std::string& name) const;
+    void apply(const Shader& shader, std::string_view name) const;
+    // Radius of influence for light culling, see PointLight::range
+    float range(float cutoff = 1.0f / 256.0f, float max_range = 1000.0f) const {
+        float intensity = std::max({diffuse.r, diffuse.g, diffuse.b,
+                                    specular.r, specular.g, specular.b});
+        return attenuation_range(constant, linear, quadratic, intensity, cutoff,
+                                 max_range);
+    }
 };
 
-inline void DirLight::apply(const Shader& shader, const std::string& name) const {
-    shader.set_vec3(name + ".direction", direction);
-    shader.set_vec3(name + ".ambient", ambient);
-    shader.set_vec3(name + ".diffuse", diffuse);
-    shader.set_vec3(name + ".specular", specular);
+inline void DirLight::apply(const Shader& shader, std::string_view name) const {
+    UniformName uniform(name);
+    shader.set_vec3(uniform(".direction"), direction);
+    shader.set_vec3(uniform(".ambient"), ambient);
+    shader.set_vec3(uniform(".diffuse"), diffuse);
+    shader.set_vec3(uniform(".specular"), specular);
 }
 
-inline void PointLight::apply(const Shader& shader, const std::string& name) const {
-    shader.set_vec3(name + ".position", position);
-    shader.set_float(name + ".constant", constant);
-    shader.set_float(name + ".linear", linear);
-    shader.set_float(name + ".quadratic", quadratic);
-    shader.set_vec3(name + ".ambient", ambient);
-    shader.set_vec3(name + ".diffuse", diffuse);
-    shader.set_vec3(name + ".specular", specular);
+inline void PointLight::apply(const Shader& shader, std::string_view name) const {
+    UniformName uniform(name);
+    shader.set_vec3(uniform(".position"), position);
+    shader.set_float(uniform(".constant"), constant);
+    shader.set_float(uniform(".linear"), linear);
+    shader.set_float(uniform(".quadratic"), quadratic);
+    shader.set_vec3(uniform(".ambient"), ambient);
+    shader.set_vec3(uniform(".diffuse"), diffuse);
+    shader.set_vec3(uniform(".specular"), specular);
 }
 
-inline void SpotLight::apply(const Shader& shader, const std::string& name) const {
-    shader.set_vec3(name + ".position", position);
-    shader.set_vec3(name + ".direction", direction);
-    shader.set_float(name + ".inner_cutoff", innerCutoff);
-    shader.set_float(name + ".outer_cutoff", outerCutoff);
-    shader.set_float(name + ".constant", constant);
-    shader.set_float(name + ".linear", linear);
-    shader.set_float(name + ".quadratic", quadratic);
-    shader.set_vec3(name + ".ambient", ambient);
-    shader.set_vec3(name + ".diffuse", diffuse);
-    shader.set_vec3(name + ".specular", specular);
+inline void SpotLight::apply(const Shader& shader, std::string_view name) const {
+    UniformName uniform(name);
+    shader.set_vec3(uniform(".position"), position);
+    shader.set_vec3(uniform(".direction"), direction);
+    shader.set_float(uniform(".inner_cutoff"), innerCutoff);
+    shader.set_float(uniform(".outer_cutoff"), outerCutoff);
+    shader.set_float(uniform(".constant"), constant);
+    shader.set_float(uniform(".linear"), linear);
+    shader.set_float(uniform(".quadratic"), quadratic);
+    shader.set_vec3(uniform(".ambient"), ambient);
+    shader.set_vec3(uniform(".diffuse"), diffuse);
+    shader.set_vec3(uniform(".specular"), specular);
 }
 
 #endif // LIGHTS_H
@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+
+#include <string>
+#include <system_error>
+
+#include "errutils.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+
+namespace {
+
+template <typename T>
+T check_win(T val, std::string_view what, const fs::path& path) {
+    if (!val) {
+        std::string msg = std::system_category().message(int(GetLastError()));
+        err::error("{} {}: {}", what, path.string(), msg);
+    }
+    return val;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const fs::path& path, Access access) {
+    DWORD flags = access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                                               : FILE_FLAG_RANDOM_ACCESS;
+    // Sharing delete access lets a writer rename a new file over this one while it is
+    // mapped, as write_pack does
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, flags, nullptr);
+    check_win(file != INVALID_HANDLE_VALUE, "failed to open file", path);
+    ScopeGuard close_file([&] { CloseHandle(file); });
+    LARGE_INTEGER size;
+    check_win(GetFileSizeEx(file, &size), "failed to stat file", path);
+    if (size.QuadPart == 0)
+        return;
+
+    // The view keeps the mapping alive once its handle is closed
+    HANDLE mapping = check_win(CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr),
+                               "failed to map file", path);
+    ScopeGuard close_mapping([&] { CloseHandle(mapping); });
+    void* data = check_win(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0),
+                           "failed to map file", path);
+    size_ = size_t(size.QuadPart);
+    mapping_ = Handle<const std::byte*, Unmapper>(static_cast<const std::byte*>(data),
+                                                  Unmapper{size_});
+    if (access == Access::Sequential)
+        prefetch(0, size_);
+}
+
+void MappedFile::Unmapper::operator()(const std::byte* data) const {
+    UnmapViewOfFile(data);
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+    auto range = bytes(offset, length);
+    if (range.empty())
+        return;
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY entry{const_cast<std::byte*>(range.data()), range.size()};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+#endif
+}
+
+#else
+
+MappedFile::MappedFile(const fs::path& path, Access access) {
+    int fd = err::check_posix(open(path.c_str(), O_RDONLY | O_CLOEXEC),
+                              "failed to open file {}: {}", path.string());
+    ScopeGuard close_fd([&] { close(fd); });
+    struct stat st;
+    err::check_posix(fstat(fd, &st), "failed to stat file {}: {}", path.string());
+    if (st.st_size == 0)
+        return;
+
+    // The mapping holds its own reference to the file once fd is closed
+    size_t size = size_t(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    err::check_errno(data != MAP_FAILED, "failed to map file {}: {}", path.string());
+    size_ = size;
+    mapping_ = Handle<const std::byte*, Unmapper>(static_cast<const std::byte*>(data),
+                                                  Unmapper{size_});
+    // Sequential doubles the read-ahead window and drops pages behind the reader
+    madvise(data, size_, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    if (access == Access::Sequential)
+        prefetch(0, size_);
+}
+
+void MappedFile::Unmapper::operator()(const std::byte* data) const {
+    munmap(const_cast<std::byte*>(data), size);
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+    auto range = bytes(offset, length);
+    if (range.empty())
+        return;
+    // madvise ranges start on a page boundary
+    static const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page_size * page_size;
+    madvise(const_cast<std::byte*>(data() + begin), offset + length - begin,
+            MADV_WILLNEED);
+}
+
+#endif
+
+std::span<const std::byte> MappedFile::bytes(size_t offset, size_t length) const {
+    err::check(offset <= size_ && length <= size_ - offset,
+               "bytes {}+{} are out of range of a {} byte file", offset, length, size_);
+    return {data() + offset, length};
+}
@@ -0,0 +1,61 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "raii.h"
+
+// Read-only memory mapping of a whole file. Reading through the mapping skips the
+// stream buffers and the copies and allocations that come with them: pages are faulted
+// in as they are touched, and access hints let the kernel read ahead. The file must not
+// be truncated while mapped; editors that save by renaming a new file are fine.
+class MappedFile {
+  public:
+    // How the file will be read, to tune read-ahead
+    enum class Access {
+        // Front to back, all of it, e.g. decoding an image. Reading ahead starts at
+        // once.
+        Sequential,
+        // Scattered reads, e.g. pages of a streamed texture
+        Random,
+    };
+
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path,
+                        Access access = Access::Sequential);
+    MappedFile(MappedFile&& other) noexcept
+        : mapping_(std::move(other.mapping_)), size_(std::exchange(other.size_, 0)) {}
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        mapping_ = std::move(other.mapping_);
+        size_ = std::exchange(other.size_, 0);
+        return *this;
+    }
+
+    const std::byte* data() const { return mapping_.get(); }
+    size_t size() const { return size_; }
+    std::span<const std::byte> bytes() const { return {data(), size_}; }
+    // Bytes [offset, offset + length), which must lie within the file
+    std::span<const std::byte> bytes(size_t offset, size_t length) const;
+    std::string_view text() const {
+        return {reinterpret_cast<const char*>(data()), size_};
+    }
+
+    // Starts reading bytes [offset, offset + length) into memory in the background, so
+    // touching them later doesn't block on the disk. Best effort.
+    void prefetch(size_t offset, size_t length) const;
+
+  private:
+    struct Unmapper {
+        size_t size = 0;
+        void operator()(const std::byte* data) const;
+    };
+
+    Handle<const std::byte*, Unmapper> mapping_;
+    size_t size_ = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -1,25 +1,66 @@
 #include "material.h"
 
+#include <string>
+#include <string_view>
+#include <utility>
+
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/io.hpp>
 
 namespace {
 
-void apply_texture(const Texture& texture, const Shader& shader, const std::string& name,
+void apply_texture(const Texture& texture, const Shader& shader, std::string_view name,
                    unsigned int unit) {
     texture.bind(unit);
-    shader.set_int(name + ".texture", unit);
-    shader.set_bool(name + ".bound", !texture.empty());
+    UniformName uniform(name);
+    shader.set_int(uniform(".texture"), int(unit));
+    shader.set_bool(uniform(".bound"), !texture.empty());
 }
 
 } // namespace
 
+ShaderDefines material_feature_defines(unsigned int features) {
+    static constexpr std::pair<MaterialFeature, const char*> feature_names[] = {
+        {FEATURE_DIFFUSE_TEXTURE, "HAS_DIFFUSE_TEXTURE"},
+        {FEATURE_SPECULAR_TEXTURE, "HAS_SPECULAR_TEXTURE"},
+        {FEATURE_AMBIENT_TEXTURE, "HAS_AMBIENT_TEXTURE"},
+        {FEATURE_EMISSIVE_TEXTURE, "HAS_EMISSIVE_TEXTURE"},
+        {FEATURE_AO_TEXTURE, "HAS_AO_TEXTURE"},
+        {FEATURE_NORMAL_TEXTURE, "HAS_NORMAL_TEXTURE"},
+        {FEATURE_SPECULAR, "HAS_SPECULAR"},
+        {FEATURE_PBR, "HAS_PBR"},
+        {FEATURE_ORM_TEXTURE, "HAS_ORM_TEXTURE"},
+    };
+    ShaderDefines defines{{"MATERIAL_FEATURES", std::to_string(features)}};
+    for (auto [feature, name] : feature_names) {
+        if (features & feature)
+            defines.emplace_back(name, "1");
+    }
+    return defines;
+}
+
+void Material::update_features() {
+    features = 0;
+    if (diffuse_texture) features |= FEATURE_DIFFUSE_TEXTURE;
+    if (specular_texture) features |= FEATURE_SPECULAR_TEXTURE;
+    if (ambient_texture) features |= FEATURE_AMBIENT_TEXTURE;
+    if (emissive_texture) features |= FEATURE_EMISSIVE_TEXTURE;
+    if (ao_texture) features |= FEATURE_AO_TEXTURE;
+    if (normal_texture) features |= FEATURE_NORMAL_TEXTURE;
+    if (pbr) features |= FEATURE_PBR;
+    if (orm_texture) features |= FEATURE_ORM_TEXTURE;
+    if (shininess > 0.0f && specular_color != glm::vec3(0.0f))
+        features |= FEATURE_SPECULAR;
+}
+
 void Material::apply(const Shader& shader) const {
     shader.set_float("material.shininess", shininess);
     shader.set_vec3("material.diffuse_color", diffuse_color);
     shader.set_vec3("material.specular_color", specular_color);
     shader.set_vec3("material.ambient_color", ambient_color);
     shader.set_vec3("material.emissive_color", emissive_color);
+    shader.set_float("material.metallic", metallic);
+    shader.set_float("material.roughness", roughness);
 
     apply_texture(diffuse_texture, shader, "material.diffuse_texture", 0);
     apply_texture(specular_texture, shader, "material.specular_texture", 1);
@@ -27,6 +68,7 @@ void Material::apply(const Shader& shader) const {
     apply_texture(emissive_texture, shader, "material.emissive_texture", 3);
     apply_texture(ao_texture, shader, "material.ao_texture", 4);
     apply_texture(normal_texture, shader, "material.normal_texture", 5);
+    apply_texture(orm_texture, shader, "material.orm_texture", 6);
 }
 
 std::ostream& operator<<(std::ostream& os, const Material& mat) {
@@ -42,5 +84,10 @@ std::ostream& operator<<(std::ostream& os, const Material& mat) {
     os << "emissive_texture: " << mat.emissive_texture << '\n';
     os << "ao_texture: " << mat.ao_texture << '\n';
     os << "normal_texture: " << mat.normal_texture << '\n';
+    os << "pbr: " << mat.pbr << '\n';
+    os << "metallic: " << mat.metallic << '\n';
+    os << "roughness: " << mat.roughness << '\n';
+    os << "orm_texture: " << mat.orm_texture << '\n';
+    os << "features: " << mat.features << '\n';
     return os;
 }
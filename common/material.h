@@ -8,6 +8,24 @@
 #include "shader.h"
 #include "texture.h"
 
+// Feature bits used to select a shader permutation for a material
+enum MaterialFeature : unsigned int {
+    FEATURE_DIFFUSE_TEXTURE = 1 << 0,
+    FEATURE_SPECULAR_TEXTURE = 1 << 1,
+    FEATURE_AMBIENT_TEXTURE = 1 << 2,
+    FEATURE_EMISSIVE_TEXTURE = 1 << 3,
+    FEATURE_AO_TEXTURE = 1 << 4,
+    FEATURE_NORMAL_TEXTURE = 1 << 5,
+    FEATURE_SPECULAR = 1 << 6,
+    FEATURE_PBR = 1 << 7,
+    FEATURE_ORM_TEXTURE = 1 << 8,
+};
+
+// Shader defines for a feature bitmask, e.g. FEATURE_DIFFUSE_TEXTURE ->
+// #define HAS_DIFFUSE_TEXTURE 1. Always defines MATERIAL_FEATURES so shaders can tell
+// permuted builds apart from runtime-branching ones.
+ShaderDefines material_feature_defines(unsigned int features);
+
 struct Material {
     // Properties
     std::string name;
@@ -22,9 +40,22 @@ struct Material {
     Texture emissive_texture;
     Texture ao_texture;
     Texture normal_texture;
+    // Metallic-roughness model, shaded instead of the Phong terms when set. The base
+    // color is diffuse_color times diffuse_texture; the Phong terms are kept for shaders
+    // without a PBR path.
+    bool pbr = false;
+    float metallic = 1.0f;
+    float roughness = 1.0f;
+    // Occlusion, roughness and metallic in R, G and B; the last two scale the factors
+    Texture orm_texture;
+    // Bitmask of MaterialFeature, cached by update_features()
+    unsigned int features = 0;
 
     // Methods
     void apply(const Shader& shader) const;
+    // Recomputes features from the current properties. Call after loading or
+    // changing textures.
+    void update_features();
 };
 
 std::ostream& operator<<(std::ostream& os, const Material& mat);
@@ -0,0 +1,170 @@
+#include "material_table.h"
+
+#include <algorithm>
+
+#include "errutils.h"
+
+bool MaterialTable::bindless_supported() {
+#ifdef GL_ARB_bindless_texture
+    return GLAD_GL_ARB_bindless_texture;
+#else
+    return false;
+#endif
+}
+
+MaterialTable::MaterialTable(std::span<const std::shared_ptr<Material>> materials,
+                             bool bindless, const TextureAtlas* atlas)
+    : bindless_(bindless && bindless_supported()), atlas_(atlas) {
+    std::vector<GpuMaterial> entries;
+    entries.reserve(materials.size());
+    for (auto& material : materials) {
+        if (!material || indices_.contains(material.get()))
+            continue;
+        indices_.emplace(material.get(), uint32_t(entries.size()));
+        entries.push_back({
+            .diffuse_texture = texture_entry(material->diffuse_texture),
+            .specular_texture = texture_entry(material->specular_texture),
+            .emissive_texture = texture_entry(material->emissive_texture),
+            .ao_texture = texture_entry(material->ao_texture),
+            .orm_texture = texture_entry(material->orm_texture),
+            .normal_texture = texture_entry(material->normal_texture),
+            .ambient_color = material->ambient_color,
+            .metallic = material->metallic,
+            .diffuse_color = material->diffuse_color,
+            .roughness = material->roughness,
+            .specular_color = material->specular_color,
+            .emissive_color = material->emissive_color,
+            .shininess = material->shininess,
+        });
+    }
+    if (!bindless_)
+        build_arrays();
+    if (entries.empty())
+        entries.emplace_back();
+    buffer_ = make_buffer(std::span<const GpuMaterial>(entries));
+}
+
+MaterialTable::~MaterialTable() {
+#ifdef GL_ARB_bindless_texture
+    for (auto [texture, handle] : handles_)
+        glMakeTextureHandleNonResidentARB(handle);
+#endif
+}
+
+MaterialTable::GpuTexture MaterialTable::texture_entry(const Texture& texture) {
+    if (texture.empty())
+        return {};
+    if (atlas_ && !texture.filename().empty()) {
+        if (auto region = atlas_->find(texture.filename()))
+            return atlas_entry(*region);
+    }
+    if (!bindless_)
+        return array_entry(texture.id());
+    return {bindless_handle(texture.id()), NO_LAYER, 1};
+}
+
+MaterialTable::GpuTexture MaterialTable::atlas_entry(const TextureAtlas::Region& region) {
+    GLuint array = atlas_->array(region.group);
+    if (bindless_)
+        return {bindless_handle(array), uint32_t(region.layer), 1, region.rect};
+    auto [it, inserted] = atlas_units_.try_emplace(array, uint32_t(units_.size()));
+    if (inserted) {
+        err::check(units_.size() < MAX_TEXTURE_ARRAYS,
+                   "material textures need more than {} texture arrays", MAX_TEXTURE_ARRAYS);
+        units_.push_back(array);
+    }
+    return {it->second, uint32_t(region.layer), 1, region.rect};
+}
+
+uint64_t MaterialTable::bindless_handle(GLuint texture) {
+#ifdef GL_ARB_bindless_texture
+    auto [it, inserted] = handles_.try_emplace(texture);
+    if (inserted) {
+        // Freezes the texture's sampler state
+        it->second = glGetTextureHandleARB(texture);
+        err::check(it->second, "failed to get bindless handle of texture {}", texture);
+        glMakeTextureHandleResidentARB(it->second);
+    }
+    return it->second;
+#else
+    return 0;
+#endif
+}
+
+MaterialTable::GpuTexture MaterialTable::array_entry(GLuint texture) {
+    ArrayKey key{};
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &key.width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &key.height);
+    GLint format;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    key.format = GLenum(format);
+    // Mutable textures report no immutable levels, so count the allocated ones
+    for (GLint width = key.width; width > 0 && key.levels < 32; key.levels++) {
+        glGetTextureLevelParameteriv(texture, key.levels + 1, GL_TEXTURE_WIDTH, &width);
+    }
+
+    size_t array = std::ranges::find(array_keys_, key) - array_keys_.begin();
+    if (array == array_keys_.size()) {
+        err::check(units_.size() < MAX_TEXTURE_ARRAYS,
+                   "material textures need more than {} texture arrays", MAX_TEXTURE_ARRAYS);
+        array_keys_.push_back(key);
+        array_units_.push_back(units_.size());
+        array_layers_.emplace_back();
+        // Filled in by build_arrays()
+        units_.push_back(0);
+    }
+    auto& layers = array_layers_[array];
+    size_t layer = std::ranges::find(layers, texture) - layers.begin();
+    if (layer == layers.size())
+        layers.push_back(texture);
+    return {uint64_t(array_units_[array]), uint32_t(layer), 1};
+}
+
+void MaterialTable::build_arrays() {
+    for (size_t i = 0; i < array_keys_.size(); i++) {
+        const ArrayKey& key = array_keys_[i];
+        auto& layers = array_layers_[i];
+        TextureHandle& array = arrays_.emplace_back();
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array.reset_as_ref());
+        units_[array_units_[i]] = *array;
+        glTextureStorage3D(*array, key.levels, key.format, key.width, key.height,
+                           GLsizei(layers.size()));
+        glTextureParameteri(*array, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(*array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(*array, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(*array, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameterf(*array, GL_TEXTURE_MAX_ANISOTROPY, TextureOpts{}.anisotropy);
+        // GPU-side copies of every level, so no pixel data has to be kept around
+        for (size_t layer = 0; layer < layers.size(); layer++) {
+            for (GLint level = 0; level < key.levels; level++) {
+                GLsizei w = std::max(key.width >> level, 1);
+                GLsizei h = std::max(key.height >> level, 1);
+                glCopyImageSubData(layers[layer], GL_TEXTURE_2D, level, 0, 0, 0, *array,
+                                   GL_TEXTURE_2D_ARRAY, level, 0, 0, GLint(layer), w, h, 1);
+            }
+        }
+    }
+    array_layers_.clear();
+}
+
+uint32_t MaterialTable::index(const Material* material) const {
+    auto it = indices_.find(material);
+    err::check(it != indices_.end(), "material is not in the table");
+    return it->second;
+}
+
+void MaterialTable::bind(const Shader& shader) const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, *buffer_);
+    for (size_t i = 0; i < units_.size(); i++) {
+        glBindTextureUnit(GLuint(i), units_[i]);
+        UniformName name("materialArrays[{}]", i);
+        shader.set_int(name(""), int(i));
+    }
+}
+
+ShaderDefines MaterialTable::defines() const {
+    ShaderDefines defines{{"MATERIAL_TABLE", "1"}};
+    if (bindless_)
+        defines.emplace_back("BINDLESS_TEXTURES", "1");
+    return defines;
+}
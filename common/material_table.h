@@ -0,0 +1,117 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_resources.h"
+#include "material.h"
+#include "shader.h"
+#include "texture.h"
+#include "texture_atlas.h"
+
+// All materials of a scene in one SSBO, so draws select a material with an index
+// instead of binding its textures. With GL_ARB_bindless_texture the entries hold
+// resident 64-bit texture handles. Without it, textures of the same size, format and
+// level count are copied into shared texture arrays and entries hold (array, layer)
+// pairs. Textures found in a TextureAtlas reference their atlas layer and rectangle
+// instead. Shaders opt in with defines() and pick an entry with the materialIndex
+// uniform; see the MATERIAL_TABLE path of resources/shaders/material.glsl.
+//
+// The table only reads the materials when it is built. With bindless, their textures
+// and the atlas must outlive it.
+class MaterialTable {
+  public:
+    static constexpr GLuint BINDING = 7;
+    // Texture units used by the array fallback, starting at 0
+    static constexpr int MAX_TEXTURE_ARRAYS = 8;
+
+    static bool bindless_supported();
+
+    explicit MaterialTable(std::span<const std::shared_ptr<Material>> materials,
+                           bool bindless = bindless_supported(),
+                           const TextureAtlas* atlas = nullptr);
+    ~MaterialTable();
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // Position of material in the table; must be one it was built from
+    uint32_t index(const Material* material) const;
+
+    // Binds the table (and the fallback texture arrays) for the active shader. Once per
+    // program; per draw only materialIndex changes.
+    void bind(const Shader& shader) const;
+    // Selects the material of the next draws
+    void select(const Shader& shader, const Material* material) const {
+        shader.set_uint("materialIndex", index(material));
+    }
+
+    ShaderDefines defines() const;
+    bool bindless() const { return bindless_; }
+    size_t size() const { return indices_.size(); }
+
+  private:
+    // std430 layout of MaterialEntry in material.glsl
+    struct GpuTexture {
+        // Bindless handle, or the texture array index in the low word
+        uint64_t handle;
+        // Array layer; NO_LAYER for bindless 2D textures
+        uint32_t layer;
+        uint32_t bound;
+        // Atlas rectangle as uv offset and scale
+        glm::vec4 rect{0, 0, 1, 1};
+    };
+    struct GpuMaterial {
+        GpuTexture diffuse_texture, specular_texture, emissive_texture, ao_texture,
+            orm_texture, normal_texture;
+        glm::vec3 ambient_color;
+        float metallic;
+        glm::vec3 diffuse_color;
+        float roughness;
+        glm::vec3 specular_color;
+        float pad2 = 0;
+        glm::vec3 emissive_color;
+        float shininess;
+    };
+    static_assert(sizeof(GpuTexture) == 32 && sizeof(GpuMaterial) == 256);
+    static constexpr uint32_t NO_LAYER = ~0u;
+
+    // Size, format and level count; textures sharing these share an array
+    struct ArrayKey {
+        GLint width, height, levels;
+        GLenum format;
+        bool operator==(const ArrayKey&) const = default;
+    };
+
+    GpuTexture texture_entry(const Texture& texture);
+    GpuTexture array_entry(GLuint texture);
+    GpuTexture atlas_entry(const TextureAtlas::Region& region);
+    uint64_t bindless_handle(GLuint texture);
+    void build_arrays();
+
+    bool bindless_;
+    const TextureAtlas* atlas_;
+    BufferHandle buffer_;
+    std::unordered_map<const Material*, uint32_t> indices_;
+
+    // Bindless: resident handles by texture id
+    std::unordered_map<GLuint, uint64_t> handles_;
+
+    // Fallback: the arrays bound to units 0 and up. Copies of source textures are
+    // grouped by key while building entries and made once all are known; atlas arrays
+    // are used as they are.
+    std::vector<GLuint> units_;
+    std::vector<ArrayKey> array_keys_;
+    std::vector<size_t> array_units_;
+    std::vector<std::vector<GLuint>> array_layers_;
+    std::vector<TextureHandle> arrays_;
+    std::unordered_map<GLuint, uint32_t> atlas_units_;
+};
+
+#endif // MATERIAL_TABLE_H
@@ -1,33 +1,63 @@
 #include "mesh.h"
 
-#include <cstddef>
+#include <algorithm>
 #include <utility>
+#include <vector>
+
+#include "errutils.h"
 
 Mesh::Mesh(std::string_view name, std::span<const Vertex> vertices,
            std::span<const unsigned int> indices, std::shared_ptr<Material> material)
-    : name_(name), num_indices_(GLsizei(indices.size())), material_(std::move(material)) {
-    glGenVertexArrays(1, &vao_.reset_as_ref());
-    glGenBuffers(1, &vbo_.reset_as_ref());
-    glGenBuffers(1, &ebo_.reset_as_ref());
+    : name_(name), num_indices_(GLsizei(indices.size())),
+      num_vertices_(GLsizei(vertices.size())), material_(std::move(material)) {
+    vbo_ = make_buffer(vertices);
+    ebo_ = make_buffer(indices);
+    vao_ = make_vertex_array(*vbo_, sizeof(Vertex), VERTEX_ATTRIBS, *ebo_);
 
-    glBindVertexArray(*vao_);
-    glBindBuffer(GL_ARRAY_BUFFER, *vbo_);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *ebo_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
-                 GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(Attr::POSITION);
-    glVertexAttribPointer(Attr::POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          reinterpret_cast<void*>(offsetof(Vertex, position)));
-    glEnableVertexAttribArray(Attr::NORMAL);
-    glVertexAttribPointer(Attr::NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          reinterpret_cast<void*>(offsetof(Vertex, normal)));
-    glEnableVertexAttribArray(Attr::TEX_COORDS);
-    glVertexAttribPointer(Attr::TEX_COORDS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          reinterpret_cast<void*>(offsetof(Vertex, tex_coords)));
-
-    glBindVertexArray(0);
+    // Position-only stream for depth passes
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (auto& vertex : vertices) {
+        positions.push_back(vertex.position);
+        bounds_.expand(vertex.position);
+    }
+    position_vbo_ = make_buffer(std::span<const glm::vec3>(positions));
+    const VertexAttrib position_attrib[] = {{Attr::POSITION, 3, GL_FLOAT, 0}};
+    depth_vao_ = make_vertex_array(*position_vbo_, sizeof(glm::vec3), position_attrib, *ebo_);
+}
+
+Mesh::Mesh(std::string_view name, size_t num_vertices, size_t num_indices,
+           util::function_ref<void(std::span<Vertex>, std::span<unsigned int>)> write,
+           const Bounds& bounds, std::shared_ptr<Material> material)
+    : name_(name), num_indices_(GLsizei(num_indices)), num_vertices_(GLsizei(num_vertices)),
+      bounds_(bounds), material_(std::move(material)) {
+    if (!has_dsa()) {
+        std::vector<Vertex> vertices(num_vertices);
+        std::vector<unsigned int> indices(num_indices);
+        write(vertices, indices);
+        *this = Mesh(name, vertices, indices, std::move(material_));
+        return;
+    }
+
+    auto map = [](BufferHandle& buffer, size_t size) {
+        // Zero-sized storage is an error, as in make_buffer
+        size = std::max<size_t>(size, 1);
+        glCreateBuffers(1, &buffer.reset_as_ref());
+        glNamedBufferStorage(*buffer, GLsizeiptr(size), nullptr, GL_MAP_WRITE_BIT);
+        void* data = glMapNamedBufferRange(*buffer, 0, GLsizeiptr(size),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        return err::check(data, "failed to map mesh buffer");
+    };
+    auto* vertices = static_cast<Vertex*>(map(vbo_, num_vertices * sizeof(Vertex)));
+    auto* indices = static_cast<unsigned int*>(map(ebo_, num_indices * sizeof(unsigned int)));
+    write({vertices, num_vertices}, {indices, num_indices});
+    glUnmapNamedBuffer(*vbo_);
+    glUnmapNamedBuffer(*ebo_);
+
+    vao_ = make_vertex_array(*vbo_, sizeof(Vertex), VERTEX_ATTRIBS, *ebo_);
+    const VertexAttrib position_attrib[] = {
+        {Attr::POSITION, 3, GL_FLOAT, offsetof(Vertex, position)}};
+    depth_vao_ = make_vertex_array(*vbo_, sizeof(Vertex), position_attrib, *ebo_);
 }
 
 void Mesh::draw(const Shader* shader) const {
@@ -35,3 +65,8 @@ void Mesh::draw(const Shader* shader) const {
     glBindVertexArray(*vao_);
     glDrawElements(GL_TRIANGLES, num_indices_, GL_UNSIGNED_INT, 0);
 }
+
+void Mesh::draw_depth() const {
+    glBindVertexArray(*depth_vao_);
+    glDrawElements(GL_TRIANGLES, num_indices_, GL_UNSIGNED_INT, 0);
+}
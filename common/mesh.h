@@ -1,30 +1,44 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "bounds.h"
+#include "gl_resources.h"
 #include "material.h"
 #include "raii.h"
 #include "shader.h"
-
-using VaoHandle = Handle<GLuint, gl_delete_array_functor<glDeleteVertexArrays>>;
-using BufferHandle = Handle<GLuint, gl_delete_array_functor<glDeleteBuffers>>;
+#include "utils.h"
 
 enum Attr {
     POSITION = 0,
     NORMAL = 1,
     TEX_COORDS = 2,
+    TANGENT = 3,
 };
 
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 tex_coords;
+    // Tangent and bitangent sign packed by pack_tangent (tangents.h)
+    uint32_t tangent = 0;
+};
+
+// Attribute layout of Vertex, for make_vertex_array
+inline constexpr VertexAttrib VERTEX_ATTRIBS[] = {
+    {Attr::POSITION, 3, GL_FLOAT, offsetof(Vertex, position)},
+    {Attr::NORMAL, 3, GL_FLOAT, offsetof(Vertex, normal)},
+    {Attr::TEX_COORDS, 2, GL_FLOAT, offsetof(Vertex, tex_coords)},
+    {Attr::TANGENT, 1, GL_UNSIGNED_INT, offsetof(Vertex, tangent), GL_FALSE, true},
 };
 
 class Mesh {
@@ -35,12 +49,24 @@ class Mesh {
     Mesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
          std::shared_ptr<Material> material = nullptr)
         : Mesh("", vertices, indices, std::move(material)) {}
+    // Creates a mesh whose buffers are filled in place by write. With DSA it writes
+    // through a mapping of the GL buffers, so generated meshes skip the CPU-side copy,
+    // and depth passes read positions from the full vertex buffer. bounds must contain
+    // every vertex.
+    Mesh(std::string_view name, size_t num_vertices, size_t num_indices,
+         util::function_ref<void(std::span<Vertex>, std::span<unsigned int>)> write,
+         const Bounds& bounds, std::shared_ptr<Material> material = nullptr);
     void draw(const Shader* shader = nullptr) const;
+    // Draws from the position-only vertex stream, for depth-only passes
+    void draw_depth() const;
     const std::string& name() const { return name_; }
+    const Bounds& bounds() const { return bounds_; }
     GLuint vao() const { return vao_.get(); };
     GLuint vbo() const { return vbo_.get(); };
     GLuint ebo() const { return ebo_.get(); };
+    GLuint depth_vao() const { return depth_vao_.get(); };
     GLsizei num_indices() const { return num_indices_; };
+    GLsizei num_vertices() const { return num_vertices_; };
     const std::shared_ptr<Material>& material() const { return material_; }
     void set_material(std::shared_ptr<Material> material) {
         material_ = std::move(material);
@@ -50,7 +76,12 @@ class Mesh {
     std::string name_;
     VaoHandle vao_;
     BufferHandle vbo_, ebo_;
-    GLsizei num_indices_;
+    // Tightly packed positions sharing ebo_, so depth-only passes fetch 12 bytes per
+    // vertex instead of a full Vertex
+    VaoHandle depth_vao_;
+    BufferHandle position_vbo_;
+    GLsizei num_indices_, num_vertices_;
+    Bounds bounds_;
     std::shared_ptr<Material> material_;
 };
 
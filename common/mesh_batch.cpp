@@ -0,0 +1,66 @@
+#include "mesh_batch.h"
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+MeshBatch::MeshBatch(const Model& model) {
+    std::vector<const Mesh*> meshes;
+    for (auto& mesh : model.meshes())
+        meshes.push_back(mesh.get());
+    std::ranges::stable_sort(meshes, {}, [](const Mesh* m) { return m->material().get(); });
+
+    GLsizeiptr num_vertices = 0, num_indices = 0;
+    for (auto* mesh : meshes) {
+        num_vertices += mesh->num_vertices();
+        num_indices += mesh->num_indices();
+    }
+    glCreateBuffers(1, &vbo_.reset_as_ref());
+    glCreateBuffers(1, &ebo_.reset_as_ref());
+    glNamedBufferStorage(*vbo_, std::max<GLsizeiptr>(num_vertices, 1) * sizeof(Vertex),
+                         nullptr, 0);
+    glNamedBufferStorage(*ebo_, std::max<GLsizeiptr>(num_indices, 1) * sizeof(GLuint),
+                         nullptr, 0);
+
+    // Copy the already uploaded mesh data GPU-side
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<glm::vec4> packed_bounds;
+    GLuint first_vertex = 0, first_index = 0;
+    for (auto* mesh : meshes) {
+        glCopyNamedBufferSubData(mesh->vbo(), *vbo_, 0, first_vertex * sizeof(Vertex),
+                                 mesh->num_vertices() * sizeof(Vertex));
+        glCopyNamedBufferSubData(mesh->ebo(), *ebo_, 0, first_index * sizeof(GLuint),
+                                 mesh->num_indices() * sizeof(GLuint));
+
+        auto index = GLuint(commands.size());
+        commands.push_back({
+            .count = GLuint(mesh->num_indices()),
+            .instance_count = 1,
+            .first_index = first_index,
+            .base_vertex = GLint(first_vertex),
+            .base_instance = index,
+        });
+        bounds_.push_back(mesh->bounds());
+        packed_bounds.emplace_back(mesh->bounds().min, 0);
+        packed_bounds.emplace_back(mesh->bounds().max, 0);
+
+        if (groups_.empty() || groups_.back().material != mesh->material())
+            groups_.push_back({mesh->material(), index, 0});
+        ++groups_.back().count;
+
+        first_vertex += mesh->num_vertices();
+        first_index += mesh->num_indices();
+    }
+
+    glCreateBuffers(1, &command_buffer_.reset_as_ref());
+    glCreateBuffers(1, &bounds_buffer_.reset_as_ref());
+    glNamedBufferStorage(*command_buffer_,
+                         std::max<GLsizeiptr>(commands.size(), 1) *
+                             sizeof(DrawElementsIndirectCommand),
+                         commands.data(), 0);
+    glNamedBufferStorage(*bounds_buffer_,
+                         std::max<GLsizeiptr>(packed_bounds.size(), 2) * sizeof(glm::vec4),
+                         packed_bounds.data(), 0);
+
+    vao_ = make_vertex_array(*vbo_, sizeof(Vertex), VERTEX_ATTRIBS, *ebo_);
+}
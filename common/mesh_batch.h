@@ -0,0 +1,53 @@
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "bounds.h"
+#include "material.h"
+#include "mesh.h"
+#include "model.h"
+
+// Layout of one glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// All meshes of a model merged into one vertex/index buffer pair, so they can be
+// drawn with a single glMultiDrawElementsIndirect. Meshes are ordered by material and
+// each command's base_instance is its mesh index, for gl_BaseInstance lookups.
+class MeshBatch {
+  public:
+    // Consecutive commands sharing one material
+    struct Group {
+        std::shared_ptr<Material> material;
+        GLuint first, count;
+    };
+
+    explicit MeshBatch(const Model& model);
+
+    GLuint vao() const { return vao_.get(); }
+    // One DrawElementsIndirectCommand per mesh, instance_count 1
+    GLuint command_buffer() const { return command_buffer_.get(); }
+    // Model-space bounds per mesh as (vec4 min, vec4 max) pairs
+    GLuint bounds_buffer() const { return bounds_buffer_.get(); }
+
+    size_t size() const { return bounds_.size(); }
+    const std::vector<Group>& groups() const { return groups_; }
+    const std::vector<Bounds>& bounds() const { return bounds_; }
+
+  private:
+    VaoHandle vao_;
+    BufferHandle vbo_, ebo_, command_buffer_, bounds_buffer_;
+    std::vector<Group> groups_;
+    std::vector<Bounds> bounds_;
+};
+
+#endif // MESH_BATCH_H
@@ -0,0 +1,94 @@
+#include "mipmap.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// sRGB byte -> 16-bit linear. Rounded to integers once, so all later math is exact.
+const std::array<uint16_t, 256>& srgb_to_linear_table() {
+    static const auto table = [] {
+        std::array<uint16_t, 256> t;
+        for (int i = 0; i < 256; i++) {
+            double c = i / 255.0;
+            double l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            t[i] = uint16_t(std::lround(l * 65535.0));
+        }
+        return t;
+    }();
+    return table;
+}
+
+// 12-bit linear -> nearest sRGB byte, derived from the decode table so the two agree
+const std::array<uint8_t, 4096>& linear_to_srgb_table() {
+    static const auto table = [] {
+        auto& decode = srgb_to_linear_table();
+        std::array<uint8_t, 4096> t;
+        for (int i = 0; i < 4096; i++) {
+            int value = i * 16 + 8;
+            auto it = std::lower_bound(decode.begin(), decode.end(), value);
+            int b = int(it - decode.begin());
+            if (b == 256 || (b > 0 && value - decode[b - 1] <= decode[b] - value))
+                --b;
+            t[i] = uint8_t(b);
+        }
+        return t;
+    }();
+    return table;
+}
+
+struct LevelView {
+    int width, height;
+    const uint8_t* pixels;
+};
+
+// Rows of a level per pool task
+constexpr size_t ROWS_PER_TASK = 16;
+
+void downsample(LevelView src, ImageLevel& dst, int channels, bool srgb, ThreadPool* pool) {
+    auto& decode = srgb_to_linear_table();
+    auto& encode = linear_to_srgb_table();
+    int color_channels = srgb ? std::min(channels, 3) : 0;
+    size_t src_stride = size_t(src.width) * channels;
+    size_t dst_stride = size_t(dst.width) * channels;
+
+    parallel_for(pool, size_t(dst.height), [&](size_t y) {
+        size_t last_row = size_t(src.height - 1);
+        const uint8_t* row0 = src.pixels + std::min(2 * y, last_row) * src_stride;
+        const uint8_t* row1 = src.pixels + std::min(2 * y + 1, last_row) * src_stride;
+        uint8_t* out = &dst.pixels[y * dst_stride];
+        for (int x = 0; x < dst.width; x++) {
+            size_t x0 = size_t(std::min(2 * x, src.width - 1)) * channels;
+            size_t x1 = size_t(std::min(2 * x + 1, src.width - 1)) * channels;
+            for (int c = 0; c < channels; c++) {
+                if (c < color_channels) {
+                    uint32_t sum = decode[row0[x0 + c]] + decode[row0[x1 + c]] +
+                                   decode[row1[x0 + c]] + decode[row1[x1 + c]];
+                    out[x * channels + c] = encode[(sum + 2) / 4 >> 4];
+                } else {
+                    uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    out[x * channels + c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+    }, ROWS_PER_TASK);
+}
+
+} // namespace
+
+std::vector<ImageLevel> generate_mips(std::span<const uint8_t> pixels, int width,
+                                      int height, int channels, bool srgb,
+                                      ThreadPool* pool) {
+    std::vector<ImageLevel> levels;
+    LevelView src{width, height, pixels.data()};
+    while (src.width > 1 || src.height > 1) {
+        int w = std::max(src.width / 2, 1);
+        int h = std::max(src.height / 2, 1);
+        ImageLevel& dst =
+            levels.emplace_back(w, h, std::vector<uint8_t>(size_t(w) * h * channels));
+        downsample(src, dst, channels, srgb, pool);
+        src = {dst.width, dst.height, dst.pixels.data()};
+    }
+    return levels;
+}
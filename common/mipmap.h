@@ -0,0 +1,25 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "thread_pool.h"
+
+// One level of an 8 bits per channel image, rows tightly packed
+struct ImageLevel {
+    int width, height;
+    std::vector<uint8_t> pixels;
+};
+
+// Builds the mip chain below an image, from half size down to 1x1, with a 2x2 box
+// filter (a trailing odd row or column is dropped, like GPU mip generation). With
+// srgb, color channels are averaged in linear space and re-encoded; alpha is always
+// linear. Rows of each level are split across the pool if there is one. Pure integer
+// and table arithmetic, so output is identical on every machine.
+std::vector<ImageLevel> generate_mips(std::span<const uint8_t> pixels, int width,
+                                      int height, int channels, bool srgb,
+                                      ThreadPool* pool = nullptr);
+
+#endif // MIPMAP_H
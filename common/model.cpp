@@ -1,7 +1,42 @@
 #include "model.h"
 
+#include <algorithm>
+#include <numeric>
+
 void Model::draw(const Shader* shader) const {
-    for (auto& mesh : meshes_) {
-        mesh->draw(shader);
+    for_each_drawn([&](const Mesh& mesh) { mesh.draw(shader); });
+}
+
+void Model::draw(ShaderVariants& shaders,
+                 util::function_ref<void(const Shader&)> setup) const {
+    const Shader* current = nullptr;
+    for_each_drawn([&](const Mesh& mesh) {
+        unsigned int features = mesh.material() ? mesh.material()->features : 0;
+        const Shader& shader = shaders.get(features);
+        if (&shader != current) {
+            shader.use();
+            setup(shader);
+            current = &shader;
+        }
+        mesh.draw(&shader);
+    });
+}
+
+void Model::draw_depth() const {
+    for_each_drawn([](const Mesh& mesh) { mesh.draw_depth(); });
+}
+
+void Model::sort_front_to_back(const glm::mat4& modelview) {
+    // View space looks down -z, so larger z is closer
+    depths_.resize(meshes_.size());
+    for (size_t i = 0; i < meshes_.size(); i++) {
+        glm::vec4 center = modelview * glm::vec4(meshes_[i]->bounds().center(), 1);
+        depths_[i] = -center.z;
     }
+    draw_order_.resize(meshes_.size());
+    std::iota(draw_order_.begin(), draw_order_.end(), 0u);
+    // Ties go by index rather than through std::stable_sort, which allocates
+    std::ranges::sort(draw_order_, [&](uint32_t a, uint32_t b) {
+        return depths_[a] < depths_[b] || (depths_[a] == depths_[b] && a < b);
+    });
 }
@@ -1,14 +1,18 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "material.h"
 #include "mesh.h"
 #include "shader.h"
+#include "shader_variants.h"
+#include "utils.h"
 
 class Model {
   public:
@@ -16,13 +20,44 @@ class Model {
           std::vector<std::shared_ptr<Material>> materials = {})
         : meshes_(std::move(meshes)), materials_(std::move(materials)) {}
     void draw(const Shader* shader = nullptr) const;
+    // Draws each mesh with the shader permutation for its material's features.
+    // setup is called with each shader right after it becomes active, to set
+    // per-frame uniforms like matrices and lights.
+    void draw(ShaderVariants& shaders,
+              util::function_ref<void(const Shader&)> setup) const;
+    // Draws positions only, for depth pre-passes and shadow maps
+    void draw_depth() const;
 
-    const std::vector<std::shared_ptr<Mesh>>& meshes() { return meshes_; }
-    const std::vector<std::shared_ptr<Material>>& materials() { return materials_; }
+    // Draws meshes by increasing view depth of their bounds' centers from now on, so
+    // opaque geometry goes front to back and early-Z rejects hidden fragments. meshes()
+    // keeps its order: the draw order is a list of indices, reused from call to call.
+    void sort_front_to_back(const glm::mat4& modelview);
+
+    const std::vector<std::shared_ptr<Mesh>>& meshes() const { return meshes_; }
+    // Gives up the meshes and materials, leaving the model empty
+    std::pair<std::vector<std::shared_ptr<Mesh>>, std::vector<std::shared_ptr<Material>>>
+    release() {
+        draw_order_.clear();
+        return {std::move(meshes_), std::move(materials_)};
+    }
+    const std::vector<std::shared_ptr<Material>>& materials() const { return materials_; }
 
   private:
+    // Calls f with each mesh in draw order
+    template <typename F>
+    void for_each_drawn(F&& f) const {
+        if (draw_order_.size() != meshes_.size()) {
+            for (auto& mesh : meshes_) f(*mesh);
+            return;
+        }
+        for (uint32_t i : draw_order_) f(*meshes_[i]);
+    }
+
     std::vector<std::shared_ptr<Mesh>> meshes_;
     std::vector<std::shared_ptr<Material>> materials_;
+    // Indices into meshes_ set by sort_front_to_back, and the depths sorted by
+    std::vector<uint32_t> draw_order_;
+    std::vector<float> depths_;
 };
 
 #endif // MODEL_H
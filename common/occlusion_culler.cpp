@@ -0,0 +1,159 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+
+#include "hiz.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+GLuint groups_for(GLsizei n, GLsizei group_size) {
+    return GLuint((n + group_size - 1) / group_size);
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(const fs::path& shader_dir)
+    : copy_shader_(Shader::load_compute(shader_dir / "hiz_downsample.comp",
+                                        {{"COPY_DEPTH", "1"}})),
+      downsample_shader_(Shader::load_compute(shader_dir / "hiz_downsample.comp")),
+      cull_shader_(Shader::load_compute(shader_dir / "occlusion_cull.comp")) {
+    glCreateBuffers(1, &counter_buffer_.reset_as_ref());
+    glNamedBufferStorage(*counter_buffer_, sizeof(Stats), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    for (auto& buffer : stats_buffers_) {
+        glCreateBuffers(1, &buffer.reset_as_ref());
+        glNamedBufferStorage(*buffer, sizeof(Stats), nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+}
+
+void OcclusionCuller::resize(GLsizei width, GLsizei height) {
+    if (hiz_size_ == glm::ivec2(width, height))
+        return;
+    hiz_size_ = {width, height};
+    hiz_levels_ = hiz_num_levels(width, height);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &hiz_.reset_as_ref());
+    glTextureStorage2D(*hiz_, hiz_levels_, GL_R32F, width, height);
+    glTextureParameteri(*hiz_, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(*hiz_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(*hiz_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*hiz_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    depth_copy_.reset();
+    has_hiz_ = false;
+}
+
+void OcclusionCuller::build_hiz(GLsizei width, GLsizei height) {
+    resize(width, height);
+    if (!depth_copy_) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &depth_copy_.reset_as_ref());
+        glTextureStorage2D(*depth_copy_, 1, GL_DEPTH_COMPONENT24, width, height);
+        glTextureParameteri(*depth_copy_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(*depth_copy_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glCopyTextureSubImage2D(*depth_copy_, 0, 0, 0, 0, 0, width, height);
+    build_hiz(*depth_copy_, width, height);
+}
+
+void OcclusionCuller::build_hiz(GLuint depth_texture, GLsizei width, GLsizei height) {
+    resize(width, height);
+
+    copy_shader_.use();
+    glBindTextureUnit(0, depth_texture);
+    copy_shader_.set_int("depthTexture", 0);
+    glBindImageTexture(1, *hiz_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(groups_for(width, 8), groups_for(height, 8), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    downsample();
+    has_hiz_ = true;
+}
+
+void OcclusionCuller::downsample() {
+    downsample_shader_.use();
+    glm::ivec2 size = hiz_size_;
+    for (GLint level = 1; level < hiz_levels_; ++level) {
+        glm::ivec2 dst = glm::max(size / 2, 1);
+        glBindImageTexture(0, *hiz_, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, *hiz_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute(groups_for(dst.x, 8), groups_for(dst.y, 8), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        size = dst;
+    }
+    // The cull shader reads the pyramid through a sampler
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void OcclusionCuller::cull(const MeshBatch& batch, const glm::mat4& model_view_projection) {
+    size_t size = std::max<size_t>(batch.size(), 1) * sizeof(DrawElementsIndirectCommand);
+    if (size > capacity_) {
+        glCreateBuffers(1, &visible_buffer_.reset_as_ref());
+        glCreateBuffers(1, &ordered_buffer_.reset_as_ref());
+        glNamedBufferStorage(*visible_buffer_, size, nullptr, 0);
+        glNamedBufferStorage(*ordered_buffer_, size, nullptr, 0);
+        capacity_ = size;
+    }
+    GLuint zero = 0;
+    glClearNamedBufferData(*counter_buffer_, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                           &zero);
+
+    cull_shader_.use();
+    cull_shader_.set_mat4("modelViewProjection", model_view_projection);
+    cull_shader_.set_uint("numMeshes", GLuint(batch.size()));
+    cull_shader_.set_bool("useHiz", has_hiz_);
+    cull_shader_.set_int("hiz", 0);
+    cull_shader_.set_int("hizLevels", hiz_levels_);
+    if (has_hiz_)
+        glBindTextureUnit(0, *hiz_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.bounds_buffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.command_buffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, *visible_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, *ordered_buffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, *counter_buffer_);
+    glDispatchCompute(groups_for(GLsizei(batch.size()), 64), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Keep a copy of the counters to read back once the GPU is done with them
+    size_t i = next_stats_;
+    glCopyNamedBufferSubData(*counter_buffer_, *stats_buffers_[i], 0, 0, sizeof(Stats));
+    stats_fences_[i].reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    next_stats_ = (next_stats_ + 1) % STATS_FRAMES;
+}
+
+void OcclusionCuller::draw(const MeshBatch& batch) const {
+    glBindVertexArray(batch.vao());
+#ifdef GL_ARB_indirect_parameters
+    if (GLAD_GL_ARB_indirect_parameters) {
+        // The draw count is the first counter
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, *visible_buffer_);
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, *counter_buffer_);
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                            GLsizei(batch.size()), 0);
+        return;
+    }
+#endif
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, *ordered_buffer_);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                GLsizei(batch.size()), 0);
+}
+
+void OcclusionCuller::draw(const MeshBatch& batch, const MeshBatch::Group& group) const {
+    glBindVertexArray(batch.vao());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, *ordered_buffer_);
+    auto offset = size_t(group.first) * sizeof(DrawElementsIndirectCommand);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                reinterpret_cast<const void*>(offset), GLsizei(group.count),
+                                0);
+}
+
+std::optional<OcclusionCuller::Stats> OcclusionCuller::stats() const {
+    size_t oldest = next_stats_;
+    if (!stats_fences_[oldest])
+        return std::nullopt;
+    GLenum status = glClientWaitSync(*stats_fences_[oldest], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return std::nullopt;
+    Stats stats;
+    glGetNamedBufferSubData(*stats_buffers_[oldest], 0, sizeof(Stats), &stats);
+    return stats;
+}
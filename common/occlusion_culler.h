@@ -0,0 +1,76 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <array>
+#include <filesystem>
+#include <optional>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "mesh_batch.h"
+#include "query.h"
+#include "raii.h"
+#include "shader.h"
+#include "texture.h"
+
+// GPU-driven occlusion culling. A hierarchical-Z pyramid is built from one frame's
+// depth buffer, and the next frame a compute shader tests each mesh's bounds against
+// the frustum and the pyramid, writing indirect draw commands. Nothing is read back on
+// the draw path; see HiZPyramid for the CPU reference of the test.
+//
+// Two command buffers are written: a compacted one plus draw count for single-program
+// passes (depth, shadows), drawn with glMultiDrawElementsIndirectCount when
+// GL_ARB_indirect_parameters is available, and one with the batch's order where culled
+// meshes get instance_count 0, so material groups can be drawn as separate ranges.
+class OcclusionCuller {
+  public:
+    struct Stats {
+        GLuint drawn, culled;
+    };
+
+    // shader_dir must contain hiz_downsample.comp and occlusion_cull.comp
+    explicit OcclusionCuller(const std::filesystem::path& shader_dir);
+
+    // Builds the pyramid from the depth buffer of the bound read framebuffer. Call at
+    // the end of a frame; the pyramid is used to cull the next one.
+    void build_hiz(GLsizei width, GLsizei height);
+    // Builds the pyramid from a sampleable depth texture
+    void build_hiz(GLuint depth_texture, GLsizei width, GLsizei height);
+
+    // Culls every mesh of the batch. Without a pyramid only frustum culling is done.
+    void cull(const MeshBatch& batch, const glm::mat4& model_view_projection);
+
+    // Draws the visible meshes with the current program in one call
+    void draw(const MeshBatch& batch) const;
+    // Draws the visible meshes of one material group
+    void draw(const MeshBatch& batch, const MeshBatch::Group& group) const;
+
+    // Counters of the cull issued a few frames ago, once the GPU has finished it
+    std::optional<Stats> stats() const;
+
+    GLuint hiz_texture() const { return hiz_.get(); }
+    GLsizei hiz_levels() const { return hiz_levels_; }
+
+  private:
+    static constexpr size_t STATS_FRAMES = 3;
+
+    void resize(GLsizei width, GLsizei height);
+    void downsample();
+
+    Shader copy_shader_, downsample_shader_, cull_shader_;
+    TextureHandle depth_copy_, hiz_;
+    glm::ivec2 hiz_size_{0};
+    GLsizei hiz_levels_ = 0;
+    bool has_hiz_ = false;
+
+    BufferHandle visible_buffer_, ordered_buffer_, counter_buffer_;
+    size_t capacity_ = 0;
+
+    std::array<BufferHandle, STATS_FRAMES> stats_buffers_;
+    std::array<SyncHandle, STATS_FRAMES> stats_fences_;
+    size_t next_stats_ = 0;
+};
+
+#endif // OCCLUSION_CULLER_H
@@ -0,0 +1,362 @@
+#include "pack_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+
+#ifdef HAS_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "errutils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'G', 'P', 'K'};
+constexpr uint32_t VERSION = 1;
+// Packing is done ahead of time, so favor ratio over speed; decompression speed barely
+// depends on the level
+constexpr int ZSTD_LEVEL = 12;
+
+// On-disk header, native byte order
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t names_size;
+    uint64_t toc_offset;
+};
+
+// The table of contents is written and mapped as is
+static_assert(sizeof(PackEntry) == 40);
+
+constexpr std::string_view codec_name(PackCodec codec) {
+    switch (codec) {
+    case PackCodec::Stored:
+        return "stored";
+    case PackCodec::LZ4:
+        return "lz4";
+    case PackCodec::Zstd:
+        return "zstd";
+    }
+    return "unknown";
+}
+
+uint64_t align_up(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+size_t num_chunks(uint64_t size) {
+    return size_t((size + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE);
+}
+
+std::vector<std::byte> compress_chunk(PackCodec codec, std::span<const std::byte> src) {
+    std::vector<std::byte> out;
+    switch (codec) {
+#ifdef HAS_LZ4
+    case PackCodec::LZ4: {
+        out.resize(size_t(LZ4_compressBound(int(src.size()))));
+        int size = LZ4_compress_default(reinterpret_cast<const char*>(src.data()),
+                                        reinterpret_cast<char*>(out.data()), int(src.size()),
+                                        int(out.size()));
+        err::check(size > 0, "LZ4 compression failed");
+        out.resize(size_t(size));
+        return out;
+    }
+#endif
+#ifdef HAS_ZSTD
+    case PackCodec::Zstd: {
+        out.resize(ZSTD_compressBound(src.size()));
+        size_t size =
+            ZSTD_compress(out.data(), out.size(), src.data(), src.size(), ZSTD_LEVEL);
+        err::check(!ZSTD_isError(size), "zstd compression failed: {}",
+                   ZSTD_getErrorName(size));
+        out.resize(size);
+        return out;
+    }
+#endif
+    default:
+        err::error("{} compression isn't supported by this build", codec_name(codec));
+    }
+}
+
+// Decompresses src, which must fill out exactly
+void decompress_chunk(PackCodec codec, std::span<const std::byte> src,
+                      std::span<std::byte> out) {
+    switch (codec) {
+#ifdef HAS_LZ4
+    case PackCodec::LZ4: {
+        int size = LZ4_decompress_safe(reinterpret_cast<const char*>(src.data()),
+                                       reinterpret_cast<char*>(out.data()), int(src.size()),
+                                       int(out.size()));
+        err::check(size == int(out.size()), "corrupt LZ4 chunk");
+        return;
+    }
+#endif
+#ifdef HAS_ZSTD
+    case PackCodec::Zstd: {
+        size_t size = ZSTD_decompress(out.data(), out.size(), src.data(), src.size());
+        err::check(!ZSTD_isError(size) && size == out.size(), "corrupt zstd chunk");
+        return;
+    }
+#endif
+    default:
+        err::error("{} compression isn't supported by this build", codec_name(codec));
+    }
+}
+
+} // namespace
+
+bool pack_codec_supported(PackCodec codec) {
+    switch (codec) {
+    case PackCodec::Stored:
+        return true;
+#ifdef HAS_LZ4
+    case PackCodec::LZ4:
+        return true;
+#endif
+#ifdef HAS_ZSTD
+    case PackCodec::Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::optional<PackCodec> parse_pack_codec(std::string_view name) {
+    for (PackCodec codec : {PackCodec::Stored, PackCodec::LZ4, PackCodec::Zstd}) {
+        if (name == codec_name(codec))
+            return codec;
+    }
+    return std::nullopt;
+}
+
+void write_pack(std::span<const PackInput> inputs, const fs::path& path, ThreadPool& pool) {
+    std::vector<const PackInput*> sorted;
+    for (const PackInput& input : inputs) {
+        err::check(pack_codec_supported(input.codec), "{}: {} compression isn't supported",
+                   input.name, codec_name(input.codec));
+        sorted.push_back(&input);
+    }
+    std::ranges::sort(sorted, {}, &PackInput::name);
+    auto duplicate = std::ranges::adjacent_find(sorted, {}, &PackInput::name);
+    if (duplicate != sorted.end())
+        err::error("{} is packed twice", (*duplicate)->name);
+
+    // Written beside path and renamed over it, so programs that have the old pack mapped
+    // keep reading it intact. On Windows that needs the readers to share delete access,
+    // which MappedFile does.
+    fs::path temp_path = fs::path(path) += ".tmp";
+    std::ofstream file(temp_path, std::ios::binary);
+    err::check(file.is_open(), "failed to create pack {}", temp_path.string());
+    PackHeader header{};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+    auto write = [&](std::span<const std::byte> bytes) {
+        file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+        offset += bytes.size();
+    };
+    auto pad = [&](uint64_t alignment) {
+        static constexpr std::byte zeros[PACK_ALIGNMENT]{};
+        write(std::span(zeros, align_up(offset, alignment) - offset));
+    };
+
+    std::vector<PackEntry> entries;
+    std::string names;
+    for (const PackInput* input : sorted) {
+        MappedFile source(input->source);
+        pad(PACK_ALIGNMENT);
+        PackEntry entry{offset, source.size(), source.size(), uint32_t(names.size()),
+                        uint32_t(input->name.size()), PackCodec::Stored, 0};
+        names += input->name;
+
+        if (input->codec != PackCodec::Stored && source.size() > 0) {
+            std::vector<std::vector<std::byte>> chunks(num_chunks(source.size()));
+            // Pool tasks can't throw, so errors are collected and rethrown
+            std::vector<std::exception_ptr> errors(chunks.size());
+            pool.parallel_for(chunks.size(), [&](size_t c) {
+                size_t begin = c * PACK_CHUNK_SIZE;
+                size_t length = std::min(PACK_CHUNK_SIZE, source.size() - begin);
+                try {
+                    chunks[c] = compress_chunk(input->codec, source.bytes(begin, length));
+                } catch (...) {
+                    errors[c] = std::current_exception();
+                }
+            });
+            for (auto& error : errors) {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+            std::vector<uint64_t> table(chunks.size() + 1);
+            table[0] = table.size() * sizeof(uint64_t);
+            for (size_t c = 0; c < chunks.size(); c++)
+                table[c + 1] = table[c] + chunks[c].size();
+            // Compression that barely helps isn't worth giving up zero-copy reads for
+            if (table.back() <= source.size() - source.size() / 8) {
+                write(std::as_bytes(std::span(table)));
+                for (auto& chunk : chunks)
+                    write(chunk);
+                entry.stored_size = table.back();
+                entry.codec = input->codec;
+                entry.num_chunks = uint32_t(chunks.size());
+            }
+        }
+        if (entry.codec == PackCodec::Stored)
+            write(source.bytes());
+        entries.push_back(entry);
+    }
+
+    pad(alignof(PackEntry));
+    header = {{}, VERSION, uint32_t(entries.size()), uint32_t(names.size()), offset};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    write(std::as_bytes(std::span(entries)));
+    write(std::as_bytes(std::span(names)));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    err::check(file.good(), "failed to write pack {}", temp_path.string());
+    fs::rename(temp_path, path);
+}
+
+PackFile::PackFile(const fs::path& path, ThreadPool* pool)
+    : path_(path), file_(path, MappedFile::Access::Random), pool_(pool) {
+    PackHeader header;
+    err::check(file_.size() >= sizeof(header), "{} is not a pack", path.string());
+    std::memcpy(&header, file_.data(), sizeof(header));
+    err::check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                   header.version == VERSION,
+               "{} is not a pack", path.string());
+    size_t toc_size = size_t(header.num_entries) * sizeof(PackEntry);
+    err::check(header.toc_offset <= file_.size() &&
+                   toc_size + header.names_size <= file_.size() - header.toc_offset,
+               "{}: truncated pack", path.string());
+
+    entries_.resize(header.num_entries);
+    std::memcpy(entries_.data(), file_.data() + header.toc_offset, toc_size);
+    names_ = file_.text().substr(header.toc_offset + toc_size, header.names_size);
+    for (const PackEntry& entry : entries_) {
+        err::check(entry.offset <= header.toc_offset &&
+                       entry.stored_size <= header.toc_offset - entry.offset &&
+                       entry.name_offset <= names_.size() &&
+                       entry.name_length <= names_.size() - entry.name_offset,
+                   "{}: corrupt table of contents", path.string());
+    }
+    if (pool)
+        reader_ = std::make_unique<AsyncReader>(path, *pool);
+}
+
+PackFile::~PackFile() {
+    // Reads finish first, and may hand decompressions to the pool
+    reader_.reset();
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] { return in_flight_ == 0; });
+}
+
+std::string_view PackFile::name(const PackEntry& entry) const {
+    return names_.substr(entry.name_offset, entry.name_length);
+}
+
+const PackEntry* PackFile::find(std::string_view name) const {
+    auto entry_name = [&](const PackEntry& entry) { return this->name(entry); };
+    auto it = std::ranges::lower_bound(entries_, name, {}, entry_name);
+    return it != entries_.end() && this->name(*it) == name ? &*it : nullptr;
+}
+
+std::span<const std::byte> PackFile::view(const PackEntry& entry) const {
+    err::check(entry.codec == PackCodec::Stored, "{}: {} is compressed", path_.string(),
+               name(entry));
+    return file_.bytes(entry.offset, entry.size);
+}
+
+std::vector<std::byte> PackFile::read(const PackEntry& entry) const {
+    std::vector<std::byte> out(entry.size);
+    if (entry.codec == PackCodec::Stored)
+        std::ranges::copy(view(entry), out.begin());
+    else
+        decompress(entry, file_.bytes(entry.offset, entry.stored_size), out);
+    return out;
+}
+
+std::future<std::vector<std::byte>> PackFile::read_async(const PackEntry& entry) const {
+    err::check(reader_ != nullptr, "{}: async reads need a thread pool", path_.string());
+    if (entry.codec == PackCodec::Stored)
+        return reader_->read(entry.offset, entry.size);
+
+    auto promise = std::make_shared<std::promise<std::vector<std::byte>>>();
+    auto future = promise->get_future();
+    {
+        std::lock_guard lock(mutex_);
+        ++in_flight_;
+    }
+    // The entry is copied: the caller's may be gone by the time the read completes
+    reader_->read(entry.offset, entry.stored_size,
+                  [this, entry, promise](std::vector<std::byte> stored,
+                                         std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+            finish_async();
+            return;
+        }
+        // Off the completion thread, which would hold up other reads
+        pool_->submit([this, entry, promise, stored = std::move(stored)] {
+            try {
+                std::vector<std::byte> out(entry.size);
+                decompress(entry, stored, out);
+                promise->set_value(std::move(out));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+            finish_async();
+        });
+    });
+    return future;
+}
+
+void PackFile::finish_async() const {
+    std::lock_guard lock(mutex_);
+    if (--in_flight_ == 0)
+        idle_.notify_all();
+}
+
+void PackFile::decompress(const PackEntry& entry, std::span<const std::byte> stored,
+                          std::span<std::byte> out) const {
+    err::check(pack_codec_supported(entry.codec), "{}: {} is {} compressed", path_.string(),
+               name(entry), codec_name(entry.codec));
+    std::vector<uint64_t> table(entry.num_chunks + 1);
+    bool valid = entry.num_chunks == num_chunks(entry.size) &&
+                 stored.size() >= table.size() * sizeof(uint64_t);
+    if (valid) {
+        std::memcpy(table.data(), stored.data(), table.size() * sizeof(uint64_t));
+        valid = table.back() <= stored.size() && std::ranges::is_sorted(table);
+    }
+    err::check(valid, "{}: corrupt chunk table for {}", path_.string(), name(entry));
+
+    std::vector<std::exception_ptr> errors(entry.num_chunks);
+    auto chunk = [&](size_t c) {
+        size_t begin = c * PACK_CHUNK_SIZE;
+        try {
+            size_t length = std::min(PACK_CHUNK_SIZE, out.size() - begin);
+            decompress_chunk(entry.codec, stored.subspan(table[c], table[c + 1] - table[c]),
+                             out.subspan(begin, length));
+        } catch (...) {
+            errors[c] = std::current_exception();
+        }
+    };
+    if (pool_) {
+        pool_->parallel_for(entry.num_chunks, chunk);
+    } else {
+        for (size_t c = 0; c < entry.num_chunks; c++)
+            chunk(c);
+    }
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
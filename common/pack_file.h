@@ -0,0 +1,109 @@
+#ifndef PACK_FILE_H
+#define PACK_FILE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "async_reader.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+// Pack file layout, native byte order:
+//   header
+//   entry data, each entry starting on a PACK_ALIGNMENT boundary
+//   table of contents: PackEntry records sorted by name, then their names
+// Stored entries are the file's bytes as is, so a mapped pack can hand them to the GPU
+// without a copy. Compressed entries are split into PACK_CHUNK_SIZE chunks compressed
+// independently, so they can be decompressed in parallel; their data starts with a
+// table of num_chunks + 1 chunk offsets relative to the entry's offset.
+
+inline constexpr size_t PACK_ALIGNMENT = 4096;
+inline constexpr size_t PACK_CHUNK_SIZE = 256 << 10;
+
+enum class PackCodec : uint32_t {
+    Stored,
+    LZ4,
+    Zstd,
+};
+
+// Whether this build can compress and decompress codec
+bool pack_codec_supported(PackCodec codec);
+std::optional<PackCodec> parse_pack_codec(std::string_view name);
+
+struct PackEntry {
+    uint64_t offset;
+    // Bytes in the pack, and after decompression
+    uint64_t stored_size;
+    uint64_t size;
+    uint32_t name_offset, name_length;
+    PackCodec codec;
+    uint32_t num_chunks;
+};
+
+struct PackInput {
+    // Name in the pack: relative, '/' separated
+    std::string name;
+    std::filesystem::path source;
+    PackCodec codec = PackCodec::Stored;
+};
+
+// Writes the inputs to a pack at path. Compressed entries that don't shrink by at least
+// an eighth are stored instead. Chunks are compressed in parallel on the pool. An
+// existing pack is replaced by renaming, never rewritten in place.
+void write_pack(std::span<const PackInput> inputs, const std::filesystem::path& path,
+                ThreadPool& pool);
+
+// Read side of a pack, mapped into memory. Lookups and reads may be called from any
+// thread.
+class PackFile {
+  public:
+    // Compressed entries are decompressed in parallel on pool. Without a pool they are
+    // decompressed serially and read_async isn't available.
+    explicit PackFile(const std::filesystem::path& path, ThreadPool* pool = nullptr);
+    // Waits for read_async calls in flight, so it must not run on the pool
+    ~PackFile();
+
+    const std::filesystem::path& path() const { return path_; }
+    std::span<const PackEntry> entries() const { return entries_; }
+    std::string_view name(const PackEntry& entry) const;
+    // Entry for a relative, '/' separated name
+    const PackEntry* find(std::string_view name) const;
+
+    // The bytes of a stored entry, straight from the mapping
+    std::span<const std::byte> view(const PackEntry& entry) const;
+    // The bytes of any entry, decompressed
+    std::vector<std::byte> read(const PackEntry& entry) const;
+    // Reads the entry through an AsyncReader and decompresses it on the pool, leaving
+    // the calling thread and the mapping's page faults out of it. entry is copied, so
+    // it needn't outlive the call.
+    std::future<std::vector<std::byte>> read_async(const PackEntry& entry) const;
+
+  private:
+    void decompress(const PackEntry& entry, std::span<const std::byte> stored,
+                    std::span<std::byte> out) const;
+    void finish_async() const;
+
+    std::filesystem::path path_;
+    MappedFile file_;
+    ThreadPool* pool_;
+    std::unique_ptr<AsyncReader> reader_;
+    std::vector<PackEntry> entries_;
+    std::string_view names_;
+
+    // read_async decompressions not yet finished
+    mutable std::mutex mutex_;
+    mutable std::condition_variable idle_;
+    mutable size_t in_flight_ = 0;
+};
+
+#endif // PACK_FILE_H
@@ -0,0 +1,54 @@
+#include "page_cache.h"
+
+#include <algorithm>
+
+PageCache::PageCache(uint32_t num_slots) : num_slots_(num_slots) {
+    // Hand out low slots first
+    for (uint32_t i = num_slots; i > 0; i--)
+        free_slots_.push_back(i - 1);
+}
+
+std::vector<PageId> PageCache::touch(std::span<const PageId> pages) {
+    std::vector<PageId> missing;
+    for (PageId page : pages) {
+        auto it = lookup_.find(page.key());
+        if (it == lookup_.end()) {
+            missing.push_back(page);
+            continue;
+        }
+        it->second->last_used = frame_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+    }
+    std::ranges::sort(missing, std::greater{}, [](PageId p) { return p.key(); });
+    return missing;
+}
+
+std::optional<uint32_t> PageCache::slot(PageId page) const {
+    auto it = lookup_.find(page.key());
+    if (it == lookup_.end())
+        return std::nullopt;
+    return it->second->slot;
+}
+
+std::optional<PageCache::Placement> PageCache::insert(PageId page, bool pinned) {
+    if (lookup_.contains(page.key()))
+        return std::nullopt;
+
+    Placement placement;
+    if (!free_slots_.empty()) {
+        placement.slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        auto victim = std::find_if(entries_.rbegin(), entries_.rend(),
+                                   [](const Entry& e) { return !e.pinned; });
+        if (victim == entries_.rend() || victim->last_used == frame_)
+            return std::nullopt;
+        placement.slot = victim->slot;
+        placement.evicted = victim->page;
+        lookup_.erase(victim->page.key());
+        entries_.erase(std::next(victim).base());
+    }
+    entries_.push_front({page, placement.slot, frame_, pinned});
+    lookup_.emplace(page.key(), entries_.begin());
+    return placement;
+}
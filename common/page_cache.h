@@ -0,0 +1,68 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// One page of a virtual texture: mip level and page coordinates within that level
+struct PageId {
+    uint32_t level, x, y;
+
+    // 8 bits of level, 12 bits per coordinate (up to 4096 pages per side)
+    uint32_t key() const { return level << 24 | y << 12 | x; }
+    static PageId from_key(uint32_t key) {
+        return {key >> 24, key & 0xfff, key >> 12 & 0xfff};
+    }
+    bool operator==(const PageId&) const = default;
+};
+
+// Residency bookkeeping for a fixed number of physical page slots, with least recently
+// used eviction. Pure CPU logic; VirtualTexture drives it with GPU feedback.
+class PageCache {
+  public:
+    struct Placement {
+        uint32_t slot;
+        std::optional<PageId> evicted;
+    };
+
+    explicit PageCache(uint32_t num_slots);
+
+    // Starts a new frame. Pages touched in the current frame are never evicted.
+    void begin_frame() { ++frame_; }
+
+    // Marks resident pages as used this frame. Returns the pages that are not resident,
+    // coarsest level first so fallbacks for a region arrive before its detail.
+    std::vector<PageId> touch(std::span<const PageId> pages);
+
+    // Slot holding page, if resident
+    std::optional<uint32_t> slot(PageId page) const;
+
+    // Assigns a slot to a newly loaded page, evicting the least recently used unpinned
+    // page if the cache is full. Returns nullopt if every page is pinned or was used
+    // this frame, or if page is already resident.
+    std::optional<Placement> insert(PageId page, bool pinned = false);
+
+    uint32_t capacity() const { return num_slots_; }
+    size_t size() const { return entries_.size(); }
+
+  private:
+    struct Entry {
+        PageId page;
+        uint32_t slot;
+        uint64_t last_used;
+        bool pinned;
+    };
+
+    uint32_t num_slots_;
+    // Most recently used at the front
+    std::list<Entry> entries_;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> lookup_;
+    std::vector<uint32_t> free_slots_;
+    uint64_t frame_ = 0;
+};
+
+#endif // PAGE_CACHE_H
@@ -1,8 +1,15 @@
 #include "primitives.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <utility>
 #include <vector>
 
+#include <glm/gtc/constants.hpp>
+
+#include "errutils.h"
+#include "tangents.h"
 #include "utils.h"
 
 template <unsigned int N>
@@ -33,23 +40,82 @@ std::vector<unsigned int> quad_indices(unsigned int n) {
     return indices;
 }
 
-std::vector<unsigned int> quad_grid_indices(unsigned int m, unsigned int n) {
-    std::vector<unsigned int> indices;
-    indices.reserve(6 * m * n);
-    unsigned int rowlen = n + 1;
-    for (unsigned int i = 0; i < m; i++) {
-        for (unsigned int j = 0; j < n; j++) {
-            indices.push_back(rowlen*(i + 0) + (j + 0));
-            indices.push_back(rowlen*(i + 0) + (j + 1));
-            indices.push_back(rowlen*(i + 1) + (j + 1));
-            indices.push_back(rowlen*(i + 1) + (j + 1));
-            indices.push_back(rowlen*(i + 1) + (j + 0));
-            indices.push_back(rowlen*(i + 0) + (j + 0));
+namespace {
+
+// Rows of row_size vertices per pool task, about 16K vertices, so small meshes are
+// generated on the calling thread
+size_t rows_per_task(size_t row_size) {
+    return std::max<size_t>(1, 16384 / std::max<size_t>(row_size, 1));
+}
+
+// cos and sin of the angles start + i / n * angle for i in [0, n]. For full circles the
+// last entry repeats the first exactly, so seam vertices coincide.
+struct TrigTable {
+    std::vector<float> cos, sin;
+
+    TrigTable(int n, float angle, float start = 0.f, bool circle = false)
+        : cos(size_t(n) + 1), sin(size_t(n) + 1) {
+        for (int i = 0; i <= n; i++) {
+            float a = start + float(circle ? i % n : i) / float(n) * angle;
+            cos[i] = std::cos(a);
+            sin[i] = std::sin(a);
         }
     }
-    return indices;
+};
+
+void check_size(MeshSize size, std::span<Vertex> vertices, std::span<unsigned int> indices) {
+    err::check(vertices.size() == size.vertices && indices.size() == size.indices,
+               "mesh storage holds {} vertices and {} indices, shape needs {} and {}",
+               vertices.size(), indices.size(), size.vertices, size.indices);
+}
+
+void check_heights(std::span<const float> heights, int width, int depth) {
+    err::check(width >= 2 && depth >= 2 && heights.size() == size_t(width) * depth,
+               "heightfield needs at least 2x2 heights, got {} for {}x{}", heights.size(),
+               width, depth);
+}
+
+// Two triangles per cell of a grid of (rows + 1) x (cols + 1) vertices starting at
+// vertex base. Vertex (i, j + 1) must follow (i, j) counter-clockwise around the face
+// normal as seen with (i + 1, j) above.
+void write_grid_indices(unsigned int rows, unsigned int cols, unsigned int base,
+                        std::span<unsigned int> out, ThreadPool* pool) {
+    unsigned int rowlen = cols + 1;
+    parallel_for(pool, rows, [&](size_t i) {
+        unsigned int* p = out.data() + i * cols * 6;
+        for (unsigned int j = 0; j < cols; j++, p += 6) {
+            unsigned int a = base + rowlen * unsigned(i) + j;
+            p[0] = a;
+            p[1] = a + 1;
+            p[2] = a + rowlen + 1;
+            p[3] = a + rowlen + 1;
+            p[4] = a + rowlen;
+            p[5] = a;
+        }
+    }, rows_per_task(cols));
 }
 
+// Longitude and latitude texture coordinates of a unit direction, matching make_sphere
+glm::vec2 sphere_uv(glm::vec3 p) {
+    float u = std::atan2(-p.z, p.x) / glm::two_pi<float>();
+    float v = std::acos(std::clamp(-p.y, -1.f, 1.f)) / glm::pi<float>();
+    return {u < 0 ? u + 1 : u, v};
+}
+
+// Tangent of sphere_uv's u at unit direction p, along increasing longitude. v increases
+// towards +y, so the bitangent sign is positive.
+glm::vec3 sphere_tangent(glm::vec3 p) {
+    float r = std::sqrt(p.x * p.x + p.z * p.z);
+    return r > 0 ? glm::vec3(p.z, 0, -p.x) / r : glm::vec3(0, 0, -1);
+}
+
+template <typename Write>
+Mesh make_generated(MeshSize size, const Bounds& bounds, Write&& write) {
+    return Mesh("", size.vertices, size.indices, write, bounds);
+}
+
+} // namespace
+
 glm::vec3 tri_normal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2) {
     return glm::normalize(glm::cross(p1 - p0, p2 - p0));
 }
@@ -63,6 +129,7 @@ Mesh make_quad(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3) {
         {p3, normal, {0, 1}},
     }};
     constexpr auto indices = quad_indices<1>();
+    generate_tangents(vertices, indices);
     return Mesh(vertices, indices);
 }
 
@@ -74,6 +141,7 @@ Mesh make_smooth_quad(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3) {
         {p3, tri_normal(p3, p0, p2), {0, 1}},
     }};
     constexpr auto indices = quad_indices<1>();
+    generate_tangents(vertices, indices);
     return Mesh(vertices, indices);
 }
 
@@ -88,12 +156,14 @@ constexpr glm::vec3 mul(const glm::mat3& m, const glm::vec3& v) {
 constexpr std::array<Vertex, 4> cube_face(const glm::mat3& orient, glm::vec2 tex_off) {
     constexpr glm::vec2 tex_size = {4, 3};
     glm::vec3 normal = orient[2];
+    // u runs along the face x axis and v along its y axis, a right-handed frame
+    uint32_t tangent = pack_tangent(orient[0], 1.f);
     std::array<Vertex, 4> verts;
     for (int i = 0; i < 4; i++) {
         glm::vec2 coord = {(i + 1) % 4 / 2, i / 2};
         glm::vec3 position = mul(orient, glm::vec3(coord, 1) - .5f);
         glm::vec2 tex_coords = (tex_off + coord) / tex_size;
-        verts[i] = {position, normal, tex_coords};
+        verts[i] = {position, normal, tex_coords, tangent};
     }
     return verts;
 };
@@ -146,25 +216,223 @@ Mesh make_cube_hardcoded() {
         {{-0.5f, +0.5f, -0.5f}, {+0.0f, +1.0f, +0.0f}, {0.25f, 1.0f}},
     }};
     constexpr auto indices = quad_indices<6>();
-    return Mesh(vertices, indices);
+    std::array<Vertex, 24> with_tangents = vertices;
+    generate_tangents(with_tangents, indices);
+    return Mesh(with_tangents, indices);
 }
 
-Mesh make_sphere(int nlat, int nlon) {
-    std::vector<Vertex> vertices;
-    vertices.reserve((nlat + 1) * (nlon + 1));
-    for (int i = 0; i <= nlat; i++) {
+void write_sphere(int nlat, int nlon, std::span<Vertex> vertices,
+                  std::span<unsigned int> indices, ThreadPool* pool) {
+    check_size(sphere_size(nlat, nlon), vertices, indices);
+    TrigTable theta(nlon, glm::two_pi<float>(), 0.f, true);
+    TrigTable phi(nlat, glm::pi<float>());
+    parallel_for(pool, size_t(nlat + 1), [&](size_t i) {
+        Vertex* row = vertices.data() + i * (nlon + 1);
+        float y = -phi.cos[i], r = phi.sin[i];
+        float v = float(i) / nlat;
         for (int j = 0; j <= nlon; j++) {
-            float theta = float(j % nlon) / nlon * glm::two_pi<float>();
-            float phi = float(i) / nlat * glm::pi<float>();
-            float x = glm::cos(theta) * glm::sin(phi);
-            float y = -glm::cos(phi);
-            float z = -glm::sin(theta) * glm::sin(phi);
-            float u = float(j) / nlon;
-            float v = float(i) / nlat;
-            vertices.push_back(
-                Vertex{.position = {x, y, z}, .normal = {x, y, z}, .tex_coords = {u, v}});
+            glm::vec3 p{theta.cos[j] * r, y, -theta.sin[j] * r};
+            // Along the parallel, also defined at the poles
+            glm::vec3 tangent{-theta.sin[j], 0, -theta.cos[j]};
+            row[j] = {p, p, {float(j) / nlon, v}, pack_tangent(tangent, 1.f)};
+        }
+    }, rows_per_task(nlon + 1));
+    write_grid_indices(nlat, nlon, 0, indices, pool);
+}
+
+Mesh make_sphere(int nlat, int nlon, ThreadPool* pool) {
+    return make_generated(sphere_size(nlat, nlon), {glm::vec3(-1), glm::vec3(1)},
+                          [&](std::span<Vertex> v, std::span<unsigned int> i) {
+                              write_sphere(nlat, nlon, v, i, pool);
+                          });
+}
+
+void write_icosphere(int frequency, std::span<Vertex> vertices,
+                     std::span<unsigned int> indices, ThreadPool* pool) {
+    check_size(icosphere_size(frequency), vertices, indices);
+    constexpr float t = 1.618033988749895f;
+    static constexpr glm::vec3 corners[12] = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+        {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+    };
+    static constexpr int faces[20][3] = {
+        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+        {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+        {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+        {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1},
+    };
+
+    int n = frequency;
+    size_t face_vertices = size_t(n + 1) * (n + 2) / 2;
+    // First vertex of row r within a face; row r has n - r + 1 vertices
+    auto row_start = [n](int r) { return unsigned(r * (n + 1) - r * (r - 1) / 2); };
+    parallel_for(pool, 20, [&](size_t f) {
+        Vertex* out = vertices.data() + f * face_vertices;
+        for (int r = 0; r <= n; r++) {
+            for (int c = 0; c <= n - r; c++) {
+                // Weights of the face corners, summed in corner order so vertices on
+                // shared edges come out bit-identical from both faces
+                std::array<std::pair<int, int>, 3> terms{
+                    {{faces[f][0], n - r - c}, {faces[f][1], c}, {faces[f][2], r}}};
+                std::ranges::sort(terms);
+                glm::vec3 p(0);
+                for (auto [corner, weight] : terms)
+                    p += float(weight) * corners[corner];
+                p = glm::normalize(p);
+                out[row_start(r) + c] = {p, p, sphere_uv(p),
+                                         pack_tangent(sphere_tangent(p), 1.f)};
+            }
+        }
+
+        unsigned int base = unsigned(f * face_vertices);
+        unsigned int* idx = indices.data() + f * 3 * n * n;
+        for (int r = 0; r < n; r++) {
+            for (int c = 0; c < n - r; c++) {
+                unsigned int a = base + row_start(r) + c, b = base + row_start(r + 1) + c;
+                *idx++ = a;
+                *idx++ = a + 1;
+                *idx++ = b;
+                if (c + 1 < n - r) {
+                    *idx++ = a + 1;
+                    *idx++ = b + 1;
+                    *idx++ = b;
+                }
+            }
+        }
+    }, rows_per_task(face_vertices));
+}
+
+Mesh make_icosphere(int frequency, ThreadPool* pool) {
+    return make_generated(icosphere_size(frequency), {glm::vec3(-1), glm::vec3(1)},
+                          [&](std::span<Vertex> v, std::span<unsigned int> i) {
+                              write_icosphere(frequency, v, i, pool);
+                          });
+}
+
+void write_cylinder(int segments, int stacks, std::span<Vertex> vertices,
+                    std::span<unsigned int> indices, ThreadPool* pool) {
+    check_size(cylinder_size(segments, stacks), vertices, indices);
+    TrigTable theta(segments, glm::two_pi<float>(), 0.f, true);
+    size_t ring = size_t(segments) + 1;
+
+    parallel_for(pool, size_t(stacks + 1), [&](size_t i) {
+        Vertex* row = vertices.data() + i * ring;
+        float v = float(i) / stacks;
+        for (int j = 0; j <= segments; j++) {
+            glm::vec3 normal{theta.cos[j], 0, -theta.sin[j]};
+            uint32_t tangent = pack_tangent({-theta.sin[j], 0, -theta.cos[j]}, 1.f);
+            row[j] = {normal + glm::vec3(0, 2 * v - 1, 0), normal, {float(j) / segments, v},
+                      tangent};
+        }
+    }, rows_per_task(ring));
+    size_t side_indices = size_t(6) * stacks * segments;
+    write_grid_indices(stacks, segments, 0, indices.first(side_indices), pool);
+
+    // Caps: a center vertex followed by a ring, bottom then top
+    unsigned int* idx = indices.data() + side_indices;
+    for (int cap = 0; cap < 2; cap++) {
+        float y = cap ? 1.f : -1.f;
+        size_t first = (stacks + 1) * ring + cap * (ring + 1);
+        Vertex* out = vertices.data() + first;
+        // u along +x on both caps; v along -z on the top and +z on the bottom
+        uint32_t tangent = pack_tangent({1, 0, 0}, 1.f);
+        out[0] = {{0, y, 0}, {0, y, 0}, {0.5f, 0.5f}, tangent};
+        for (int j = 0; j <= segments; j++) {
+            float x = theta.cos[j], z = -theta.sin[j];
+            out[j + 1] = {{x, y, z}, {0, y, 0}, {0.5f + 0.5f * x, 0.5f - 0.5f * y * z},
+                          tangent};
+        }
+        auto center = unsigned(first);
+        for (unsigned int j = 0; j < unsigned(segments); j++) {
+            // The top winds with the ring's direction, the bottom against it
+            *idx++ = center;
+            *idx++ = center + 1 + (cap ? j : j + 1);
+            *idx++ = center + 1 + (cap ? j + 1 : j);
         }
     }
-    auto indices = quad_grid_indices(nlat, nlon);
-    return Mesh(vertices, indices);
+}
+
+Mesh make_cylinder(int segments, int stacks, ThreadPool* pool) {
+    return make_generated(cylinder_size(segments, stacks), {glm::vec3(-1), glm::vec3(1)},
+                          [&](std::span<Vertex> v, std::span<unsigned int> i) {
+                              write_cylinder(segments, stacks, v, i, pool);
+                          });
+}
+
+void write_torus(float major_radius, float minor_radius, int nmajor, int nminor,
+                 std::span<Vertex> vertices, std::span<unsigned int> indices,
+                 ThreadPool* pool) {
+    check_size(torus_size(nmajor, nminor), vertices, indices);
+    TrigTable theta(nmajor, glm::two_pi<float>(), 0.f, true);
+    // Rows start at the inner equator and go down and around, so the outside faces
+    // are oriented like the sphere's
+    TrigTable phi(nminor, glm::two_pi<float>(), -glm::pi<float>(), true);
+    parallel_for(pool, size_t(nminor + 1), [&](size_t i) {
+        Vertex* row = vertices.data() + i * (nmajor + 1);
+        float v = float(i) / nminor;
+        for (int j = 0; j <= nmajor; j++) {
+            glm::vec3 dir{theta.cos[j], 0, -theta.sin[j]};
+            glm::vec3 normal = phi.cos[i] * dir + glm::vec3(0, phi.sin[i], 0);
+            glm::vec3 tangent{-theta.sin[j], 0, -theta.cos[j]};
+            row[j] = {major_radius * dir + minor_radius * normal, normal,
+                      {float(j) / nmajor, v}, pack_tangent(tangent, 1.f)};
+        }
+    }, rows_per_task(nmajor + 1));
+    write_grid_indices(nminor, nmajor, 0, indices, pool);
+}
+
+Mesh make_torus(float major_radius, float minor_radius, int nmajor, int nminor,
+                ThreadPool* pool) {
+    glm::vec3 extent{major_radius + minor_radius, minor_radius, major_radius + minor_radius};
+    return make_generated(torus_size(nmajor, nminor), {-extent, extent},
+                          [&](std::span<Vertex> v, std::span<unsigned int> i) {
+                              write_torus(major_radius, minor_radius, nmajor, nminor, v, i,
+                                          pool);
+                          });
+}
+
+void write_heightfield(std::span<const float> heights, int width, int depth, glm::vec3 scale,
+                       std::span<Vertex> vertices, std::span<unsigned int> indices,
+                       ThreadPool* pool) {
+    check_heights(heights, width, depth);
+    check_size(heightfield_size(width, depth), vertices, indices);
+    auto height = [&](int i, int j) {
+        i = std::clamp(i, 0, depth - 1);
+        j = std::clamp(j, 0, width - 1);
+        return heights[size_t(i) * width + j] * scale.y;
+    };
+    glm::vec2 spacing{scale.x / (width - 1), scale.z / (depth - 1)};
+
+    parallel_for(pool, size_t(depth), [&](size_t row) {
+        int i = int(row);
+        Vertex* out = vertices.data() + row * width;
+        float v = float(i) / (depth - 1);
+        for (int j = 0; j < width; j++) {
+            float u = float(j) / (width - 1);
+            // Central differences, one-sided at the borders; rows advance towards -z
+            float dx = (height(i, j + 1) - height(i, j - 1)) /
+                       (spacing.x * float(std::min(j + 1, width - 1) - std::max(j - 1, 0)));
+            float dz = -(height(i + 1, j) - height(i - 1, j)) /
+                       (spacing.y * float(std::min(i + 1, depth - 1) - std::max(i - 1, 0)));
+            // u runs along +x, v along -z
+            out[j] = {{(u - 0.5f) * scale.x, height(i, j), (0.5f - v) * scale.z},
+                      glm::normalize(glm::vec3(-dx, 1, -dz)),
+                      {u, v},
+                      pack_tangent(glm::normalize(glm::vec3(1, dx, 0)), 1.f)};
+        }
+    }, rows_per_task(width));
+    write_grid_indices(depth - 1, width - 1, 0, indices, pool);
+}
+
+Mesh make_heightfield(std::span<const float> heights, int width, int depth, glm::vec3 scale,
+                      ThreadPool* pool) {
+    check_heights(heights, width, depth);
+    auto [low, high] = std::ranges::minmax(heights);
+    glm::vec3 a{0.5f * scale.x, low * scale.y, 0.5f * scale.z};
+    glm::vec3 b{-0.5f * scale.x, high * scale.y, -0.5f * scale.z};
+    Bounds bounds{glm::min(a, b), glm::max(a, b)};
+    return make_generated(heightfield_size(width, depth), bounds,
+                          [&](std::span<Vertex> v, std::span<unsigned int> i) {
+                              write_heightfield(heights, width, depth, scale, v, i, pool);
+                          });
 }
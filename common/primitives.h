@@ -1,14 +1,211 @@
 #ifndef PRIMITIVES_H
 #define PRIMITIVES_H
 
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <span>
+
 #include <glm/glm.hpp>
 
+#include "constexpr_math.h"
 #include "mesh.h"
+#include "tangents.h"
+#include "thread_pool.h"
 
 Mesh make_quad(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3);
 
 Mesh make_cube();
 
-Mesh make_sphere(int nlat, int nlon);
+// Tessellated shapes come in three parts: *_size() gives the vertex and index counts,
+// write_*() fills caller-provided storage of exactly that size (e.g. a mapped GL
+// buffer), and make_*() builds a Mesh by writing straight into its mapped buffers.
+// Writers evaluate trigonometry once per row and column, not per vertex, and given a
+// pool, split the rows of large meshes across it. All shapes are centered at the origin
+// with counter-clockwise outward faces.
+struct MeshSize {
+    size_t vertices, indices;
+};
+
+// Unit UV sphere with nlat rings and nlon segments; the seam column is duplicated
+constexpr MeshSize sphere_size(int nlat, int nlon) {
+    return {size_t(nlat + 1) * (nlon + 1), size_t(6) * nlat * nlon};
+}
+void write_sphere(int nlat, int nlon, std::span<Vertex> vertices,
+                  std::span<unsigned int> indices, ThreadPool* pool = nullptr);
+Mesh make_sphere(int nlat, int nlon, ThreadPool* pool = nullptr);
+
+// Unit sphere from an icosahedron whose edges are split into frequency segments, for
+// evenly sized triangles. Faces don't share vertices; edge vertices are evaluated the
+// same way on both sides so there are no cracks.
+constexpr MeshSize icosphere_size(int frequency) {
+    auto n = size_t(frequency);
+    return {20 * (n + 1) * (n + 2) / 2, 20 * 3 * n * n};
+}
+void write_icosphere(int frequency, std::span<Vertex> vertices,
+                     std::span<unsigned int> indices, ThreadPool* pool = nullptr);
+Mesh make_icosphere(int frequency, ThreadPool* pool = nullptr);
+
+// Capped cylinder of radius 1 along y from -1 to 1
+constexpr MeshSize cylinder_size(int segments, int stacks) {
+    size_t ring = size_t(segments) + 1;
+    return {(stacks + 1) * ring + 2 * (ring + 1),
+            size_t(6) * stacks * segments + size_t(6) * segments};
+}
+void write_cylinder(int segments, int stacks, std::span<Vertex> vertices,
+                    std::span<unsigned int> indices, ThreadPool* pool = nullptr);
+Mesh make_cylinder(int segments, int stacks = 1, ThreadPool* pool = nullptr);
+
+// Torus around the y axis
+constexpr MeshSize torus_size(int nmajor, int nminor) {
+    return {size_t(nminor + 1) * (nmajor + 1), size_t(6) * nminor * nmajor};
+}
+void write_torus(float major_radius, float minor_radius, int nmajor, int nminor,
+                 std::span<Vertex> vertices, std::span<unsigned int> indices,
+                 ThreadPool* pool = nullptr);
+Mesh make_torus(float major_radius, float minor_radius, int nmajor, int nminor,
+                ThreadPool* pool = nullptr);
+
+// Plane facing +y from a width x depth grid of row-major heights (rows run from +z to
+// -z), spanning scale.x by scale.z with heights multiplied by scale.y
+constexpr MeshSize heightfield_size(int width, int depth) {
+    return {size_t(width) * depth, size_t(6) * (width - 1) * (depth - 1)};
+}
+void write_heightfield(std::span<const float> heights, int width, int depth, glm::vec3 scale,
+                       std::span<Vertex> vertices, std::span<unsigned int> indices,
+                       ThreadPool* pool = nullptr);
+Mesh make_heightfield(std::span<const float> heights, int width, int depth, glm::vec3 scale,
+                      ThreadPool* pool = nullptr);
+
+// Fixed tessellations evaluated at compile time: the vertex and index arrays are
+// constants baked into the binary, so make_sphere<8, 16>() only uploads them. Layouts
+// match the runtime writers of the same shapes.
+namespace static_primitives {
+
+// Indices of a grid of Rows x Cols cells, as in the runtime writers
+template <int Rows, int Cols>
+constexpr std::array<unsigned int, size_t(6) * Rows * Cols> grid_indices() {
+    std::array<unsigned int, size_t(6) * Rows * Cols> indices{};
+    constexpr unsigned int rowlen = Cols + 1;
+    size_t k = 0;
+    for (unsigned int i = 0; i < Rows; i++) {
+        for (unsigned int j = 0; j < Cols; j++) {
+            unsigned int a = rowlen * i + j;
+            for (unsigned int index :
+                 {a, a + 1, a + rowlen + 1, a + rowlen + 1, a + rowlen, a})
+                indices[k++] = index;
+        }
+    }
+    return indices;
+}
+
+template <size_t N>
+constexpr bool unit_normals(const std::array<Vertex, N>& vertices) {
+    for (auto& vertex : vertices) {
+        glm::vec3 n = vertex.normal;
+        float error = n.x * n.x + n.y * n.y + n.z * n.z - 1;
+        if (error > 4 * std::numeric_limits<float>::epsilon() ||
+            -error > 4 * std::numeric_limits<float>::epsilon())
+            return false;
+    }
+    return true;
+}
+
+template <int NLat, int NLon>
+struct Sphere {
+    static_assert(NLat >= 2 && NLon >= 3, "sphere needs at least 2 rings and 3 segments");
+    static constexpr MeshSize size = sphere_size(NLat, NLon);
+
+    static constexpr std::array<Vertex, size.vertices> vertices = [] {
+        std::array<Vertex, size.vertices> vertices{};
+        for (int i = 0; i <= NLat; i++) {
+            double phi = std::numbers::pi * i / NLat;
+            double y = -cx::cos(phi), r = cx::sin(phi);
+            for (int j = 0; j <= NLon; j++) {
+                double theta = 2 * std::numbers::pi * (j % NLon) / NLon;
+                glm::vec3 p{float(cx::cos(theta) * r), float(y), float(-cx::sin(theta) * r)};
+                glm::vec3 tangent{float(-cx::sin(theta)), 0, float(-cx::cos(theta))};
+                vertices[size_t(i) * (NLon + 1) + j] = {
+                    p, p, {float(j) / NLon, float(i) / NLat}, pack_tangent(tangent, 1.f)};
+            }
+        }
+        return vertices;
+    }();
+    static constexpr auto indices = grid_indices<NLat, NLon>();
+
+    static_assert(indices.size() == size.indices);
+    static_assert(unit_normals(vertices));
+};
+
+template <int Segments, int Stacks>
+struct Cylinder {
+    static_assert(Segments >= 3 && Stacks >= 1, "cylinder needs 3 segments and a stack");
+    static constexpr MeshSize size = cylinder_size(Segments, Stacks);
+
+    static constexpr std::array<Vertex, size.vertices> vertices = [] {
+        std::array<Vertex, size.vertices> vertices{};
+        std::array<float, Segments + 1> cos{}, sin{};
+        for (int j = 0; j <= Segments; j++) {
+            double theta = 2 * std::numbers::pi * (j % Segments) / Segments;
+            cos[j] = float(cx::cos(theta));
+            sin[j] = float(cx::sin(theta));
+        }
+        size_t k = 0;
+        for (int i = 0; i <= Stacks; i++) {
+            float v = float(i) / Stacks;
+            for (int j = 0; j <= Segments; j++) {
+                vertices[k++] = {{cos[j], 2 * v - 1, -sin[j]},
+                                 {cos[j], 0, -sin[j]},
+                                 {float(j) / Segments, v},
+                                 pack_tangent({-sin[j], 0, -cos[j]}, 1.f)};
+            }
+        }
+        constexpr uint32_t cap_tangent = pack_tangent({1, 0, 0}, 1.f);
+        for (float y : {-1.f, 1.f}) {
+            vertices[k++] = {{0, y, 0}, {0, y, 0}, {0.5f, 0.5f}, cap_tangent};
+            for (int j = 0; j <= Segments; j++) {
+                vertices[k++] = {{cos[j], y, -sin[j]},
+                                 {0, y, 0},
+                                 {0.5f + 0.5f * cos[j], 0.5f + 0.5f * y * sin[j]},
+                                 cap_tangent};
+            }
+        }
+        return vertices;
+    }();
+
+    static constexpr std::array<unsigned int, size.indices> indices = [] {
+        std::array<unsigned int, size.indices> indices{};
+        auto side = grid_indices<Stacks, Segments>();
+        size_t k = 0;
+        for (unsigned int index : side) indices[k++] = index;
+        constexpr unsigned int ring = Segments + 1;
+        for (unsigned int cap = 0; cap < 2; cap++) {
+            unsigned int center = (Stacks + 1) * ring + cap * (ring + 1);
+            for (unsigned int j = 0; j < Segments; j++) {
+                indices[k++] = center;
+                indices[k++] = center + 1 + (cap ? j : j + 1);
+                indices[k++] = center + 1 + (cap ? j + 1 : j);
+            }
+        }
+        return indices;
+    }();
+
+    static_assert(unit_normals(vertices));
+};
+
+} // namespace static_primitives
+
+template <int NLat, int NLon>
+Mesh make_sphere() {
+    using Shape = static_primitives::Sphere<NLat, NLon>;
+    return Mesh(Shape::vertices, Shape::indices);
+}
+
+template <int Segments, int Stacks = 1>
+Mesh make_cylinder() {
+    using Shape = static_primitives::Cylinder<Segments, Stacks>;
+    return Mesh(Shape::vertices, Shape::indices);
+}
 
 #endif // PRIMITIVES_H
@@ -0,0 +1,54 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <array>
+#include <optional>
+
+#include <glad/glad.h>
+
+#include "raii.h"
+
+using QueryHandle = Handle<GLuint, gl_delete_array_functor<glDeleteQueries>>;
+using SyncHandle = Handle<GLsync, functor<glDeleteSync>>;
+
+// Ring of GL queries of one target (e.g. GL_SAMPLES_PASSED) that are read back a few
+// frames late, so checking results never stalls the pipeline
+template <size_t N = 3>
+class QueryRing {
+  public:
+    explicit QueryRing(GLenum target) : target_(target) {
+        for (auto& query : queries_) {
+            glCreateQueries(target, 1, &query.reset_as_ref());
+        }
+    }
+
+    void begin() { glBeginQuery(target_, *queries_[next_]); }
+    void end() {
+        glEndQuery(target_);
+        issued_[next_] = true;
+        next_ = (next_ + 1) % N;
+    }
+
+    // Result of the oldest query in the ring if it is available, i.e. the query
+    // issued N - 1 frames ago
+    std::optional<GLuint64> result() const {
+        size_t oldest = next_;
+        if (!issued_[oldest])
+            return std::nullopt;
+        GLint available;
+        glGetQueryObjectiv(*queries_[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return std::nullopt;
+        GLuint64 value;
+        glGetQueryObjectui64v(*queries_[oldest], GL_QUERY_RESULT, &value);
+        return value;
+    }
+
+  private:
+    GLenum target_;
+    std::array<QueryHandle, N> queries_;
+    std::array<bool, N> issued_{};
+    size_t next_ = 0;
+};
+
+#endif // QUERY_H
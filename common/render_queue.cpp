@@ -0,0 +1,105 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+namespace {
+
+// pmr containers keep their memory resource on assignment, so rebuild in place to
+// switch (or, after an arena reset, forget) their storage
+template <typename T>
+void rebind(std::pmr::vector<T>& v, std::pmr::memory_resource* resource) {
+    std::destroy_at(&v);
+    std::construct_at(&v, resource);
+}
+
+} // namespace
+
+void RenderQueue::record(ThreadPool& pool, std::span<const SceneObject> objects,
+                         const glm::mat4& view, const glm::mat4& projection) {
+    view_ = view;
+    projection_ = projection;
+    size_t last_count = packets_.size();
+    // Nothing may point into the arena across the reset
+    for (size_t i = 0; i < lists_.size(); i++)
+        rebind(lists_[i], &arena_.local(i));
+    rebind(packets_, &arena_.local(pool.thread_index()));
+    arena_.reset();
+    // Work stealing decides how many packets each thread records, and any one may get
+    // most of them. With room for all of last frame's in every list, no list regrows
+    // and each arena settles at one size instead of growing whenever its share peaks.
+    for (auto& list : lists_)
+        list.reserve(last_count);
+
+    pool.parallel_for(
+        objects.size(),
+        [&](size_t i) {
+            auto& list = lists_[pool.thread_index()];
+            const SceneObject& object = objects[i];
+            glm::mat4 modelview = view * object.transform;
+            glm::mat4 mvp = projection * modelview;
+            for (auto& mesh : object.model->meshes()) {
+                if (!mesh->bounds().intersects_frustum(mvp))
+                    continue;
+                glm::vec4 center = modelview * glm::vec4(mesh->bounds().center(), 1);
+                const Material* material = mesh->material().get();
+                list.push_back({
+                    .mesh = mesh.get(),
+                    .material = material,
+                    .features = material ? material->features : 0,
+                    .depth = -center.z,
+                    .model = object.transform,
+                });
+            }
+        },
+        16);
+
+    size_t count = 0;
+    for (auto& list : lists_)
+        count += list.size();
+    packets_.reserve(count);
+    for (auto& list : lists_)
+        packets_.insert(packets_.end(), list.begin(), list.end());
+    // Fewest program and material changes first, then front to back within a material
+    std::ranges::sort(packets_, {}, [](const DrawPacket& p) {
+        return std::tuple(p.features, p.material, p.depth);
+    });
+}
+
+void RenderQueue::submit(ShaderVariants& shaders,
+                         util::function_ref<void(const Shader&)> setup,
+                         DynamicBuffer* per_draw, const MaterialTable* materials) const {
+    const Shader* current = nullptr;
+    const Material* material = nullptr;
+    for (auto& packet : packets_) {
+        const Shader& shader = shaders.get(packet.features);
+        if (&shader != current) {
+            shader.use();
+            if (per_draw) {
+                GLuint block = glGetUniformBlockIndex(shader.id(), "PerDraw");
+                glUniformBlockBinding(shader.id(), block, PER_DRAW_BINDING);
+            }
+            if (materials)
+                materials->bind(shader);
+            setup(shader);
+            current = &shader;
+            material = nullptr;
+        }
+        if (packet.material != material && packet.material) {
+            if (materials)
+                materials->select(shader, packet.material);
+            else
+                packet.material->apply(shader);
+            material = packet.material;
+        }
+        if (per_draw) {
+            glm::mat4 normal_matrix(glm::transpose(glm::inverse(glm::mat3(packet.model))));
+            per_draw->bind(PER_DRAW_BINDING,
+                           per_draw->push(PerDraw{packet.model, normal_matrix}));
+        } else {
+            shader.set_mat4("model", packet.model);
+        }
+        packet.mesh->draw();
+    }
+}
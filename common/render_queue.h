@@ -0,0 +1,84 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "dynamic_buffer.h"
+#include "frame_arena.h"
+#include "material.h"
+#include "material_table.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+// One model instance in the scene
+struct SceneObject {
+    const Model* model;
+    glm::mat4 transform{1};
+};
+
+// Everything needed to issue one draw, without touching GL, so packets can be built
+// on any thread
+struct DrawPacket {
+    const Mesh* mesh;
+    const Material* material;
+    unsigned int features;
+    // View-space distance of the mesh bounds' center, for front-to-back order
+    float depth;
+    glm::mat4 model;
+};
+
+// Frame-sized list of draw packets. Worker threads record into their own list, then
+// the GL thread merges, sorts and replays them. All packet storage comes from the
+// queue's FrameArena, which record() resets, so steady-state frames don't touch the
+// heap.
+class RenderQueue {
+  public:
+    // One list and sub-arena per pool worker plus one for threads outside the pool
+    explicit RenderQueue(const ThreadPool& pool)
+        : arena_(pool.size() + 1), lists_(pool.size() + 1) {}
+
+    // Frustum culls the meshes of every object and records packets for the visible
+    // ones on the pool. Replaces the queue's previous contents.
+    void record(ThreadPool& pool, std::span<const SceneObject> objects,
+                const glm::mat4& view, const glm::mat4& projection);
+
+    // Draws the sorted packets on the GL thread. setup is called with each shader
+    // right after it becomes active. Per-packet transforms are set with the "model"
+    // uniform, or written to per_draw and bound as the PerDraw uniform block when the
+    // shaders were built with per_draw_defines(). Given a table built from the packets'
+    // materials (and shaders built with its defines()), materials are switched by index
+    // instead of through Material::apply.
+    void submit(ShaderVariants& shaders, util::function_ref<void(const Shader&)> setup,
+                DynamicBuffer* per_draw = nullptr,
+                const MaterialTable* materials = nullptr) const;
+
+    static constexpr GLuint PER_DRAW_BINDING = 0;
+    static ShaderDefines per_draw_defines() { return {{"PER_DRAW_UBO", "1"}}; }
+
+    const glm::mat4& view() const { return view_; }
+    const glm::mat4& projection() const { return projection_; }
+    std::span<const DrawPacket> packets() const { return packets_; }
+    const FrameArena& arena() const { return arena_; }
+
+  private:
+    // std140 layout of the PerDraw block in shader.vs
+    struct PerDraw {
+        glm::mat4 model;
+        glm::mat4 normal_matrix;
+    };
+
+    FrameArena arena_;
+    std::vector<std::pmr::vector<DrawPacket>> lists_;
+    std::pmr::vector<DrawPacket> packets_;
+    glm::mat4 view_{1}, projection_{1};
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,182 @@
+#ifndef RESOURCE_POOL_H
+#define RESOURCE_POOL_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "errutils.h"
+#include "query.h"
+#include "raii.h"
+
+// Generational index into a ResourcePool<T>. Generation 0 is never issued, so a
+// default constructed id is null, as Handle<T, D> expects.
+template <typename T>
+struct ResourceId {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return generation != 0; }
+    bool operator==(const ResourceId&) const = default;
+};
+
+// Counts frames and fences each one, so resources can be destroyed once the GPU is
+// done with the last frame that may have used them
+class FrameTimeline {
+  public:
+    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    // Number of the frame being recorded
+    uint64_t current() const { return frame_; }
+    // Newest frame the GPU has finished, polled without blocking
+    uint64_t completed() {
+        while (completed_ + 1 < frame_) {
+            auto& fence = fences_[(completed_ + 1) % MAX_FRAMES_IN_FLIGHT];
+            if (fence && glClientWaitSync(*fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                break;
+            fence.reset();
+            ++completed_;
+        }
+        return completed_;
+    }
+
+    // Fences the current frame's commands and starts the next one. When
+    // MAX_FRAMES_IN_FLIGHT frames are pending, blocks on the oldest.
+    void end_frame() {
+        fences_[frame_ % MAX_FRAMES_IN_FLIGHT].reset(
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        ++frame_;
+        if (frame_ - completed_ > MAX_FRAMES_IN_FLIGHT) {
+            auto& oldest = fences_[(completed_ + 1) % MAX_FRAMES_IN_FLIGHT];
+            glClientWaitSync(*oldest, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+            oldest.reset();
+            ++completed_;
+        }
+    }
+
+  private:
+    // Frame 0 counts as completed so resources released before the first frame are
+    // destroyed right away
+    uint64_t frame_ = 1, completed_ = 0;
+    std::array<SyncHandle, MAX_FRAMES_IN_FLIGHT> fences_;
+};
+
+// Dense pool of T addressed by generational ids. Live values are kept contiguous (with
+// their ids in a parallel array) so systems can scan them linearly; a sparse slot
+// table maps ids to dense positions. Stale ids are detected by their generation.
+//
+// release() only queues a value: it stays alive, and its id valid, until the GPU has
+// finished the frame it was released in, then collect() destroys it.
+template <typename T>
+class ResourcePool {
+  public:
+    using Id = ResourceId<T>;
+
+    // Releases an id back to its pool, for Handle<Id, Deleter>
+    struct Deleter {
+        ResourcePool* pool = nullptr;
+        void operator()(Id id) const { pool->release(id); }
+    };
+    // Owning id that releases its resource when destroyed
+    using Owned = Handle<Id, Deleter>;
+
+    explicit ResourcePool(FrameTimeline& timeline) : timeline_(&timeline) {}
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    Id insert(T value) {
+        uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            index = uint32_t(slots_.size());
+            slots_.push_back({0, 1});
+        }
+        Slot& slot = slots_[index];
+        slot.dense = uint32_t(values_.size());
+        Id id{index, slot.generation};
+        values_.push_back(std::move(value));
+        ids_.push_back(id);
+        return id;
+    }
+    Owned create(T value) { return Owned(insert(std::move(value)), Deleter{this}); }
+
+    bool contains(Id id) const {
+        return id && id.index < slots_.size() && slots_[id.index].generation == id.generation;
+    }
+    // Value for id, or nullptr if it was destroyed
+    T* get(Id id) { return contains(id) ? &values_[slots_[id.index].dense] : nullptr; }
+    const T* get(Id id) const {
+        return contains(id) ? &values_[slots_[id.index].dense] : nullptr;
+    }
+    T& operator[](Id id) {
+        err::check(contains(id), "stale resource id {}:{}", id.index, id.generation);
+        return values_[slots_[id.index].dense];
+    }
+
+    // Queues id for destruction once the GPU finishes the current frame
+    void release(Id id) {
+        if (contains(id))
+            pending_.push_back({id, timeline_->current()});
+    }
+    // Destroys released values whose frame the GPU has completed. Call once per frame.
+    void collect() {
+        uint64_t completed = timeline_->completed();
+        std::erase_if(pending_, [&](const Pending& p) {
+            if (p.frame > completed)
+                return false;
+            destroy(p.id);
+            return true;
+        });
+    }
+
+    // Live values and their ids, in the same (unspecified) order
+    std::span<T> values() { return values_; }
+    std::span<const T> values() const { return values_; }
+    std::span<const Id> ids() const { return ids_; }
+    size_t size() const { return values_.size(); }
+    size_t pending() const { return pending_.size(); }
+
+  private:
+    struct Slot {
+        uint32_t dense;
+        uint32_t generation;
+    };
+    struct Pending {
+        Id id;
+        uint64_t frame;
+    };
+
+    void destroy(Id id) {
+        if (!contains(id))
+            return;
+        Slot& slot = slots_[id.index];
+        // Swap-and-pop keeps the dense arrays contiguous
+        uint32_t last = uint32_t(values_.size() - 1);
+        if (slot.dense != last) {
+            values_[slot.dense] = std::move(values_[last]);
+            ids_[slot.dense] = ids_[last];
+            slots_[ids_[last].index].dense = slot.dense;
+        }
+        values_.pop_back();
+        ids_.pop_back();
+        // Skip 0 on wrap-around, it marks null ids
+        if (++slot.generation == 0)
+            slot.generation = 1;
+        free_.push_back(id.index);
+    }
+
+    FrameTimeline* timeline_;
+    std::vector<T> values_;
+    std::vector<Id> ids_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_;
+    std::vector<Pending> pending_;
+};
+
+#endif // RESOURCE_POOL_H
@@ -0,0 +1,75 @@
+#include "resources.h"
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+Resources::Imported Resources::import(Model&& model) {
+    auto [meshes, materials] = model.release();
+    // References the model holds itself; any more and the material is shared
+    std::unordered_map<const Material*, long> material_refs;
+    for (auto& material : materials)
+        material_refs[material.get()]++;
+    for (auto& mesh : meshes) {
+        err::check(mesh.use_count() == 1, "mesh {} is shared outside the model",
+                   mesh->name());
+        material_refs[mesh->material().get()]++;
+    }
+    auto check_material = [&](const std::shared_ptr<Material>& material) {
+        if (material) {
+            err::check(material.use_count() == material_refs[material.get()],
+                       "material {} is shared outside the model", material->name);
+        }
+    };
+    for (auto& material : materials)
+        check_material(material);
+    for (auto& mesh : meshes)
+        check_material(mesh->material());
+
+    Imported imported;
+    std::unordered_map<const Material*, MaterialId> material_ids;
+    auto add_material = [&](const std::shared_ptr<Material>& material) {
+        if (!material || material_ids.contains(material.get()))
+            return;
+        MaterialHandle handle = materials_.create(std::move(*material));
+        material_ids.emplace(material.get(), *handle);
+        imported.materials.push_back(std::move(handle));
+    };
+    for (auto& material : materials)
+        add_material(material);
+    for (auto& mesh : meshes)
+        add_material(mesh->material());
+
+    for (auto& mesh : meshes) {
+        MaterialId material = util::get_or_default(material_ids, mesh->material().get());
+        mesh->set_material(nullptr);
+        imported.meshes.push_back(meshes_.create({std::move(*mesh), material}));
+    }
+    return imported;
+}
+
+void Resources::draw(ShaderVariants& shaders, util::function_ref<void(const Shader&)> setup) {
+    const Shader* current = nullptr;
+    MaterialId current_material;
+    for (auto& entry : meshes_.values()) {
+        const Material* material = materials_.get(entry.material);
+        const Shader& shader = shaders.get(material ? material->features : 0);
+        if (&shader != current) {
+            shader.use();
+            setup(shader);
+            current = &shader;
+            current_material = {};
+        }
+        if (material && entry.material != current_material) {
+            material->apply(shader);
+            current_material = entry.material;
+        }
+        entry.mesh.draw();
+    }
+}
+
+void Resources::end_frame() {
+    timeline_.end_frame();
+    meshes_.collect();
+    materials_.collect();
+}
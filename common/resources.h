@@ -0,0 +1,58 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <vector>
+
+#include "material.h"
+#include "mesh.h"
+#include "model.h"
+#include "resource_pool.h"
+#include "shader_variants.h"
+#include "utils.h"
+
+using MaterialId = ResourceId<Material>;
+
+// Mesh plus its material, stored side by side so drawing needs no pointer chasing
+struct MeshEntry {
+    Mesh mesh;
+    MaterialId material;
+};
+using MeshId = ResourceId<MeshEntry>;
+
+// Owning ids
+using MeshHandle = ResourcePool<MeshEntry>::Owned;
+using MaterialHandle = ResourcePool<Material>::Owned;
+
+// Meshes and materials in generational pools sharing one frame timeline. Textures are
+// owned by the materials. Owning handles must not outlive it.
+class Resources {
+  public:
+    Resources() : materials_(timeline_), meshes_(timeline_) {}
+
+    struct Imported {
+        std::vector<MeshHandle> meshes;
+        std::vector<MaterialHandle> materials;
+    };
+    // Moves a model's meshes and materials into the pools. The model must be their
+    // only owner; this is checked before anything is moved.
+    Imported import(Model&& model);
+
+    // Draws every mesh in pool order with the permutation for its material's
+    // features, see Model::draw
+    void draw(ShaderVariants& shaders, util::function_ref<void(const Shader&)> setup);
+
+    // Fences the frame and destroys resources released in frames the GPU has finished
+    void end_frame();
+
+    FrameTimeline& timeline() { return timeline_; }
+    ResourcePool<Material>& materials() { return materials_; }
+    ResourcePool<MeshEntry>& meshes() { return meshes_; }
+
+  private:
+    // Declared first so the pools can reference it
+    FrameTimeline timeline_;
+    ResourcePool<Material> materials_;
+    ResourcePool<MeshEntry> meshes_;
+};
+
+#endif // RESOURCES_H
@@ -1,28 +1,127 @@
 #include "shader.h"
 
+#include <cctype>
 #include <filesystem>
-#include <fstream>
 #include <optional>
-#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include <glad/glad.h>
 
 #include "cstring_view.h"
 #include "errutils.h"
+#include "vfs.h"
 
 namespace {
 
-std::string read_file(const std::filesystem::path& filename) {
-    std::ifstream file(filename);
-    err::check_errno(file, "failed to open file: {}: {}", filename.string());
-    std::stringstream sstream;
-    sstream << file.rdbuf();
-    return std::move(sstream).str();
+// The rest of the line after a #name directive, or nullopt if the line is not one.
+// Only directives starting the line count, so mentions in comments are skipped.
+std::optional<std::string_view> parse_directive(std::string_view line,
+                                                std::string_view name) {
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == line.npos || line[pos] != '#')
+        return std::nullopt;
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == line.npos || line.substr(pos, name.size()) != name)
+        return std::nullopt;
+    std::string_view rest = line.substr(pos + name.size());
+    // A longer name, e.g. #versions
+    if (!rest.empty() && (std::isalnum(static_cast<unsigned char>(rest[0])) || rest[0] == '_'))
+        return std::nullopt;
+    return rest;
 }
 
+bool has_version(std::string_view source) {
+    while (!source.empty()) {
+        size_t eol = source.find('\n');
+        if (parse_directive(source.substr(0, eol), "version"))
+            return true;
+        source = eol != source.npos ? source.substr(eol + 1) : std::string_view();
+    }
+    return false;
+}
+
+// Parses the file name out of an #include "file" or #include <file> directive.
+// Returns nullopt if the line is not an include directive.
+std::optional<std::string_view> parse_include(std::string_view line) {
+    auto rest = parse_directive(line, "include");
+    if (!rest)
+        return std::nullopt;
+    size_t open = rest->find_first_of("\"<");
+    err::check(open != rest->npos, "malformed shader include: {}", line);
+    char close_char = (*rest)[open] == '"' ? '"' : '>';
+    size_t close = rest->find(close_char, open + 1);
+    err::check(close != rest->npos, "malformed shader include: {}", line);
+    return rest->substr(open + 1, close - open - 1);
+}
+
+class ShaderPreprocessor {
+  public:
+    ShaderPreprocessor(const ShaderDefines& defines, std::vector<std::filesystem::path>* files)
+        : defines_(defines), files_(files) {}
+
+    std::string process(const std::filesystem::path& path) {
+        process_file(path, true);
+        return std::move(out_);
+    }
+
+  private:
+    void process_file(const std::filesystem::path& path, bool root) {
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path);
+        for (auto& seen : seen_) {
+            if (seen == canonical)
+                return;
+        }
+        // Source string numbers in #line directives index into seen_, so compile errors
+        // in included files can be traced back
+        int file_index = int(seen_.size());
+        seen_.push_back(canonical);
+        if (files_)
+            files_->push_back(path);
+
+        // Copied rather than mapped: a hot reload may read the file while an editor
+        // truncates and rewrites it
+        FileData file = vfs::read_copy(path);
+        std::string_view source = file.text();
+        std::string_view rest = source;
+        bool version_seen = false;
+        if (!root)
+            out_.append(std::format("#line 1 {}\n", file_index));
+        else if (!has_version(source))
+            emit_defines(1, file_index);
+        for (int line_num = 1; !rest.empty(); line_num++) {
+            size_t eol = rest.find('\n');
+            std::string_view line = rest.substr(0, eol);
+            rest = eol != rest.npos ? rest.substr(eol + 1) : std::string_view();
+
+            if (root && !version_seen && parse_directive(line, "version")) {
+                version_seen = true;
+                out_.append(line).append("\n");
+                emit_defines(line_num + 1, file_index);
+            } else if (auto include = parse_include(line)) {
+                process_file(path.parent_path() / *include, false);
+                out_.append(std::format("#line {} {}\n", line_num + 1, file_index));
+            } else {
+                out_.append(line).append("\n");
+            }
+        }
+    }
+
+    void emit_defines(int next_line, int file_index) {
+        for (auto& [name, value] : defines_) {
+            out_.append(std::format("#define {} {}\n", name, value));
+        }
+        out_.append(std::format("#line {} {}\n", next_line, file_index));
+    }
+
+    const ShaderDefines& defines_;
+    std::vector<std::filesystem::path>* files_;
+    std::vector<std::filesystem::path> seen_;
+    std::string out_;
+};
+
 void check_compile_errors(GLuint shader, std::string_view type) {
     int success, len;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -47,31 +146,80 @@ void check_link_errors(GLuint program) {
 
 } // namespace
 
+std::string preprocess_shader(const std::filesystem::path& path,
+                              const ShaderDefines& defines,
+                              std::vector<std::filesystem::path>* files) {
+    return ShaderPreprocessor(defines, files).process(path);
+}
+
+namespace {
+
+GLuint compile_shader(GLenum type, cstring_view source) {
+    GLuint shader = glCreateShader(type);
+    const char* source_p = source.c_str();
+    glShaderSource(shader, 1, &source_p, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+void enable_parallel_compile() {
+#ifdef GL_KHR_parallel_shader_compile
+    static bool enabled = false;
+    if (!enabled && GLAD_GL_KHR_parallel_shader_compile) {
+        // 0xFFFFFFFF lets the driver pick the thread count
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    enabled = true;
+#endif
+}
+
+} // namespace
+
+ShaderBuild::ShaderBuild(cstring_view vs_source, cstring_view fs_source,
+                         std::optional<cstring_view> gs_source) {
+    enable_parallel_compile();
+    vshader_.reset(compile_shader(GL_VERTEX_SHADER, vs_source));
+    fshader_.reset(compile_shader(GL_FRAGMENT_SHADER, fs_source));
+    if (gs_source)
+        gshader_.reset(compile_shader(GL_GEOMETRY_SHADER, *gs_source));
+    prog_.reset(glCreateProgram());
+    glAttachShader(*prog_, *vshader_);
+    glAttachShader(*prog_, *fshader_);
+    if (gshader_)
+        glAttachShader(*prog_, *gshader_);
+    glLinkProgram(*prog_);
+}
+
+bool ShaderBuild::ready() const {
+#ifdef GL_KHR_parallel_shader_compile
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        GLint done;
+        glGetProgramiv(*prog_, GL_COMPLETION_STATUS_KHR, &done);
+        return done;
+    }
+#endif
+    return true;
+}
+
+GLuint ShaderBuild::finish() {
+    check_compile_errors(*vshader_, "vertex");
+    check_compile_errors(*fshader_, "fragment");
+    if (gshader_)
+        check_compile_errors(*gshader_, "geometry");
+    check_link_errors(*prog_);
+    return prog_.release();
+}
+
 GLuint build_shader(cstring_view vs_source, cstring_view fs_source,
                     std::optional<cstring_view> gs_source) {
-    ShaderHandle vshader{glCreateShader(GL_VERTEX_SHADER)};
-    const char* vs_source_p = vs_source.c_str();
-    glShaderSource(*vshader, 1, &vs_source_p, nullptr);
-    glCompileShader(*vshader);
-    check_compile_errors(*vshader, "vertex");
-    ShaderHandle fshader{glCreateShader(GL_FRAGMENT_SHADER)};
-    const char* fs_source_p = fs_source.c_str();
-    glShaderSource(*fshader, 1, &fs_source_p, nullptr);
-    glCompileShader(*fshader);
-    check_compile_errors(*fshader, "fragment");
-    ShaderHandle gshader;
-    if (gs_source) {
-        gshader.reset(glCreateShader(GL_GEOMETRY_SHADER));
-        const char* gs_source_p = gs_source->c_str();
-        glShaderSource(*gshader, 1, &gs_source_p, nullptr);
-        glCompileShader(*gshader);
-        check_compile_errors(*gshader, "geometry");
-    }
+    return ShaderBuild(vs_source, fs_source, gs_source).finish();
+}
+
+GLuint build_compute_shader(cstring_view source) {
+    ShaderHandle cshader{compile_shader(GL_COMPUTE_SHADER, source)};
+    check_compile_errors(*cshader, "compute");
     ProgramHandle prog{glCreateProgram()};
-    glAttachShader(*prog, *vshader);
-    glAttachShader(*prog, *fshader);
-    if (gshader)
-        glAttachShader(*prog, *gshader);
+    glAttachShader(*prog, *cshader);
     glLinkProgram(*prog);
     check_link_errors(*prog);
     return prog.release();
@@ -79,10 +227,19 @@ GLuint build_shader(cstring_view vs_source, cstring_view fs_source,
 
 GLuint load_shader(const std::filesystem::path& vs_path,
                    const std::filesystem::path& fs_path,
-                   const std::filesystem::path& gs_path) {
-    return build_shader(read_file(vs_path), read_file(fs_path),
-                        !gs_path.empty() ? read_file(gs_path)
-                                         : std::optional<cstring_view>{});
+                   const std::filesystem::path& gs_path,
+                   const ShaderDefines& defines) {
+    std::string gs_source;
+    if (!gs_path.empty())
+        gs_source = preprocess_shader(gs_path, defines);
+    return build_shader(preprocess_shader(vs_path, defines),
+                        preprocess_shader(fs_path, defines),
+                        !gs_path.empty() ? gs_source : std::optional<cstring_view>{});
+}
+
+GLuint load_compute_shader(const std::filesystem::path& path,
+                           const ShaderDefines& defines) {
+    return build_compute_shader(preprocess_shader(path, defines));
 }
 
 void Shader::fetch_uniform_locations() {
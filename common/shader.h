@@ -4,25 +4,66 @@
 #include <filesystem>
 #include <format>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "cstring_view.h"
+#include "errutils.h"
 #include "raii.h"
 #include "utils.h"
 
 using ShaderHandle = Handle<GLuint, functor<glDeleteShader>>;
 using ProgramHandle = Handle<GLuint, functor<glDeleteProgram>>;
 
+// Preprocessor definitions as (name, value) pairs, e.g. {"MAX_LIGHTS", "4"}
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Reads a shader source file, recursively resolving #include "file" directives
+// relative to the including file (each file is included at most once) and injecting
+// defines right after the #version directive. If files is non-null, the paths of the
+// source file and all of its includes are appended to it.
+std::string preprocess_shader(const std::filesystem::path& path,
+                              const ShaderDefines& defines = {},
+                              std::vector<std::filesystem::path>* files = nullptr);
+
 GLuint build_shader(cstring_view vs_source, cstring_view fs_source,
                     std::optional<cstring_view> gs_source = {});
 
+GLuint build_compute_shader(cstring_view source);
+
+GLuint load_compute_shader(const std::filesystem::path& path,
+                           const ShaderDefines& defines = {});
+
+// A shader program build that can be polled for completion. Compile and link are
+// issued up front without querying their status, so with
+// GL_KHR_parallel_shader_compile the driver builds in the background while frames
+// keep rendering. Without the extension ready() is always true and finish() blocks.
+class ShaderBuild {
+  public:
+    ShaderBuild(cstring_view vs_source, cstring_view fs_source,
+                std::optional<cstring_view> gs_source = {});
+
+    // True once finish() can return without stalling
+    bool ready() const;
+    // Checks compile and link status, throwing on errors, and returns the program
+    GLuint finish();
+
+  private:
+    ShaderHandle vshader_, fshader_, gshader_;
+    ProgramHandle prog_;
+};
+
 GLuint load_shader(const std::filesystem::path& vs_path,
                    const std::filesystem::path& fs_path,
-                   const std::filesystem::path& gs_path = {});
+                   const std::filesystem::path& gs_path = {},
+                   const ShaderDefines& defines = {});
 
 class Shader {
   public:
@@ -33,12 +74,25 @@ class Shader {
 
     static Shader load(const std::filesystem::path& vs_path,
                        const std::filesystem::path& fs_path,
-                       const std::filesystem::path& gs_path = {}) {
-        return Shader(load_shader(vs_path, fs_path, gs_path));
+                       const std::filesystem::path& gs_path = {},
+                       const ShaderDefines& defines = {}) {
+        return Shader(load_shader(vs_path, fs_path, gs_path, defines));
+    }
+
+    static Shader load_compute(const std::filesystem::path& path,
+                               const ShaderDefines& defines = {}) {
+        return Shader(load_compute_shader(path, defines));
     }
 
     GLuint id() const { return id_.get(); }
 
+    // Replaces the program, e.g. after a hot reload, and rebuilds the uniform cache
+    void reset(GLuint id) {
+        id_.reset(id);
+        uniform_locations_.clear();
+        fetch_uniform_locations();
+    }
+
     void use() const { glUseProgram(id()); }
 
     GLint uniform_location(cstring_view name) const {
@@ -58,6 +112,12 @@ class Shader {
     void set_float(cstring_view name, float value) const {
         glUniform1f(uniform_location(name), value);
     }
+    void set_uvec2(cstring_view name, const glm::uvec2& value) const {
+        glUniform2uiv(uniform_location(name), 1, glm::value_ptr(value));
+    }
+    void set_uvec3(cstring_view name, const glm::uvec3& value) const {
+        glUniform3uiv(uniform_location(name), 1, glm::value_ptr(value));
+    }
     void set_vec2(cstring_view name, const glm::vec2& value) const {
         glUniform2fv(uniform_location(name), 1, glm::value_ptr(value));
     }
@@ -93,6 +153,45 @@ class Shader {
     std::unordered_map<std::string, GLint> uniform_locations_;
 };
 
+// Builds uniform names like "dirLights[2].direction" in a fixed-size buffer, so
+// per-frame uniform updates don't allocate. Each call returns a view into the buffer
+// that is valid until the next call.
+class UniformName {
+  public:
+    static constexpr size_t MAX_LENGTH = 127;
+
+    explicit UniformName(std::string_view prefix) {
+        err::check(prefix.size() <= MAX_LENGTH, "uniform name too long: {}", prefix);
+        prefix.copy(buffer_, prefix.size());
+        prefix_length_ = prefix.size();
+        buffer_[prefix_length_] = '\0';
+    }
+    // Prefix built from a format string, e.g. UniformName("{}[{}]", array, i)
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    UniformName(std::format_string<Args...> fmt, Args&&... args) {
+        auto result = std::format_to_n(buffer_, MAX_LENGTH, fmt, std::forward<Args>(args)...);
+        err::check(size_t(result.size) <= MAX_LENGTH, "uniform name too long");
+        prefix_length_ = size_t(result.size);
+        buffer_[prefix_length_] = '\0';
+    }
+
+    // The prefix followed by suffix, e.g. name(".direction")
+    cstring_view operator()(std::string_view suffix) {
+        err::check(prefix_length_ + suffix.size() <= MAX_LENGTH, "uniform name too long: {}",
+                   suffix);
+        suffix.copy(buffer_ + prefix_length_, suffix.size());
+        buffer_[prefix_length_ + suffix.size()] = '\0';
+        return buffer_;
+    }
+    // The prefix alone
+    std::string_view prefix() const { return {buffer_, prefix_length_}; }
+
+  private:
+    char buffer_[MAX_LENGTH + 1];
+    size_t prefix_length_;
+};
+
 // Apply multiple apply-able objects to a Shader array and count variable
 template <typename Container>
 void apply_array(const Shader& shader, std::string_view array_name,
@@ -106,7 +205,8 @@ template <typename Container>
 void apply_array(const Shader& shader, std::string_view array_name,
                  const Container& objs) {
     for (size_t i = 0; i < std::size(objs); i++) {
-        objs[i].apply(shader, std::format("{}[{}]", array_name, i));
+        UniformName name("{}[{}]", array_name, i);
+        objs[i].apply(shader, name.prefix());
     }
 }
 
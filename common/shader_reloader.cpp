@@ -0,0 +1,104 @@
+#include "shader_reloader.h"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Preprocesses a shader stage, appending its canonical source files to files
+std::string preprocess_stage(const fs::path& path, const ShaderDefines& defines,
+                             std::vector<fs::path>& files) {
+    std::vector<fs::path> stage_files;
+    std::string source = preprocess_shader(path, defines, &stage_files);
+    for (auto& file : stage_files) {
+        files.push_back(fs::weakly_canonical(file));
+    }
+    return source;
+}
+
+} // namespace
+
+void ShaderReloader::add(Shader& shader, const fs::path& vs_path, const fs::path& fs_path,
+                         const fs::path& gs_path, ShaderDefines defines) {
+    auto entry = std::make_unique<Entry>(Entry{
+        .shader = &shader,
+        .vs_path = vs_path,
+        .fs_path = fs_path,
+        .gs_path = gs_path,
+        .defines = std::move(defines),
+    });
+    // The shader is already built, so only gather its dependencies to watch
+    for (auto& path : {vs_path, fs_path, gs_path}) {
+        if (path.empty())
+            continue;
+        std::vector<fs::path> files;
+        preprocess_shader(path, entry->defines, &files);
+        for (auto& file : files) {
+            entry->files.push_back(fs::weakly_canonical(file));
+            watcher_.add(file);
+        }
+    }
+    entries_.push_back(std::move(entry));
+}
+
+void ShaderReloader::remove(const Shader& shader) {
+    std::erase_if(entries_, [&](auto& entry) { return entry->shader == &shader; });
+}
+
+void ShaderReloader::update() {
+    std::vector<fs::path> changed = watcher_.poll();
+    for (auto& entry : entries_) {
+        bool dirty = std::ranges::any_of(entry->files, [&](auto& file) {
+            return std::ranges::find(changed, file) != changed.end();
+        });
+        if (dirty) {
+            entry->changed_at = Clock::now();
+            start_build(*entry);
+        }
+        if (entry->build && entry->build->ready())
+            finish_build(*entry);
+    }
+}
+
+void ShaderReloader::start_build(Entry& entry) {
+    // A newer change supersedes any build still in flight
+    entry.build.reset();
+    try {
+        std::vector<fs::path> files;
+        std::string vs_source = preprocess_stage(entry.vs_path, entry.defines, files);
+        std::string fs_source = preprocess_stage(entry.fs_path, entry.defines, files);
+        std::string gs_source;
+        if (!entry.gs_path.empty())
+            gs_source = preprocess_stage(entry.gs_path, entry.defines, files);
+        // Includes may have been added or removed by the edit
+        for (auto& file : files) {
+            watcher_.add(file);
+        }
+        entry.files = std::move(files);
+        entry.build.emplace(vs_source, fs_source,
+                            !entry.gs_path.empty() ? gs_source
+                                                   : std::optional<cstring_view>{});
+    } catch (const std::exception& e) {
+        std::cerr << std::format("shader reload failed: {}: {}\n", entry.fs_path.string(),
+                                 e.what());
+    }
+}
+
+void ShaderReloader::finish_build(Entry& entry) {
+    try {
+        entry.shader->reset(entry.build->finish());
+        last_latency_ = Clock::now() - entry.changed_at;
+        std::cerr << std::format("reloaded shader {} in {:.1f} ms\n", entry.fs_path.string(),
+                                 last_latency_.count());
+    } catch (const std::exception& e) {
+        std::cerr << std::format("shader reload failed, keeping old program: {}: {}\n",
+                                 entry.fs_path.string(), e.what());
+    }
+    entry.build.reset();
+}
@@ -0,0 +1,56 @@
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "file_watcher.h"
+#include "shader.h"
+
+// Rebuilds shaders when their source files or includes change on disk. Builds are
+// polled once per frame rather than waited on (see ShaderBuild), and the live Shader
+// is only swapped after a successful link. Failed builds are reported and leave the
+// old program in place.
+class ShaderReloader {
+  public:
+    // Registers a shader built from the given files. The shader must outlive its
+    // registration (see remove()).
+    void add(Shader& shader, const std::filesystem::path& vs_path,
+             const std::filesystem::path& fs_path,
+             const std::filesystem::path& gs_path = {}, ShaderDefines defines = {});
+    void remove(const Shader& shader);
+
+    // Starts builds for changed shaders and swaps in finished ones. Call once per
+    // frame on the GL thread.
+    void update();
+
+    // Time from file change to swap for the last successful reload
+    std::chrono::duration<double, std::milli> last_latency() const {
+        return last_latency_;
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        Shader* shader;
+        std::filesystem::path vs_path, fs_path, gs_path;
+        ShaderDefines defines;
+        // Canonical paths of the sources and their includes
+        std::vector<std::filesystem::path> files{};
+        std::optional<ShaderBuild> build{};
+        Clock::time_point changed_at{};
+    };
+
+    void start_build(Entry& entry);
+    void finish_build(Entry& entry);
+
+    FileWatcher watcher_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::chrono::duration<double, std::milli> last_latency_{};
+};
+
+#endif // SHADER_RELOADER_H
@@ -0,0 +1,45 @@
+#include "shader_variants.h"
+
+#include <utility>
+
+#include "material.h"
+
+ShaderVariants::ShaderVariants(const std::filesystem::path& vs_path,
+                               const std::filesystem::path& fs_path,
+                               ShaderDefines base_defines, KeyDefinesFn key_defines)
+    : vs_path_(vs_path), fs_path_(fs_path), base_defines_(std::move(base_defines)),
+      key_defines_(key_defines ? std::move(key_defines) : material_feature_defines) {}
+
+void ShaderVariants::enable_reload(ShaderReloader& reloader) {
+    reloader_ = &reloader;
+    for (auto& [key, shader] : variants_) {
+        reloader.add(shader, vs_path_, fs_path_, {}, defines(key));
+    }
+}
+
+const Shader& ShaderVariants::get(unsigned int key) {
+    if (auto* shader = util::get_or_null(variants_, key))
+        return *shader;
+    ShaderDefines key_defines = defines(key);
+    auto [it, _] =
+        variants_.try_emplace(key, load_shader(vs_path_, fs_path_, {}, key_defines));
+    if (reloader_)
+        reloader_->add(it->second, vs_path_, fs_path_, {}, std::move(key_defines));
+    return it->second;
+}
+
+void ShaderVariants::clear() {
+    if (reloader_) {
+        for (auto& [key, shader] : variants_) {
+            reloader_->remove(shader);
+        }
+    }
+    variants_.clear();
+}
+
+ShaderDefines ShaderVariants::defines(unsigned int key) const {
+    ShaderDefines defines = base_defines_;
+    ShaderDefines key_defines = key_defines_(key);
+    defines.insert(defines.end(), key_defines.begin(), key_defines.end());
+    return defines;
+}
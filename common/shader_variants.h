@@ -0,0 +1,43 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+
+#include "shader.h"
+#include "shader_reloader.h"
+
+// Lazily compiled cache of shader permutations keyed by a feature bitmask. Each
+// permutation is built from the same source files with base_defines plus the defines
+// returned by key_defines(key).
+class ShaderVariants {
+  public:
+    using KeyDefinesFn = std::function<ShaderDefines(unsigned int key)>;
+
+    ShaderVariants(const std::filesystem::path& vs_path,
+                   const std::filesystem::path& fs_path,
+                   ShaderDefines base_defines = {}, KeyDefinesFn key_defines = nullptr);
+    ~ShaderVariants() { clear(); }
+
+    // Registers all current and future permutations with reloader for hot reloading
+    void enable_reload(ShaderReloader& reloader);
+
+    // Returns the permutation for key, compiling it on first use
+    const Shader& get(unsigned int key);
+    const Shader& operator[](unsigned int key) { return get(key); }
+
+    size_t size() const { return variants_.size(); }
+    void clear();
+
+  private:
+    ShaderDefines defines(unsigned int key) const;
+
+    std::filesystem::path vs_path_, fs_path_;
+    ShaderDefines base_defines_;
+    KeyDefinesFn key_defines_;
+    std::unordered_map<unsigned int, Shader> variants_;
+    ShaderReloader* reloader_ = nullptr;
+};
+
+#endif // SHADER_VARIANTS_H
@@ -0,0 +1,118 @@
+#include "shadow_cascades.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "errutils.h"
+
+namespace {
+
+// Bounds tested per pool task
+constexpr size_t CULL_CHUNK = 256;
+
+// Sphere radii are rounded up to this fraction of a world unit, so rounding error in
+// the fit can't change the cascade size from frame to frame
+constexpr float RADIUS_STEP = 1.f / 16.f;
+
+} // namespace
+
+std::vector<float> cascade_splits(float near, float far, uint32_t count, float lambda) {
+    std::vector<float> splits(count + 1);
+    for (uint32_t i = 0; i <= count; i++) {
+        float t = float(i) / float(count);
+        float uniform = near + (far - near) * t;
+        float log = near * std::pow(far / near, t);
+        splits[i] = glm::mix(uniform, log, lambda);
+    }
+    // Exact ends, whatever pow rounded to
+    splits.front() = near;
+    splits.back() = far;
+    return splits;
+}
+
+std::vector<ShadowCascade> fit_cascades(const DirShadow& shadow, glm::vec3 direction,
+                                        const glm::mat4& view, const glm::mat4& projection,
+                                        const Bounds& scene_bounds) {
+    err::check(shadow.cascades >= 1 && shadow.cascades <= DirShadow::MAX_CASCADES,
+               "shadows need 1 to {} cascades, got {}", DirShadow::MAX_CASCADES,
+               shadow.cascades);
+
+    // Frustum corner rays in view space, from the near plane to the far plane
+    glm::mat4 inverse_projection = glm::inverse(projection);
+    std::array<glm::vec3, 4> near_corners, far_corners;
+    for (int i = 0; i < 4; i++) {
+        glm::vec2 ndc{i & 1 ? 1 : -1, i & 2 ? 1 : -1};
+        glm::vec4 n = inverse_projection * glm::vec4(ndc, -1, 1);
+        glm::vec4 f = inverse_projection * glm::vec4(ndc, 1, 1);
+        near_corners[i] = glm::vec3(n) / n.w;
+        far_corners[i] = glm::vec3(f) / f.w;
+    }
+    float near = -near_corners[0].z, far = -far_corners[0].z;
+    auto splits = cascade_splits(near, std::min(far, std::max(shadow.max_distance, near)),
+                                 shadow.cascades, shadow.split_lambda);
+
+    // The light's rotation is fixed, so snapping in its space is stable
+    direction = glm::normalize(direction);
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    glm::mat4 light_view = glm::lookAt(glm::vec3(0), direction, up);
+    glm::mat4 inverse_view = glm::inverse(view);
+    Bounds light_scene = scene_bounds.empty() ? Bounds{} : scene_bounds.transform(light_view);
+
+    std::vector<ShadowCascade> cascades(shadow.cascades);
+    for (uint32_t c = 0; c < shadow.cascades; c++) {
+        // Slice corners in view space; depth changes linearly along each corner ray
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center{0};
+        for (int i = 0; i < 8; i++) {
+            float depth = splits[c + (i >> 2)];
+            float t = (depth - near) / (far - near);
+            corners[i] = glm::mix(near_corners[i & 3], far_corners[i & 3], t);
+            center += corners[i] / 8.f;
+        }
+        float radius = 0;
+        for (glm::vec3 corner : corners)
+            radius = std::max(radius, glm::distance(corner, center));
+        radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+        float texel_size = 2 * radius / float(shadow.resolution);
+        glm::vec3 light_center = light_view * inverse_view * glm::vec4(center, 1);
+        glm::vec2 snapped = glm::floor(glm::vec2(light_center) / texel_size) * texel_size;
+        float z_min = light_center.z - radius, z_max = light_center.z + radius;
+        if (!light_scene.empty()) {
+            z_min = std::min(z_min, light_scene.min.z);
+            z_max = std::max(z_max, light_scene.max.z);
+        }
+        // The light looks down -z
+        glm::mat4 ortho = glm::ortho(snapped.x - radius, snapped.x + radius,
+                                     snapped.y - radius, snapped.y + radius, -z_max, -z_min);
+        cascades[c] = {ortho * light_view, splits[c], splits[c + 1], texel_size};
+    }
+    return cascades;
+}
+
+std::vector<std::vector<uint32_t>> cull_cascades(std::span<const Bounds> bounds,
+                                                 std::span<const ShadowCascade> cascades,
+                                                 ThreadPool& pool) {
+    size_t num_chunks = (bounds.size() + CULL_CHUNK - 1) / CULL_CHUNK;
+    // One part per cascade and chunk, concatenated in order afterwards
+    std::vector<std::vector<uint32_t>> parts(cascades.size() * num_chunks);
+    pool.parallel_for(parts.size(), [&](size_t p) {
+        const glm::mat4& view_projection = cascades[p / num_chunks].view_projection;
+        size_t begin = p % num_chunks * CULL_CHUNK;
+        size_t end = std::min(begin + CULL_CHUNK, bounds.size());
+        for (size_t i = begin; i < end; i++) {
+            if (!bounds[i].empty() && bounds[i].intersects_frustum(view_projection))
+                parts[p].push_back(uint32_t(i));
+        }
+    });
+
+    std::vector<std::vector<uint32_t>> visible(cascades.size());
+    for (size_t c = 0; c < cascades.size(); c++) {
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            visible[c].append_range(parts[c * num_chunks + chunk]);
+    }
+    return visible;
+}
@@ -0,0 +1,44 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "lights.h"
+#include "thread_pool.h"
+
+// One cascade of a directional light's shadow map
+struct ShadowCascade {
+    // World to light clip space
+    glm::mat4 view_projection;
+    // View depth range of the camera covered by the cascade
+    float split_near, split_far;
+    // World size of one shadow map texel
+    float texel_size;
+};
+
+// Distances splitting [near, far] into count ranges, count + 1 values from near to far.
+// lambda blends uniform (0) and logarithmic (1) distribution.
+std::vector<float> cascade_splits(float near, float far, uint32_t count, float lambda);
+
+// Fits shadow.cascades cascades of a light shining along direction to the view frustum
+// of a perspective camera, up to shadow.max_distance. Each cascade is a bounding
+// sphere of its slice of the frustum, so its size doesn't change as the camera
+// rotates, with the center snapped to whole texels so static shadows don't shimmer
+// as it moves. The light depth range is extended to scene_bounds to take in casters
+// outside the frustum.
+std::vector<ShadowCascade> fit_cascades(const DirShadow& shadow, glm::vec3 direction,
+                                        const glm::mat4& view, const glm::mat4& projection,
+                                        const Bounds& scene_bounds);
+
+// Indices of the world space bounds intersecting each cascade, in increasing order.
+// Cascades and runs of bounds are tested in parallel on the pool.
+std::vector<std::vector<uint32_t>> cull_cascades(std::span<const Bounds> bounds,
+                                                 std::span<const ShadowCascade> cascades,
+                                                 ThreadPool& pool);
+
+#endif // SHADOW_CASCADES_H
@@ -0,0 +1,131 @@
+#include "shadow_map.h"
+
+#include <algorithm>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "errutils.h"
+#include "glutils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Caster bounds transformed per pool task
+constexpr size_t BOUNDS_CHUNK = 256;
+
+} // namespace
+
+CascadedShadowMap::CascadedShadowMap(const fs::path& shader_dir, ThreadPool& pool)
+    : pool_(pool),
+      depth_shader_(Shader::load(shader_dir / "depth.vs", shader_dir / "depth.fs")) {
+    glCreateFramebuffers(1, &fbo_.reset_as_ref());
+    glNamedFramebufferDrawBuffer(*fbo_, GL_NONE);
+    glNamedFramebufferReadBuffer(*fbo_, GL_NONE);
+}
+
+ShaderDefines CascadedShadowMap::defines(size_t light_index) {
+    return {{"SHADOWED_DIR_LIGHT", std::to_string(light_index)},
+            {"MAX_CASCADES", std::to_string(DirShadow::MAX_CASCADES)}};
+}
+
+void CascadedShadowMap::resize(uint32_t resolution, uint32_t layers) {
+    if (resolution == resolution_ && layers == layers_)
+        return;
+    resolution_ = resolution;
+    layers_ = layers;
+    // Depth comparisons with linear filtering give 2x2 PCF for every tap
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &depth_.reset_as_ref());
+    glTextureStorage3D(*depth_, 1, GL_DEPTH_COMPONENT32F, GLsizei(resolution),
+                       GLsizei(resolution), GLsizei(layers));
+    glTextureParameteri(*depth_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(*depth_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*depth_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*depth_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*depth_, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(*depth_, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glNamedFramebufferTextureLayer(*fbo_, GL_DEPTH_ATTACHMENT, *depth_, 0, 0);
+    check_framebuffer(*fbo_);
+}
+
+void CascadedShadowMap::render(const DirLight& light, std::span<const SceneObject> objects,
+                               const glm::mat4& view, const glm::mat4& projection) {
+    settings_ = light.shadow;
+    stats_ = {};
+    cascades_.clear();
+    if (!settings_.enabled)
+        return;
+    err::check(settings_.resolution > 0, "shadow map resolution must be positive");
+    resize(settings_.resolution, settings_.cascades);
+
+    casters_.clear();
+    for (const SceneObject& object : objects) {
+        for (auto& mesh : object.model->meshes())
+            casters_.push_back({mesh.get(), object.transform});
+    }
+    bounds_.resize(casters_.size());
+    pool_.parallel_for(casters_.size(), [&](size_t i) {
+        bounds_[i] = casters_[i].mesh->bounds().transform(casters_[i].transform);
+    }, BOUNDS_CHUNK);
+    Bounds scene_bounds;
+    for (const Bounds& bounds : bounds_)
+        scene_bounds.expand(bounds);
+
+    cascades_ = fit_cascades(settings_, light.direction, view, projection, scene_bounds);
+    auto visible = cull_cascades(bounds_, cascades_, pool_);
+    stats_.casters = casters_.size();
+
+    // Restored afterwards, so the caller may be rendering into its own target
+    auto viewport = util::gl_get<GLint, 4>(GL_VIEWPORT);
+    auto draw_fbo = util::gl_get<GLint>(GL_DRAW_FRAMEBUFFER_BINDING);
+    auto read_fbo = util::gl_get<GLint>(GL_READ_FRAMEBUFFER_BINDING);
+    glBindFramebuffer(GL_FRAMEBUFFER, *fbo_);
+    glViewport(0, 0, GLsizei(resolution_), GLsizei(resolution_));
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(settings_.slope_bias, 1.f);
+    depth_shader_.use();
+    depth_shader_.set_mat4("view", glm::mat4(1));
+
+    // Near cascades cover the fewest casters and the most of the screen, so they are
+    // the last to run out of draws
+    size_t budget = settings_.max_draws;
+    for (size_t c = 0; c < cascades_.size(); c++) {
+        glNamedFramebufferTextureLayer(*fbo_, GL_DEPTH_ATTACHMENT, *depth_, 0, GLint(c));
+        glClear(GL_DEPTH_BUFFER_BIT);
+        depth_shader_.set_mat4("projection", cascades_[c].view_projection);
+        size_t draws = std::min(visible[c].size(), budget);
+        for (size_t i = 0; i < draws; i++) {
+            const Caster& caster = casters_[visible[c][i]];
+            depth_shader_.set_mat4("model", caster.transform);
+            caster.mesh->draw_depth();
+        }
+        budget -= draws;
+        stats_.cascade_draws[c] = draws;
+        stats_.drawn += draws;
+        stats_.culled += casters_.size() - visible[c].size();
+        stats_.skipped += visible[c].size() - draws;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(draw_fbo));
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(read_fbo));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadowMap::apply(const Shader& shader, GLuint unit) const {
+    // Clip space to texture coordinates and depth
+    glm::mat4 bias = glm::scale(glm::translate(glm::mat4(1), glm::vec3(0.5f)),
+                                glm::vec3(0.5f));
+    glBindTextureUnit(unit, *depth_);
+    shader.set_int("shadowMap", int(unit));
+    shader.set_int("numShadowCascades", int(cascades_.size()));
+    for (size_t c = 0; c < cascades_.size(); c++) {
+        UniformName uniform("shadowCascades[{}]", c);
+        shader.set_mat4(uniform(".matrix"), bias * cascades_[c].view_projection);
+        shader.set_float(uniform(".texelSize"), cascades_[c].texel_size);
+    }
+    shader.set_float("shadowNormalBias", settings_.normal_bias);
+    shader.set_float("shadowDepthBias", settings_.depth_bias);
+    shader.set_int("shadowPcfRadius", settings_.pcf_radius);
+}
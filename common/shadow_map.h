@@ -0,0 +1,80 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "framebuffer.h"
+#include "lights.h"
+#include "mesh.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "shadow_cascades.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// Cascaded shadow maps for one directional light, configured by its DirShadow. Each
+// cascade is a layer of a depth texture array, rendered with the position-only depth
+// shader from the meshes whose bounds intersect it. Shaders built with defines() sample
+// it through shadow.glsl with PCF.
+class CascadedShadowMap {
+  public:
+    struct Stats {
+        // Meshes of the rendered objects
+        size_t casters = 0;
+        // Draws issued per cascade, and summed over cascades
+        std::array<size_t, DirShadow::MAX_CASCADES> cascade_draws{};
+        size_t drawn = 0;
+        // Caster-cascade pairs rejected by culling, and accepted but over max_draws
+        size_t culled = 0;
+        size_t skipped = 0;
+    };
+
+    // shader_dir must contain depth.vs and depth.fs
+    CascadedShadowMap(const std::filesystem::path& shader_dir, ThreadPool& pool);
+
+    // Defines for shaders shadowing dirLights[light_index] with shadow.glsl
+    static ShaderDefines defines(size_t light_index = 0);
+
+    // Fits the cascades of light to the camera and renders the meshes of objects into
+    // them. Does nothing but clear the cascades when the light casts no shadows.
+    // Leaves the framebuffer bindings and the viewport as it found them.
+    void render(const DirLight& light, std::span<const SceneObject> objects,
+                const glm::mat4& view, const glm::mat4& projection);
+
+    // Binds the map to unit and sets the uniforms read by shadow.glsl. Without cascades
+    // fragments are lit.
+    void apply(const Shader& shader, GLuint unit) const;
+
+    std::span<const ShadowCascade> cascades() const { return cascades_; }
+    const Stats& stats() const { return stats_; }
+
+  private:
+    struct Caster {
+        const Mesh* mesh;
+        glm::mat4 transform;
+    };
+
+    void resize(uint32_t resolution, uint32_t layers);
+
+    ThreadPool& pool_;
+    Shader depth_shader_;
+    FramebufferHandle fbo_;
+    TextureHandle depth_;
+    uint32_t resolution_ = 0, layers_ = 0;
+
+    DirShadow settings_;
+    std::vector<ShadowCascade> cascades_;
+    // Scratch, kept to reuse their storage
+    std::vector<Caster> casters_;
+    std::vector<Bounds> bounds_;
+    Stats stats_;
+};
+
+#endif // SHADOW_MAP_H
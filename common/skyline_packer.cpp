@@ -0,0 +1,91 @@
+#include "skyline_packer.h"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+#include "errutils.h"
+
+std::optional<int> SkylinePacker::fit(size_t i, int width, int height) const {
+    int x = skyline_[i].x;
+    if (x + width > width_)
+        return std::nullopt;
+    // The segments always cover the full width, so this stays in range
+    int y = 0;
+    for (int remaining = width; remaining > 0; i++) {
+        y = std::max(y, skyline_[i].y);
+        remaining -= skyline_[i].width;
+    }
+    if (y + height > height_)
+        return std::nullopt;
+    return y;
+}
+
+std::optional<glm::ivec2> SkylinePacker::insert(int width, int height) {
+    size_t best = skyline_.size();
+    int best_top = INT_MAX, best_y = 0;
+    for (size_t i = 0; i < skyline_.size(); i++) {
+        auto y = fit(i, width, height);
+        if (y && *y + height < best_top) {
+            best = i;
+            best_top = *y + height;
+            best_y = *y;
+        }
+    }
+    if (best == skyline_.size())
+        return std::nullopt;
+
+    Segment placed{skyline_[best].x, best_top, width};
+    skyline_.insert(skyline_.begin() + best, placed);
+    // Cut the segments now covered by the new one
+    int end = placed.x + placed.width;
+    for (size_t i = best + 1; i < skyline_.size() && skyline_[i].x < end;) {
+        Segment& s = skyline_[i];
+        int covered = end - s.x;
+        if (s.width <= covered) {
+            skyline_.erase(skyline_.begin() + i);
+            continue;
+        }
+        s.x += covered;
+        s.width -= covered;
+        break;
+    }
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline_.size();) {
+        if (skyline_[i].y == skyline_[i + 1].y) {
+            skyline_[i].width += skyline_[i + 1].width;
+            skyline_.erase(skyline_.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+    return glm::ivec2(placed.x, best_y);
+}
+
+std::vector<PackedRect> pack_rects(std::span<const glm::ivec2> sizes, int width, int height) {
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&](size_t a, size_t b) {
+        if (sizes[a].y != sizes[b].y)
+            return sizes[a].y > sizes[b].y;
+        return sizes[a].x > sizes[b].x;
+    });
+
+    std::vector<PackedRect> rects(sizes.size());
+    std::vector<SkylinePacker> pages;
+    for (size_t i : order) {
+        glm::ivec2 size = sizes[i];
+        err::check(size.x <= width && size.y <= height,
+                   "{}x{} rectangle doesn't fit a {}x{} page", size.x, size.y, width, height);
+        std::optional<glm::ivec2> position;
+        size_t page = 0;
+        for (; page < pages.size() && !position; page++)
+            position = pages[page].insert(size.x, size.y);
+        if (!position) {
+            position = pages.emplace_back(width, height).insert(size.x, size.y);
+            page = pages.size();
+        }
+        rects[i] = {int(page - 1), *position};
+    }
+    return rects;
+}
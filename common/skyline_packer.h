@@ -0,0 +1,42 @@
+#ifndef SKYLINE_PACKER_H
+#define SKYLINE_PACKER_H
+
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Packs rectangles into a fixed-size area by tracking its skyline, the top edge of the
+// placed rectangles, and putting each new one where its top ends up lowest (leftmost
+// on ties). Pure integer logic, so placements only depend on the insertion order.
+class SkylinePacker {
+  public:
+    SkylinePacker(int width, int height)
+        : width_(width), height_(height), skyline_{{0, 0, width}} {}
+
+    // Bottom-left corner for a width x height rectangle, or nullopt if it doesn't fit
+    std::optional<glm::ivec2> insert(int width, int height);
+
+  private:
+    struct Segment {
+        int x, y, width;
+    };
+
+    // Lowest y a rectangle starting at segment i can sit at
+    std::optional<int> fit(size_t i, int width, int height) const;
+
+    int width_, height_;
+    std::vector<Segment> skyline_;
+};
+
+struct PackedRect {
+    int page;
+    glm::ivec2 position;
+};
+
+// Packs sizes into as few width x height pages as needed. Rectangles are placed
+// tallest first, then widest, then in input order, so the result is deterministic.
+std::vector<PackedRect> pack_rects(std::span<const glm::ivec2> sizes, int width, int height);
+
+#endif // SKYLINE_PACKER_H
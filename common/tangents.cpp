@@ -0,0 +1,111 @@
+#include "tangents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "errutils.h"
+
+namespace {
+
+// Triangles or vertices per pool task
+constexpr size_t CHUNK_SIZE = 4096;
+
+// UV-space tangent and bitangent directions of one triangle, unit length or zero for
+// triangles with degenerate texture coordinates
+struct TriangleFrame {
+    glm::vec3 tangent, bitangent;
+};
+
+// v without its component along unit n, normalized; zero if nothing is left
+glm::vec3 project_to_plane(const glm::vec3& v, const glm::vec3& n) {
+    glm::vec3 projected = v - n * glm::dot(n, v);
+    float length = glm::length(projected);
+    return length > 1e-12f ? projected / length : glm::vec3(0);
+}
+
+// Any unit vector perpendicular to n
+glm::vec3 perpendicular(const glm::vec3& n) {
+    glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    return project_to_plane(axis, n);
+}
+
+float corner_angle(const glm::vec3& corner, const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 u = a - corner, v = b - corner;
+    float lengths = glm::length(u) * glm::length(v);
+    if (lengths == 0)
+        return 0;
+    return std::acos(std::clamp(glm::dot(u, v) / lengths, -1.f, 1.f));
+}
+
+} // namespace
+
+glm::vec4 unpack_tangent(uint32_t packed) {
+    auto unquantize = [](uint32_t v) { return float(v & 0x7fff) / 32767.f * 2.f - 1.f; };
+    glm::vec3 t(unquantize(packed), unquantize(packed >> 15), 0);
+    t.z = 1.f - std::abs(t.x) - std::abs(t.y);
+    float wrap = std::max(-t.z, 0.f);
+    t.x += t.x >= 0 ? -wrap : wrap;
+    t.y += t.y >= 0 ? -wrap : wrap;
+    return {glm::normalize(t), packed >> 31 ? -1.f : 1.f};
+}
+
+void generate_tangents(std::span<Vertex> vertices, std::span<const unsigned int> indices,
+                       ThreadPool* pool) {
+    err::check(indices.size() % 3 == 0, "{} indices don't make whole triangles",
+               indices.size());
+    size_t num_triangles = indices.size() / 3;
+    for (unsigned int index : indices)
+        err::check(index < vertices.size(), "index {} is past the {} vertices", index,
+                   vertices.size());
+
+    std::vector<TriangleFrame> frames(num_triangles);
+    parallel_for(pool, num_triangles, [&](size_t tri) {
+        const Vertex& v0 = vertices[indices[tri * 3]];
+        const Vertex& v1 = vertices[indices[tri * 3 + 1]];
+        const Vertex& v2 = vertices[indices[tri * 3 + 2]];
+        glm::vec3 e1 = v1.position - v0.position, e2 = v2.position - v0.position;
+        glm::vec2 d1 = v1.tex_coords - v0.tex_coords, d2 = v2.tex_coords - v0.tex_coords;
+        float det = d1.x * d2.y - d2.x * d1.y;
+        if (std::abs(det) < 1e-12f) {
+            frames[tri] = {glm::vec3(0), glm::vec3(0)};
+            return;
+        }
+        // Orientation matters, scale doesn't: both are normalized
+        glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * det;
+        glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * det;
+        float t = glm::length(tangent), b = glm::length(bitangent);
+        frames[tri] = {t > 0 ? tangent / t : glm::vec3(0),
+                       b > 0 ? bitangent / b : glm::vec3(0)};
+    }, CHUNK_SIZE);
+
+    // Corners of each vertex, as offsets into corners
+    std::vector<uint32_t> first(vertices.size() + 1, 0);
+    for (unsigned int index : indices)
+        first[index + 1]++;
+    for (size_t i = 1; i < first.size(); i++)
+        first[i] += first[i - 1];
+    std::vector<uint32_t> corners(indices.size());
+    std::vector<uint32_t> next(first.begin(), first.end() - 1);
+    for (size_t corner = 0; corner < indices.size(); corner++)
+        corners[next[indices[corner]]++] = uint32_t(corner);
+
+    parallel_for(pool, vertices.size(), [&](size_t v) {
+        Vertex& vertex = vertices[v];
+        glm::vec3 n = vertex.normal;
+        glm::vec3 tangent(0), bitangent(0);
+        for (uint32_t i = first[v]; i < first[v + 1]; i++) {
+            size_t corner = corners[i], tri = corner / 3, k = corner % 3;
+            const glm::vec3& a = vertices[indices[tri * 3 + (k + 1) % 3]].position;
+            const glm::vec3& b = vertices[indices[tri * 3 + (k + 2) % 3]].position;
+            float weight = corner_angle(vertex.position, a, b);
+            tangent += project_to_plane(frames[tri].tangent, n) * weight;
+            bitangent += project_to_plane(frames[tri].bitangent, n) * weight;
+        }
+        tangent = project_to_plane(tangent, n);
+        if (tangent == glm::vec3(0))
+            tangent = perpendicular(n);
+        float sign = glm::dot(glm::cross(n, tangent), bitangent) < 0 ? -1.f : 1.f;
+        vertex.tangent = pack_tangent(tangent, sign);
+    }, CHUNK_SIZE);
+}
@@ -0,0 +1,41 @@
+#ifndef TANGENTS_H
+#define TANGENTS_H
+
+#include <cstdint>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "thread_pool.h"
+
+// Packs a unit tangent and the sign of its bitangent, cross(normal, tangent) * sign, into
+// 32 bits: octahedral x and y at 15 bits each and the sign in the top bit. Decoded by
+// UnpackTangent in packing.glsl. constexpr so static meshes bake their tangents in.
+constexpr uint32_t pack_tangent(glm::vec3 tangent, float sign) {
+    auto abs = [](float v) { return v < 0 ? -v : v; };
+    auto sign_of = [](float v) { return v < 0 ? -1.f : 1.f; };
+    float l1 = abs(tangent.x) + abs(tangent.y) + abs(tangent.z);
+    float x = l1 > 0 ? tangent.x / l1 : 1.f, y = l1 > 0 ? tangent.y / l1 : 0.f;
+    if (tangent.z < 0) {
+        float wrapped_x = (1.f - abs(y)) * sign_of(x);
+        y = (1.f - abs(x)) * sign_of(y);
+        x = wrapped_x;
+    }
+    auto quantize = [](float v) { return uint32_t((v * 0.5f + 0.5f) * 32767.f + 0.5f); };
+    return quantize(x) | quantize(y) << 15 | (sign < 0 ? 1u << 31 : 0u);
+}
+
+// Tangent in xyz and bitangent sign in w
+glm::vec4 unpack_tangent(uint32_t packed);
+
+// Fills in the tangents of an indexed triangle mesh from its texture coordinates, the
+// way MikkTSpace weighs them: each corner contributes its triangle's UV-space tangent,
+// projected onto the vertex normal's plane and weighted by the corner angle. Vertices
+// are not split, so a vertex shared by mirrored UV islands gets a blended frame; meshes
+// with UV seams should already duplicate their seam vertices. Triangles, then
+// vertices, are split across the pool if there is one.
+void generate_tangents(std::span<Vertex> vertices, std::span<const unsigned int> indices,
+                       ThreadPool* pool = nullptr);
+
+#endif // TANGENTS_H
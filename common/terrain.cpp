@@ -0,0 +1,140 @@
+#include "terrain.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "errutils.h"
+#include "primitives.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Flat (tile_size + 1)^2 grid; terrain.vs reads grid coordinates from its texture
+// coordinates
+Mesh make_grid(uint32_t tile_size) {
+    int samples = int(tile_size) + 1;
+    std::vector<float> zeros(size_t(samples) * samples);
+    return make_heightfield(zeros, samples, samples, {1, 0, 1});
+}
+
+} // namespace
+
+Terrain::Terrain(const fs::path& tile_file, ThreadPool& pool, const TerrainOpts& opts)
+    : file_(tile_file),
+      pool_(pool),
+      opts_(opts),
+      quadtree_(file_.layout(), file_.ranges(), opts.spacing, opts.height_scale),
+      cache_(opts.max_tiles),
+      grid_(make_grid(file_.layout().tile_size)),
+      chunk_buffer_(GL_SHADER_STORAGE_BUFFER, MAX_CHUNKS * sizeof(GpuChunk)) {
+    const TerrainLayout& layout = file_.layout();
+    glm::uvec2 roots = layout.level_tiles(layout.levels - 1);
+    err::check(opts.max_tiles >= roots.x * roots.y + 4 && opts.max_tiles <= 2048,
+               "terrain needs 5 to 2048 resident tiles, got {}", opts.max_tiles);
+
+    GLsizei stride = GLsizei(layout.stride());
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &heights_.reset_as_ref());
+    glTextureStorage3D(*heights_, 1, GL_R16, stride, stride, GLsizei(opts.max_tiles));
+    glTextureParameteri(*heights_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(*heights_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*heights_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*heights_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // The top level is where every selection starts
+    for (uint32_t y = 0; y < roots.y; y++) {
+        for (uint32_t x = 0; x < roots.x; x++) {
+            PageId root{layout.levels - 1, x, y};
+            auto placement = cache_.insert(root, true);
+            upload(placement->slot, file_.read(root));
+        }
+    }
+}
+
+Terrain::~Terrain() {
+    // Reads in flight reference file_
+    for (auto& [key, future] : loading_)
+        future.wait();
+}
+
+void Terrain::update(glm::vec3 camera, const glm::mat4& view_projection) {
+    using namespace std::chrono_literals;
+
+    cache_.begin_frame();
+    LodParams params{camera, view_projection, opts_.lod_distance, opts_.morph_ratio};
+    auto selection = quadtree_.select(
+        params, [&](PageId tile) { return cache_.slot(tile).has_value(); }, &pool_);
+    cache_.touch(selection.used);
+    for (PageId tile : cache_.touch(selection.missing)) {
+        if (loading_.size() >= MAX_LOADS_IN_FLIGHT)
+            break;
+        if (!loading_.contains(tile.key()))
+            loading_.emplace(tile.key(),
+                             pool_.async([this, tile] { return file_.read(tile); }));
+    }
+    chunks_ = std::move(selection.chunks);
+
+    size_t uploads = 0;
+    for (auto it = loading_.begin();
+         it != loading_.end() && uploads < MAX_UPLOADS_PER_FRAME;) {
+        if (it->second.wait_for(0s) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        std::vector<uint16_t> samples = it->second.get();
+        // Fails when every tile is in use this frame; the tile is requested again while
+        // the selection still wants it
+        if (auto placement = cache_.insert(PageId::from_key(it->first))) {
+            upload(placement->slot, samples);
+            ++uploaded_;
+            ++uploads;
+        } else {
+            ++dropped_;
+        }
+        it = loading_.erase(it);
+    }
+}
+
+void Terrain::upload(uint32_t slot, const std::vector<uint16_t>& samples) {
+    GLsizei stride = GLsizei(file_.layout().stride());
+    // Rows of an odd stride aren't 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTextureSubImage3D(*heights_, 0, 0, 0, GLint(slot), stride, stride, 1, GL_RED,
+                        GL_UNSIGNED_SHORT, samples.data());
+}
+
+void Terrain::draw(const Shader& shader, GLuint unit) {
+    if (chunks_.empty())
+        return;
+    const TerrainLayout& layout = file_.layout();
+    // Chunks past the buffer's capacity are left out
+    size_t count = std::min(chunks_.size(), MAX_CHUNKS);
+    chunk_buffer_.begin_frame();
+    auto allocation = chunk_buffer_.allocate(count * sizeof(GpuChunk));
+    auto* out = reinterpret_cast<GpuChunk*>(allocation.data);
+    for (size_t i = 0; i < count; i++) {
+        const TerrainChunk& chunk = chunks_[i];
+        PageId tile = chunk.tile;
+        // Resident: chunks were touched this frame, so nothing evicted them
+        out[i] = {glm::vec2(tile.x, tile.y) * float(layout.tile_span(tile.level)),
+                  float(1u << tile.level),
+                  *cache_.slot(tile),
+                  {chunk.morph_start, chunk.morph_end},
+                  {}};
+    }
+    chunk_buffer_.bind(CHUNK_BINDING, allocation);
+
+    glBindTextureUnit(unit, *heights_);
+    shader.set_int("terrainHeights", int(unit));
+    shader.set_float("terrainTileSize", float(layout.tile_size));
+    shader.set_float("terrainBorder", float(layout.border));
+    shader.set_float("terrainStride", float(layout.stride()));
+    shader.set_vec2("terrainLast", float(layout.width - 1), float(layout.height - 1));
+    shader.set_float("terrainSpacing", opts_.spacing);
+    shader.set_float("terrainHeightScale", opts_.height_scale);
+
+    glBindVertexArray(grid_.vao());
+    glDrawElementsInstanced(GL_TRIANGLES, grid_.num_indices(), GL_UNSIGNED_INT, nullptr,
+                            GLsizei(count));
+    chunk_buffer_.end_frame();
+}
@@ -0,0 +1,100 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "dynamic_buffer.h"
+#include "gl_resources.h"
+#include "mesh.h"
+#include "page_cache.h"
+#include "shader.h"
+#include "terrain_lod.h"
+#include "terrain_tiles.h"
+#include "thread_pool.h"
+
+struct TerrainOpts {
+    // World units between level-0 samples
+    float spacing = 1;
+    // World height of the largest sample value
+    float height_scale = 256;
+    // Resident tiles, each a layer of the height texture array
+    uint32_t max_tiles = 256;
+    float lod_distance = 2;
+    float morph_ratio = 0.66f;
+};
+
+// Heightfield terrain streamed from a tile file (see build_terrain_file) and drawn with
+// CDLOD: TerrainQuadtree picks a tile per chunk of screen, and one shared grid mesh is
+// instanced over them, displaced by the tile heights in terrain.vs. Vertices morph
+// into the next coarser grid with distance, so levels meet without cracks.
+//
+// Only max_tiles tiles are resident, in a fixed texture array, so memory doesn't grow
+// with the heightmap. Tiles the selection wants to split into are read on the thread
+// pool and uploaded as they arrive; until then their parent is drawn. The top level
+// is always resident.
+class Terrain {
+  public:
+    static constexpr GLuint CHUNK_BINDING = 8;
+    static constexpr size_t MAX_CHUNKS = 4096;
+
+    struct Stats {
+        size_t chunks, resident, loading, uploaded, dropped;
+    };
+
+    Terrain(const std::filesystem::path& tile_file, ThreadPool& pool,
+            const TerrainOpts& opts = {});
+    ~Terrain();
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // Selects this frame's chunks, queues reads of missing tiles and uploads tiles that
+    // arrived
+    void update(glm::vec3 camera, const glm::mat4& view_projection);
+    // Draws the selected chunks with a program using terrain.vs, binding the height
+    // tiles to unit. The caller sets view, projection and viewPos.
+    void draw(const Shader& shader, GLuint unit);
+
+    const TerrainQuadtree& quadtree() const { return quadtree_; }
+    Stats stats() const {
+        return {chunks_.size(), cache_.size(), loading_.size(), uploaded_, dropped_};
+    }
+
+  private:
+    static constexpr size_t MAX_LOADS_IN_FLIGHT = 32;
+    static constexpr size_t MAX_UPLOADS_PER_FRAME = 16;
+
+    // std430 layout of TerrainChunk in terrain.vs
+    struct GpuChunk {
+        glm::vec2 origin;
+        float scale;
+        uint32_t layer;
+        glm::vec2 morph_range;
+        glm::vec2 pad;
+    };
+    static_assert(sizeof(GpuChunk) == 32);
+
+    void upload(uint32_t slot, const std::vector<uint16_t>& samples);
+
+    TerrainFile file_;
+    ThreadPool& pool_;
+    TerrainOpts opts_;
+    TerrainQuadtree quadtree_;
+    PageCache cache_;
+
+    TextureHandle heights_;
+    Mesh grid_;
+    DynamicBuffer chunk_buffer_;
+    std::vector<TerrainChunk> chunks_;
+
+    std::unordered_map<uint32_t, std::future<std::vector<uint16_t>>> loading_;
+    size_t uploaded_ = 0, dropped_ = 0;
+};
+
+#endif // TERRAIN_H
@@ -0,0 +1,132 @@
+#include "terrain_lod.h"
+
+#include <algorithm>
+#include <array>
+
+#include "errutils.h"
+
+namespace {
+
+// Levels selected serially before handing subtrees to the pool; up to 4^3 subtrees
+constexpr uint32_t SERIAL_LEVELS = 3;
+
+} // namespace
+
+TerrainQuadtree::TerrainQuadtree(const TerrainLayout& layout,
+                                 std::span<const HeightRange> ranges, float spacing,
+                                 float height_scale)
+    : layout_(layout), ranges_(ranges.begin(), ranges.end()), spacing_(spacing),
+      height_scale_(height_scale) {
+    err::check(ranges_.size() == layout.num_tiles(), "{} height ranges for {} tiles",
+               ranges_.size(), layout.num_tiles());
+}
+
+glm::vec3 TerrainQuadtree::world_position(glm::vec2 sample, float value) const {
+    glm::vec2 center = glm::vec2(layout_.width - 1, layout_.height - 1) * 0.5f;
+    return {(sample.x - center.x) * spacing_, value / float(UINT16_MAX) * height_scale_,
+            (center.y - sample.y) * spacing_};
+}
+
+Bounds TerrainQuadtree::bounds(PageId tile) const {
+    float span = float(layout_.tile_span(tile.level));
+    glm::vec2 last = glm::vec2(layout_.width - 1, layout_.height - 1);
+    glm::vec2 begin = glm::vec2(tile.x, tile.y) * span;
+    glm::vec2 end = glm::min(begin + span, last);
+    HeightRange range = ranges_[layout_.tile_index(tile)];
+    glm::vec3 a = world_position(begin, range.min), b = world_position(end, range.max);
+    return {glm::min(a, b), glm::max(a, b)};
+}
+
+TerrainQuadtree::Selection TerrainQuadtree::select(const LodParams& params,
+                                                   util::function_ref<bool(PageId)> resident,
+                                                   ThreadPool* pool) const {
+    Selection selection;
+    uint32_t top = layout_.levels - 1;
+    bool parallel = pool && top > SERIAL_LEVELS;
+    std::vector<Subtree> deferred;
+    glm::uvec2 roots = layout_.level_tiles(top);
+    for (uint32_t y = 0; y < roots.y; y++) {
+        for (uint32_t x = 0; x < roots.x; x++) {
+            PageId root{top, x, y};
+            if (!resident(root)) {
+                selection.missing.push_back(root);
+                continue;
+            }
+            visit(root, params, resident, selection, parallel ? &deferred : nullptr,
+                  top - SERIAL_LEVELS);
+        }
+    }
+    if (deferred.empty())
+        return selection;
+
+    std::vector<Selection> parts(deferred.size());
+    pool->parallel_for(deferred.size(), [&](size_t i) {
+        visit(deferred[i].root, params, resident, parts[i], nullptr, 0);
+    });
+    // Each subtree's lists go where the serial traversal would have visited it
+    auto splice = [&]<typename T>(std::vector<T> Selection::*list, size_t Subtree::*offset) {
+        std::vector<T>& serial = selection.*list;
+        std::vector<T> merged;
+        size_t from = 0;
+        for (size_t i = 0; i < deferred.size(); i++) {
+            size_t to = deferred[i].*offset;
+            merged.insert(merged.end(), serial.begin() + from, serial.begin() + to);
+            merged.append_range(parts[i].*list);
+            from = to;
+        }
+        merged.insert(merged.end(), serial.begin() + from, serial.end());
+        serial = std::move(merged);
+    };
+    splice(&Selection::chunks, &Subtree::chunks);
+    splice(&Selection::used, &Subtree::used);
+    splice(&Selection::missing, &Subtree::missing);
+    return selection;
+}
+
+void TerrainQuadtree::visit(PageId tile, const LodParams& params,
+                            util::function_ref<bool(PageId)> resident, Selection& out,
+                            std::vector<Subtree>* deferred, uint32_t defer_level) const {
+    Bounds box = bounds(tile);
+    if (!box.intersects_frustum(params.view_projection))
+        return;
+    out.used.push_back(tile);
+
+    uint32_t level = tile.level;
+    if (level > 0) {
+        glm::vec3 nearest = glm::clamp(params.camera, box.min, box.max);
+        float split_range = lod_range(level - 1, params.lod_distance);
+        if (glm::distance(nearest, params.camera) < split_range) {
+            // Split only once every visible child can be drawn, so chunks never overlap
+            std::array<PageId, 4> children;
+            size_t num_children = 0;
+            bool all_resident = true;
+            glm::uvec2 tiles = layout_.level_tiles(level - 1);
+            for (uint32_t cy = 2 * tile.y; cy < std::min(2 * tile.y + 2, tiles.y); cy++) {
+                for (uint32_t cx = 2 * tile.x; cx < std::min(2 * tile.x + 2, tiles.x); cx++) {
+                    PageId child{level - 1, cx, cy};
+                    if (!bounds(child).intersects_frustum(params.view_projection))
+                        continue;
+                    children[num_children++] = child;
+                    if (!resident(child)) {
+                        all_resident = false;
+                        out.missing.push_back(child);
+                    }
+                }
+            }
+            if (all_resident) {
+                for (size_t i = 0; i < num_children; i++) {
+                    if (deferred && children[i].level == defer_level)
+                        deferred->push_back({children[i], out.chunks.size(), out.used.size(),
+                                             out.missing.size()});
+                    else
+                        visit(children[i], params, resident, out, deferred, defer_level);
+                }
+                return;
+            }
+        }
+    }
+
+    float range = lod_range(level, params.lod_distance);
+    float previous = level > 0 ? lod_range(level - 1, params.lod_distance) : 0.f;
+    out.chunks.push_back({tile, previous + (range - previous) * params.morph_ratio, range});
+}
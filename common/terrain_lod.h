@@ -0,0 +1,89 @@
+#ifndef TERRAIN_LOD_H
+#define TERRAIN_LOD_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "page_cache.h"
+#include "terrain_tiles.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+// A tile drawn this frame, with the camera distances over which its vertices morph
+// into the grid of its parent level
+struct TerrainChunk {
+    PageId tile;
+    float morph_start, morph_end;
+};
+
+struct LodParams {
+    glm::vec3 camera;
+    glm::mat4 view_projection;
+    // Tiles are split while closer than lod_distance times their own width. At least
+    // about 2 keeps neighbouring chunks within one level of each other.
+    float lod_distance = 2.f;
+    // Fraction of the way from the previous level's range to a level's own at which
+    // its vertices start morphing
+    float morph_ratio = 0.66f;
+};
+
+// CDLOD chunk selection over the tiles of a TerrainLayout, in world space: level-0
+// samples are spacing apart on the xz plane and centered on the origin, rows running
+// from +z to -z like make_heightfield, and sample values map to [0, height_scale].
+// Pure CPU logic; Terrain renders and streams the result.
+class TerrainQuadtree {
+  public:
+    struct Selection {
+        std::vector<TerrainChunk> chunks;
+        // Resident tiles the selection went through, chunks included
+        std::vector<PageId> used;
+        // Tiles that weren't resident where the selection wanted to split; their parent
+        // is drawn instead
+        std::vector<PageId> missing;
+    };
+
+    TerrainQuadtree(const TerrainLayout& layout, std::span<const HeightRange> ranges,
+                    float spacing, float height_scale);
+
+    // Distance from the camera within which tiles of level are split
+    float lod_range(uint32_t level, float lod_distance) const {
+        return lod_distance * spacing_ * float(layout_.tile_span(level));
+    }
+    // World position of a level-0 sample coordinate and a sample value
+    glm::vec3 world_position(glm::vec2 sample, float value) const;
+    Bounds bounds(PageId tile) const;
+
+    // Selects the chunks to draw from the coarsest level down, skipping tiles outside
+    // the view frustum. Only tiles for which resident returns true are split into.
+    // With a pool, subtrees below the top few levels are selected in parallel, so
+    // resident must be safe to call concurrently. The result is the same either way,
+    // order included.
+    Selection select(const LodParams& params, util::function_ref<bool(PageId)> resident,
+                     ThreadPool* pool = nullptr) const;
+
+    const TerrainLayout& layout() const { return layout_; }
+    float spacing() const { return spacing_; }
+    float height_scale() const { return height_scale_; }
+
+  private:
+    // A subtree left for the pool, and the sizes of the selection's lists when the
+    // serial traversal reached it: where its own chunks and tiles go
+    struct Subtree {
+        PageId root;
+        size_t chunks, used, missing;
+    };
+
+    void visit(PageId tile, const LodParams& params,
+               util::function_ref<bool(PageId)> resident, Selection& out,
+               std::vector<Subtree>* deferred, uint32_t defer_level) const;
+
+    TerrainLayout layout_;
+    std::vector<HeightRange> ranges_;
+    float spacing_, height_scale_;
+};
+
+#endif // TERRAIN_LOD_H
@@ -0,0 +1,161 @@
+#include "terrain_tiles.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "errutils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'G', 'T', 'R'};
+constexpr uint32_t VERSION = 1;
+// Tile coordinates have to fit PageId keys
+constexpr uint32_t MAX_LEVELS = 16;
+constexpr uint32_t MAX_TILES_PER_SIDE = 4096;
+
+// On-disk header, native byte order
+struct TerrainFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height, tile_size, border, levels;
+};
+
+} // namespace
+
+TerrainLayout TerrainLayout::for_heightmap(uint32_t width, uint32_t height,
+                                           uint32_t tile_size, uint32_t border) {
+    // Odd grid vertices morph onto even ones, which must line up across tiles
+    err::check(width >= 2 && height >= 2 && tile_size >= 2 && tile_size % 2 == 0,
+               "need a heightmap of at least 2x2 and an even tile size, got {}x{} and {}",
+               width, height, tile_size);
+    TerrainLayout layout{width, height, tile_size, border, 1};
+    while (glm::any(glm::greaterThan(layout.level_tiles(layout.levels - 1), glm::uvec2(1))))
+        ++layout.levels;
+    glm::uvec2 tiles = layout.level_tiles(0);
+    err::check(layout.levels <= MAX_LEVELS && tiles.x <= MAX_TILES_PER_SIDE &&
+                   tiles.y <= MAX_TILES_PER_SIDE,
+               "{}x{} heightmap needs larger tiles than {}", width, height, tile_size);
+    return layout;
+}
+
+uint32_t TerrainLayout::level_offset(uint32_t level) const {
+    uint32_t offset = 0;
+    for (uint32_t l = 0; l < level; l++) {
+        glm::uvec2 tiles = level_tiles(l);
+        offset += tiles.x * tiles.y;
+    }
+    return offset;
+}
+
+void build_terrain_file(std::span<const uint16_t> heights, uint32_t width, uint32_t height,
+                        const fs::path& path, ThreadPool& pool, uint32_t tile_size,
+                        uint32_t border) {
+    err::check(heights.size() == size_t(width) * height,
+               "{}: {} heights for a {}x{} heightmap", path.string(), heights.size(), width,
+               height);
+    auto layout = TerrainLayout::for_heightmap(width, height, tile_size, border);
+    auto sample = [&](int64_t x, int64_t y) {
+        x = std::clamp<int64_t>(x, 0, width - 1);
+        y = std::clamp<int64_t>(y, 0, height - 1);
+        return heights[size_t(y) * width + size_t(x)];
+    };
+
+    // Level 0 ranges come from the samples, coarser ones from their children
+    std::vector<HeightRange> ranges(layout.num_tiles());
+    glm::uvec2 tiles = layout.level_tiles(0);
+    pool.parallel_for(size_t(tiles.y), [&](size_t ty) {
+        for (uint32_t tx = 0; tx < tiles.x; tx++) {
+            HeightRange range{UINT16_MAX, 0};
+            int64_t x0 = int64_t(tx) * tile_size, y0 = int64_t(ty) * tile_size;
+            for (int64_t y = y0; y <= std::min<int64_t>(y0 + tile_size, height - 1); y++) {
+                for (int64_t x = x0; x <= std::min<int64_t>(x0 + tile_size, width - 1); x++) {
+                    range.min = std::min(range.min, sample(x, y));
+                    range.max = std::max(range.max, sample(x, y));
+                }
+            }
+            ranges[layout.tile_index({0, tx, uint32_t(ty)})] = range;
+        }
+    });
+    for (uint32_t level = 1; level < layout.levels; level++) {
+        glm::uvec2 tiles = layout.level_tiles(level), children = layout.level_tiles(level - 1);
+        for (uint32_t y = 0; y < tiles.y; y++) {
+            for (uint32_t x = 0; x < tiles.x; x++) {
+                HeightRange range{UINT16_MAX, 0};
+                for (uint32_t cy = 2 * y; cy < std::min(2 * y + 2, children.y); cy++) {
+                    for (uint32_t cx = 2 * x; cx < std::min(2 * x + 2, children.x); cx++) {
+                        HeightRange child = ranges[layout.tile_index({level - 1, cx, cy})];
+                        range.min = std::min(range.min, child.min);
+                        range.max = std::max(range.max, child.max);
+                    }
+                }
+                ranges[layout.tile_index({level, x, y})] = range;
+            }
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    err::check(file.is_open(), "failed to create tile file {}", path.string());
+    TerrainFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.tile_size = tile_size;
+    header.border = border;
+    header.levels = layout.levels;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(ranges.data()),
+               std::streamsize(ranges.size() * sizeof(HeightRange)));
+
+    int64_t stride = layout.stride();
+    std::vector<uint16_t> row;
+    for (uint32_t level = 0; level < layout.levels; level++) {
+        glm::uvec2 tiles = layout.level_tiles(level);
+        row.resize(tiles.x * layout.tile_bytes() / sizeof(uint16_t));
+        for (uint32_t ty = 0; ty < tiles.y; ty++) {
+            pool.parallel_for(size_t(tiles.x), [&](size_t tx) {
+                uint16_t* out = &row[tx * size_t(stride * stride)];
+                int64_t x0 = int64_t(tx) * tile_size - border;
+                int64_t y0 = int64_t(ty) * tile_size - border;
+                for (int64_t y = 0; y < stride; y++) {
+                    for (int64_t x = 0; x < stride; x++)
+                        *out++ = sample((x0 + x) << level, (y0 + y) << level);
+                }
+            });
+            file.write(reinterpret_cast<const char*>(row.data()),
+                       std::streamsize(row.size() * sizeof(uint16_t)));
+        }
+    }
+    err::check(file.good(), "failed to write tile file {}", path.string());
+}
+
+TerrainFile::TerrainFile(const fs::path& path) : file_(path, MappedFile::Access::Random) {
+    TerrainFileHeader header;
+    err::check(file_.size() >= sizeof(header), "{} is not a tile file", path.string());
+    std::memcpy(&header, file_.data(), sizeof(header));
+    err::check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                   header.version == VERSION,
+               "{} is not a tile file", path.string());
+    layout_ = TerrainLayout::for_heightmap(header.width, header.height, header.tile_size,
+                                           header.border);
+    err::check(layout_.levels == header.levels, "{}: inconsistent tile file header",
+               path.string());
+    ranges_.resize(layout_.num_tiles());
+    data_offset_ = sizeof(header) + ranges_.size() * sizeof(HeightRange);
+    err::check(file_.size() >= data_offset_ + layout_.num_tiles() * layout_.tile_bytes(),
+               "{}: truncated tile file", path.string());
+    std::memcpy(ranges_.data(), file_.data() + sizeof(header),
+                ranges_.size() * sizeof(HeightRange));
+}
+
+std::vector<uint16_t> TerrainFile::read(PageId tile) const {
+    // Copying faults the pages in on the calling thread, see PageFile::read
+    std::vector<uint16_t> samples(layout_.tile_bytes() / sizeof(uint16_t));
+    auto bytes = file_.bytes(data_offset_ + layout_.tile_index(tile) * layout_.tile_bytes(),
+                             layout_.tile_bytes());
+    std::memcpy(samples.data(), bytes.data(), bytes.size());
+    return samples;
+}
@@ -0,0 +1,75 @@
+#ifndef TERRAIN_TILES_H
+#define TERRAIN_TILES_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mapped_file.h"
+#include "page_cache.h"
+#include "thread_pool.h"
+
+// How a heightmap is split into square tiles for quadtree LOD. A tile of level L
+// covers tile_size quads of 2^L level-0 samples each, so it always holds
+// tile_size + 1 samples per side, taken from every 2^L-th level-0 sample. Vertices of
+// coarser levels therefore lie exactly on finer ones. Each tile also carries a border
+// of neighbouring samples (clamped at the heightmap edge) for normals. Levels go up to
+// the first one that covers the heightmap with a single tile.
+struct TerrainLayout {
+    uint32_t width, height, tile_size, border, levels;
+
+    static TerrainLayout for_heightmap(uint32_t width, uint32_t height, uint32_t tile_size,
+                                       uint32_t border);
+
+    // Level-0 samples covered by a tile of level, edge to edge
+    uint32_t tile_span(uint32_t level) const { return tile_size << level; }
+    glm::uvec2 level_tiles(uint32_t level) const {
+        glm::uvec2 quads = glm::max(glm::uvec2(width, height) - 1u, 1u);
+        return (quads + tile_span(level) - 1u) / tile_span(level);
+    }
+    // Index of the first tile of level among the tiles of all levels
+    uint32_t level_offset(uint32_t level) const;
+    uint32_t num_tiles() const { return level_offset(levels); }
+    uint32_t tile_index(PageId tile) const {
+        return level_offset(tile.level) + tile.y * level_tiles(tile.level).x + tile.x;
+    }
+
+    // Samples per side of a stored tile, border included
+    uint32_t stride() const { return tile_size + 1 + 2 * border; }
+    size_t tile_bytes() const { return size_t(stride()) * stride() * sizeof(uint16_t); }
+};
+
+// Smallest and largest level-0 sample under a tile, for its bounding box
+struct HeightRange {
+    uint16_t min, max;
+};
+
+// Tiles a row-major width x height heightmap into a tile file: the layout, the height
+// range of every tile, then the tiles of each level in row-major order. Memory use of
+// the build is the heightmap plus one row of tiles; the tiles of a row are filled on
+// the pool.
+void build_terrain_file(std::span<const uint16_t> heights, uint32_t width, uint32_t height,
+                        const std::filesystem::path& path, ThreadPool& pool,
+                        uint32_t tile_size = 64, uint32_t border = 1);
+
+// Read side of a tile file, mapped into memory. The height ranges are loaded up front;
+// read() may be called from any thread.
+class TerrainFile {
+  public:
+    explicit TerrainFile(const std::filesystem::path& path);
+
+    const TerrainLayout& layout() const { return layout_; }
+    std::span<const HeightRange> ranges() const { return ranges_; }
+    std::vector<uint16_t> read(PageId tile) const;
+
+  private:
+    MappedFile file_;
+    TerrainLayout layout_;
+    std::vector<HeightRange> ranges_;
+    size_t data_offset_;
+};
+
+#endif // TERRAIN_TILES_H
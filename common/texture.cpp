@@ -1,54 +1,145 @@
 #include "texture.h"
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <exception>
 #include <filesystem>
 
 #include <glad/glad.h>
-#include <stb_image.h>
 
 #include "errutils.h"
-#include "u8tils.h"
+#include "gl_resources.h"
+#include "image_decoder.h"
+#include "raii.h"
+#include "vfs.h"
 
-GLuint load_texture(const std::filesystem::path& path, const TextureOpts& opts) {
-    int width, height, channels;
-    stbi_set_flip_vertically_on_load(opts.flip);
-    unsigned char* data =
-        stbi_load(u8::path_to_char(path), &width, &height, &channels, 0);
-    err::check(data, "failed to load texture {}: {}", path.string(),
-               stbi_failure_reason());
-
-    GLenum format = std::array{GL_RED, GL_RG, GL_RGB, GL_RGBA}[channels - 1];
+namespace {
+
+// Filtering, wrapping and grayscale swizzles from opts. The texture must be bound to
+// GL_TEXTURE_2D when DSA is unavailable.
+void set_texture_params(GLuint id, const TextureOpts& opts, int channels) {
+    auto set = [&](GLenum pname, GLint param) {
+        if (has_dsa())
+            glTextureParameteri(id, pname, param);
+        else
+            glTexParameteri(GL_TEXTURE_2D, pname, param);
+    };
+    set(GL_TEXTURE_WRAP_S, opts.wrap);
+    set(GL_TEXTURE_WRAP_T, opts.wrap);
+    set(GL_TEXTURE_MIN_FILTER, opts.min_filter);
+    set(GL_TEXTURE_MAG_FILTER, opts.mag_filter);
+    if (has_dsa())
+        glTextureParameterf(id, GL_TEXTURE_MAX_ANISOTROPY, opts.anisotropy);
+    else
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, opts.anisotropy);
+    // set swizzle mask for grayscale
+    if (channels <= 2) {
+        GLint alpha = channels == 1 ? GL_ONE : GL_GREEN;
+        set(GL_TEXTURE_SWIZZLE_R, GL_RED);
+        set(GL_TEXTURE_SWIZZLE_G, GL_RED);
+        set(GL_TEXTURE_SWIZZLE_B, GL_RED);
+        set(GL_TEXTURE_SWIZZLE_A, alpha);
+    }
+}
+
+} // namespace
+
+TextureData load_texture_data(const std::filesystem::path& path, const TextureOpts& opts) {
+    // Decoded straight from the mapping, without stdio buffering
+    FileData file = vfs::read(path);
+    DecodedImage image;
+    try {
+        image = decode_image(file.bytes(), {.channels = opts.channels, .flip = opts.flip});
+    } catch (const std::exception& e) {
+        err::error("failed to load texture {}: {}", path.string(), e.what());
+    }
+
+    TextureData tex{image.width, image.height, image.channels, opts.srgb,
+                    std::move(image.pixels), {}};
+    if (opts.gen_mipmaps)
+        tex.mips = generate_mips(tex.pixels, tex.width, tex.height, tex.channels, opts.srgb,
+                                 opts.pool);
+    return tex;
+}
+
+GLuint upload_texture(const TextureData& tex, const TextureOpts& opts) {
+    GLenum format = std::array{GL_RED, GL_RG, GL_RGB, GL_RGBA}[tex.channels - 1];
     GLint internal_format = std::array{
         GL_R8,
         GL_RG8,
-        opts.srgb ? GL_SRGB8 : GL_RGB8,
-        opts.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8
-    }[channels - 1];
+        tex.srgb ? GL_SRGB8 : GL_RGB8,
+        tex.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8
+    }[tex.channels - 1];
 
+    auto levels = GLsizei(tex.mips.size() + 1);
     TextureHandle id;
-    glGenTextures(1, &id.reset_as_ref());
-    glBindTexture(GL_TEXTURE_2D, *id);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
-    stbi_image_free(data);
+    if (has_dsa()) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &id.reset_as_ref());
+        glTextureStorage2D(*id, levels, internal_format, tex.width, tex.height);
+        glTextureSubImage2D(*id, 0, 0, 0, tex.width, tex.height, format, GL_UNSIGNED_BYTE,
+                            tex.pixels.data());
+        for (GLint i = 1; i < levels; i++) {
+            auto& mip = tex.mips[i - 1];
+            glTextureSubImage2D(*id, i, 0, 0, mip.width, mip.height, format,
+                                GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+    } else {
+        glGenTextures(1, &id.reset_as_ref());
+        glBindTexture(GL_TEXTURE_2D, *id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, tex.width, tex.height, 0, format,
+                     GL_UNSIGNED_BYTE, tex.pixels.data());
+        for (GLint i = 1; i < levels; i++) {
+            auto& mip = tex.mips[i - 1];
+            glTexImage2D(GL_TEXTURE_2D, i, internal_format, mip.width, mip.height, 0, format,
+                         GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+    }
 
-    if (opts.gen_mipmaps) {
-        glGenerateMipmap(GL_TEXTURE_2D);
+    set_texture_params(*id, opts, tex.channels);
+    return id.release();
+}
+
+GLuint load_texture(const std::filesystem::path& path, const TextureOpts& opts) {
+    return upload_texture(load_texture_data(path, opts), opts);
+}
+
+FloatImage load_float_image(const std::filesystem::path& path, bool flip) {
+    FileData file = vfs::read(path);
+    try {
+        return decode_float_image(file.bytes(), flip);
+    } catch (const std::exception& e) {
+        err::error("failed to load image {}: {}", path.string(), e.what());
     }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, opts.wrap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, opts.wrap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, opts.min_filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, opts.mag_filter);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, opts.anisotropy);
-    // set swizzle mask for grayscale
-    if (channels == 1) {
-        GLint swizzle_mask[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
-        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle_mask);
-    } else if (channels == 2) {
-        GLint swizzle_mask[] = {GL_RED, GL_RED, GL_RED, GL_GREEN};
-        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle_mask);
+}
+
+GLuint upload_float_texture(const FloatImage& image, GLenum internal_format,
+                            const TextureOpts& opts) {
+    auto levels = opts.gen_mipmaps
+                      ? GLsizei(std::bit_width(unsigned(std::max(image.width, image.height))))
+                      : 1;
+    TextureHandle id;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (has_dsa()) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &id.reset_as_ref());
+        glTextureStorage2D(*id, levels, internal_format, image.width, image.height);
+        glTextureSubImage2D(*id, 0, 0, 0, image.width, image.height, GL_RGB, GL_FLOAT,
+                            image.pixels.data());
+        if (levels > 1)
+            glGenerateTextureMipmap(*id);
+    } else {
+        glGenTextures(1, &id.reset_as_ref());
+        glBindTexture(GL_TEXTURE_2D, *id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLint(internal_format), image.width, image.height, 0,
+                     GL_RGB, GL_FLOAT, image.pixels.data());
+        if (levels > 1)
+            glGenerateMipmap(GL_TEXTURE_2D);
     }
+
+    set_texture_params(*id, opts, 3);
     return id.release();
 }
 
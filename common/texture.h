@@ -1,27 +1,60 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
-#include <iostream>
+#include <cstdint>
 #include <filesystem>
+#include <iostream>
+#include <vector>
 
 #include <glad/glad.h>
 
+#include "gl_resources.h"
+#include "image_decoder.h"
+#include "mipmap.h"
 #include "raii.h"
+#include "thread_pool.h"
 
 using TextureHandle = Handle<GLuint, gl_delete_array_functor<glDeleteTextures>>;
 
 struct TextureOpts {
     bool flip = true;
     bool srgb = false;
+    // Channels to decode to, or 0 for the image's own
+    int channels = 0;
     bool gen_mipmaps = true;
     GLenum min_filter = GL_LINEAR_MIPMAP_LINEAR;
     GLenum mag_filter = GL_LINEAR;
     GLenum wrap = GL_REPEAT;
     float anisotropy = 8.f;
+    // Generates mips on this pool, or serially without one
+    ThreadPool* pool = nullptr;
 };
 
+// Decoded image plus its CPU-generated mip chain, ready for upload
+struct TextureData {
+    int width, height, channels;
+    bool srgb;
+    std::vector<uint8_t> pixels;
+    // Levels 1 and up; empty without opts.gen_mipmaps
+    std::vector<ImageLevel> mips;
+};
+
+// Decodes an image and generates its mips on the CPU. Touches no GL state, so it can
+// run on a worker thread.
+TextureData load_texture_data(const std::filesystem::path& path, const TextureOpts& opts = {});
+// Uploads every level into an immutable-storage texture (mutable storage on contexts
+// without DSA). GL thread only.
+GLuint upload_texture(const TextureData& data, const TextureOpts& opts = {});
 GLuint load_texture(const std::filesystem::path& path, const TextureOpts& opts = {});
 
+// Decodes a high dynamic range image (see decode_float_image). No GL state.
+FloatImage load_float_image(const std::filesystem::path& path, bool flip = true);
+// Uploads into an immutable-storage float texture, with mips generated on the GPU.
+// GL_R11F_G11F_B10F takes 4 bytes a texel; GL_RGB16F takes 6 and keeps more precision.
+GLuint upload_float_texture(const FloatImage& image,
+                            GLenum internal_format = GL_R11F_G11F_B10F,
+                            const TextureOpts& opts = {});
+
 class Texture {
   public:
     Texture() : Texture(0, {}) {}
@@ -38,6 +71,10 @@ class Texture {
 
     void bind() const { glBindTexture(GL_TEXTURE_2D, id()); }
     void bind(unsigned int unit) const {
+        if (has_dsa()) {
+            glBindTextureUnit(unit, id());
+            return;
+        }
         glActiveTexture(GL_TEXTURE0 + unit);
         bind();
     }
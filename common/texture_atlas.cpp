@@ -0,0 +1,168 @@
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <exception>
+
+#include "errutils.h"
+#include "skyline_packer.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// RGBA texel of an 8-bit image, wrapping around like GL_REPEAT. Gray and gray-alpha
+// images expand the way upload_texture's swizzles do.
+void fetch_wrapped(const TextureData& image, int x, int y, uint8_t* out) {
+    x = (x % image.width + image.width) % image.width;
+    y = (y % image.height + image.height) % image.height;
+    int channels = image.channels;
+    const uint8_t* p = &image.pixels[(size_t(y) * image.width + x) * channels];
+    bool gray = channels < 3;
+    out[0] = p[0];
+    out[1] = gray ? p[0] : p[1];
+    out[2] = gray ? p[0] : p[2];
+    out[3] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+}
+
+int atlas_levels(const AtlasOpts& opts) {
+    return std::max(int(std::bit_width(unsigned(opts.padding))) - 1, 1);
+}
+
+bool is_srgb(GLuint texture) {
+    GLint format;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    return format == GL_SRGB8 || format == GL_SRGB8_ALPHA8;
+}
+
+} // namespace
+
+AtlasData build_atlas(std::span<const AtlasSource> sources, const AtlasOpts& opts) {
+    std::vector<AtlasSource> sorted(sources.begin(), sources.end());
+    std::ranges::sort(sorted, {}, &AtlasSource::path);
+    auto duplicates = std::ranges::unique(sorted, {}, &AtlasSource::path);
+    sorted.erase(duplicates.begin(), duplicates.end());
+
+    std::vector<TextureData> images(sorted.size());
+    std::vector<std::exception_ptr> errors(sorted.size());
+    parallel_for(opts.pool, sorted.size(), [&](size_t i) {
+        try {
+            images[i] = load_texture_data(
+                sorted[i].path,
+                {.flip = opts.flip, .srgb = sorted[i].srgb, .channels = 4,
+                 .gen_mipmaps = false});
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    AtlasData atlas;
+    int page_size = opts.page_size, padding = opts.padding;
+    for (bool srgb : {false, true}) {
+        std::vector<size_t> members;
+        std::vector<glm::ivec2> sizes;
+        for (size_t i = 0; i < images.size(); i++) {
+            const TextureData& image = images[i];
+            if (image.srgb != srgb || image.width > opts.max_texture_size ||
+                image.height > opts.max_texture_size)
+                continue;
+            members.push_back(i);
+            sizes.push_back({image.width + 2 * padding, image.height + 2 * padding});
+        }
+        if (members.empty())
+            continue;
+
+        std::vector<PackedRect> rects = pack_rects(sizes, page_size, page_size);
+        size_t group = atlas.groups.size();
+        auto& pages = atlas.groups.emplace_back(srgb).pages;
+        for (auto& rect : rects) {
+            while (rect.page >= int(pages.size())) {
+                pages.push_back({page_size, page_size, 4, srgb,
+                                 std::vector<uint8_t>(size_t(page_size) * page_size * 4), {}});
+            }
+        }
+
+        // Rectangles don't overlap, so textures are copied in parallel
+        parallel_for(opts.pool, members.size(), [&](size_t m) {
+            const TextureData& image = images[members[m]];
+            PackedRect rect = rects[m];
+            auto& pixels = pages[rect.page].pixels;
+            for (int y = 0; y < sizes[m].y; y++) {
+                for (int x = 0; x < sizes[m].x; x++) {
+                    size_t offset = (size_t(rect.position.y + y) * page_size +
+                                     rect.position.x + x) * 4;
+                    fetch_wrapped(image, x - padding, y - padding, &pixels[offset]);
+                }
+            }
+        });
+        for (auto& page : pages) {
+            page.mips = generate_mips(page.pixels, page_size, page_size, 4, srgb, opts.pool);
+            page.mips.resize(size_t(atlas_levels(opts) - 1));
+        }
+
+        for (size_t m = 0; m < members.size(); m++) {
+            const TextureData& image = images[members[m]];
+            glm::vec2 origin = glm::vec2(rects[m].position + padding) / float(page_size);
+            glm::vec2 scale = glm::vec2(image.width, image.height) / float(page_size);
+            atlas.regions.push_back({sorted[members[m]].path, group, rects[m].page,
+                                     glm::vec4(origin, scale)});
+        }
+    }
+    std::ranges::sort(atlas.regions, {}, &AtlasData::Region::path);
+    return atlas;
+}
+
+TextureAtlas::TextureAtlas(const AtlasData& data) : regions_(data.regions) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (auto& group : data.groups) {
+        const TextureData& first = group.pages.front();
+        auto levels = GLsizei(first.mips.size() + 1);
+        TextureHandle& array = arrays_.emplace_back();
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array.reset_as_ref());
+        glTextureStorage3D(*array, levels, group.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+                           first.width, first.height, GLsizei(group.pages.size()));
+        glTextureParameteri(*array, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(*array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(*array, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(*array, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameterf(*array, GL_TEXTURE_MAX_ANISOTROPY, TextureOpts{}.anisotropy);
+        for (size_t layer = 0; layer < group.pages.size(); layer++) {
+            const TextureData& page = group.pages[layer];
+            glTextureSubImage3D(*array, 0, 0, 0, GLint(layer), page.width, page.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+            for (GLint level = 1; level < levels; level++) {
+                auto& mip = page.mips[level - 1];
+                glTextureSubImage3D(*array, level, 0, 0, GLint(layer), mip.width, mip.height,
+                                    1, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+            }
+        }
+    }
+}
+
+TextureAtlas TextureAtlas::from_materials(std::span<const std::shared_ptr<Material>> materials,
+                                          const AtlasOpts& opts) {
+    std::vector<AtlasSource> sources;
+    for (auto& material : materials) {
+        if (!material)
+            continue;
+        for (const Texture* texture :
+             {&material->diffuse_texture, &material->specular_texture,
+              &material->ambient_texture, &material->emissive_texture,
+              &material->ao_texture, &material->normal_texture, &material->orm_texture}) {
+            if (*texture && !texture->filename().empty())
+                sources.push_back({texture->filename(), is_srgb(texture->id())});
+        }
+    }
+    return TextureAtlas(build_atlas(sources, opts));
+}
+
+const TextureAtlas::Region* TextureAtlas::find(const fs::path& path) const {
+    auto it = std::ranges::lower_bound(regions_, path, {}, &Region::path);
+    if (it == regions_.end() || it->path != path)
+        return nullptr;
+    return &*it;
+}
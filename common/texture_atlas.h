@@ -0,0 +1,82 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "material.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+struct AtlasOpts {
+    int page_size = 2048;
+    // Texels of wrapped-around content around each texture; also bounds the mip count,
+    // since coarser levels would blend neighbours
+    int padding = 8;
+    // Larger textures are left out of the atlas
+    int max_texture_size = 1024;
+    bool flip = true;
+    // Decodes, copies and generates mips on this pool, or serially without one
+    ThreadPool* pool = nullptr;
+};
+
+struct AtlasSource {
+    std::filesystem::path path;
+    bool srgb = false;
+};
+
+// Packed atlas pages on the CPU, one list of RGBA pages per color space
+struct AtlasData {
+    struct Group {
+        bool srgb;
+        // page_size x page_size RGBA pages with their mips
+        std::vector<TextureData> pages;
+    };
+    // Where a source ended up: uv = rect.xy + fract(uv) * rect.zw on layer
+    struct Region {
+        std::filesystem::path path;
+        size_t group;
+        int layer;
+        glm::vec4 rect;
+    };
+
+    std::vector<Group> groups;
+    std::vector<Region> regions;
+};
+
+// Decodes sources on opts.pool and skyline-packs the ones no larger than
+// opts.max_texture_size into pages. Sources are deduplicated and sorted by path first,
+// so the same inputs always produce the same pages. No GL calls.
+AtlasData build_atlas(std::span<const AtlasSource> sources, const AtlasOpts& opts = {});
+
+// Atlas pages uploaded as one GL_TEXTURE_2D_ARRAY per group, looked up by the path of
+// the packed texture. Lets many small material textures share a few texture objects;
+// see MaterialTable.
+class TextureAtlas {
+  public:
+    using Region = AtlasData::Region;
+
+    TextureAtlas() = default;
+    explicit TextureAtlas(const AtlasData& data);
+
+    // Packs the textures of materials, by the files they were loaded from
+    static TextureAtlas from_materials(std::span<const std::shared_ptr<Material>> materials,
+                                       const AtlasOpts& opts = {});
+
+    // Region of the texture loaded from path, or nullptr if it isn't in the atlas
+    const Region* find(const std::filesystem::path& path) const;
+    GLuint array(size_t group) const { return arrays_[group].get(); }
+    size_t num_arrays() const { return arrays_.size(); }
+    size_t size() const { return regions_.size(); }
+
+  private:
+    std::vector<TextureHandle> arrays_;
+    std::vector<Region> regions_;
+};
+
+#endif // TEXTURE_ATLAS_H
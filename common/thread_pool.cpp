@@ -0,0 +1,99 @@
+#include "thread_pool.h"
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    num_threads = std::max<size_t>(num_threads, 1);
+    for (size_t i = 0; i < num_threads; i++)
+        queues_.push_back(std::make_unique<Queue>());
+    threads_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+        threads_.emplace_back([this, i](std::stop_token stop) { worker(i, stop); });
+}
+
+ThreadPool::~ThreadPool() {
+    for (auto& thread : threads_)
+        thread.request_stop();
+    // Join before the queues and condition variable go away
+    threads_.clear();
+}
+
+void ThreadPool::Queue::push_back(std::function<void()> task) {
+    if (count == tasks.size()) {
+        // Unwrap into a buffer twice the size
+        std::vector<std::function<void()>> grown(std::max<size_t>(2 * tasks.size(), 64));
+        for (size_t i = 0; i < count; i++)
+            grown[i] = std::move(tasks[(head + i) % tasks.size()]);
+        tasks = std::move(grown);
+        head = 0;
+    }
+    tasks[(head + count++) % tasks.size()] = std::move(task);
+}
+
+std::function<void()> ThreadPool::Queue::pop_back() {
+    return std::move(tasks[(head + --count) % tasks.size()]);
+}
+
+std::function<void()> ThreadPool::Queue::pop_front() {
+    std::function<void()> task = std::move(tasks[head]);
+    head = (head + 1) % tasks.size();
+    count--;
+    return task;
+}
+
+size_t ThreadPool::thread_index() const {
+    return current_pool == this ? current_index : size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t index = thread_index();
+    if (index == size())
+        index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard lock(queues_[index]->mutex);
+        queues_[index]->push_back(std::move(task));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::run_one(size_t self) {
+    std::function<void()> task;
+    // Newest task from our own deque first, it is most likely still in cache
+    if (self < queues_.size()) {
+        std::lock_guard lock(queues_[self]->mutex);
+        if (queues_[self]->count > 0)
+            task = queues_[self]->pop_back();
+    }
+    // Otherwise steal the oldest task of another worker
+    for (size_t i = 1; !task && i <= queues_.size(); i++) {
+        auto& victim = *queues_[(self + i) % queues_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (victim.count > 0)
+            task = victim.pop_front();
+    }
+    if (!task)
+        return false;
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+void ThreadPool::worker(size_t index, std::stop_token stop) {
+    current_pool = this;
+    current_index = index;
+    while (!stop.stop_requested()) {
+        if (run_one(index))
+            continue;
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, stop, [&] { return pending_.load(std::memory_order_acquire) > 0; });
+    }
+}
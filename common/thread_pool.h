@@ -0,0 +1,128 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing thread pool. Each worker owns a task deque: it pops its own tasks from
+// the back and steals from the front of the others when it runs dry. Threads waiting
+// on parallel_for run queued tasks instead of blocking, so pool tasks may nest.
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+    // Index of the calling worker in [0, size()), or size() for threads outside the
+    // pool. Use it to pick per-thread storage.
+    size_t thread_index() const;
+
+    // Queues a task on the calling worker's deque, or round robin from outside
+    void submit(std::function<void()> task);
+
+    // Runs f asynchronously on the pool
+    template <typename F>
+    auto async(F&& f) -> std::future<std::invoke_result_t<F>> {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+            std::forward<F>(f));
+        auto future = task->get_future();
+        submit([task] { (*task)(); });
+        return future;
+    }
+
+    // Calls f(i) for every i in [0, n), in chunks of chunk_size indices spread over the
+    // pool. The caller works on chunks too and returns once all have run. If f throws,
+    // chunks not yet started are skipped and the first exception is rethrown once the
+    // running ones have finished.
+    template <typename F>
+    void parallel_for(size_t n, F&& f, size_t chunk_size = 1) {
+        chunk_size = std::max<size_t>(chunk_size, 1);
+        size_t num_chunks = (n + chunk_size - 1) / chunk_size;
+        if (num_chunks <= 1 || threads_.empty()) {
+            for (size_t i = 0; i < n; i++) f(i);
+            return;
+        }
+        // Tasks capture only a pointer and an index, small enough for std::function's
+        // inline storage, so queuing them doesn't allocate
+        struct Job {
+            F& f;
+            size_t n, chunk_size;
+            std::atomic<size_t> remaining;
+            std::atomic<bool> failed = false;
+            std::exception_ptr error = nullptr;
+            void run(size_t begin) {
+                try {
+                    if (!failed.load(std::memory_order_relaxed)) {
+                        for (size_t i = begin; i < std::min(n, begin + chunk_size); i++)
+                            f(i);
+                    }
+                } catch (...) {
+                    if (!failed.exchange(true))
+                        error = std::current_exception();
+                }
+                // Tasks still reference the job, so every chunk must count down
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        } job{f, n, chunk_size, num_chunks};
+        for (size_t c = 1; c < num_chunks; c++) {
+            submit([&job, begin = c * chunk_size] { job.run(begin); });
+        }
+        job.run(0);
+        while (job.remaining.load(std::memory_order_acquire)) {
+            if (!run_one(thread_index()))
+                std::this_thread::yield();
+        }
+        if (job.error)
+            std::rethrow_exception(job.error);
+    }
+
+  private:
+    // Ring buffer of tasks. It only ever grows, so once it has held a frame's worth of
+    // tasks, queuing them no longer allocates (a std::deque allocates and frees blocks
+    // as tasks pass through).
+    struct Queue {
+        std::mutex mutex;
+        std::vector<std::function<void()>> tasks;
+        size_t head = 0, count = 0;
+
+        void push_back(std::function<void()> task);
+        std::function<void()> pop_back();
+        std::function<void()> pop_front();
+    };
+
+    void worker(size_t index, std::stop_token stop);
+    // Runs one task from queue self (if it is a worker) or stolen from another queue
+    bool run_one(size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::jthread> threads_;
+    std::atomic<size_t> next_queue_ = 0;
+    std::atomic<size_t> pending_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable_any wake_;
+};
+
+// pool->parallel_for(n, f, chunk_size), or a plain loop on the calling thread without a
+// pool, for functions that take an optional pool
+template <typename F>
+void parallel_for(ThreadPool* pool, size_t n, F&& f, size_t chunk_size = 1) {
+    if (pool) {
+        pool->parallel_for(n, f, chunk_size);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) f(i);
+}
+
+#endif // THREAD_POOL_H
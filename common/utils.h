@@ -2,8 +2,10 @@
 #define UTILS_H
 
 #include <array>
+#include <memory>
 #include <optional>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace util {
@@ -41,6 +43,32 @@ constexpr auto array_cat(Arrays&&... arrays) {
         std::tuple_cat(std::forward<Arrays>(arrays)...));
 }
 
+// Non-owning reference to a callable, like C++26 std::function_ref. Unlike
+// std::function it never allocates, so it suits per-frame callbacks. The callable must
+// outlive the reference.
+template <typename Signature>
+class function_ref;
+
+template <typename R, typename... Args>
+class function_ref<R(Args...)> {
+  public:
+    template <typename F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, function_ref> &&
+                 std::is_invocable_r_v<R, F&, Args...>)
+    function_ref(F&& f)
+        : obj_(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+          call_([](void* obj, Args... args) -> R {
+              return (*static_cast<std::remove_reference_t<F>*>(obj))(
+                  std::forward<Args>(args)...);
+          }) {}
+
+    R operator()(Args... args) const { return call_(obj_, std::forward<Args>(args)...); }
+
+  private:
+    void* obj_;
+    R (*call_)(void*, Args...);
+};
+
 } // namespace util
 
 #endif // UTILS_H
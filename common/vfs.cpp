@@ -0,0 +1,113 @@
+#include "vfs.h"
+
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "errutils.h"
+#include "u8tils.h"
+
+namespace fs = std::filesystem;
+
+FileData::FileData(MappedFile file) : file_(std::move(file)), bytes_(file_.bytes()) {}
+
+FileData::FileData(std::vector<std::byte> buffer)
+    : buffer_(std::move(buffer)), bytes_(buffer_) {}
+
+FileData::FileData(std::shared_ptr<const PackFile> pack, const PackEntry& entry)
+    : pack_(std::move(pack)) {
+    if (entry.codec == PackCodec::Stored) {
+        bytes_ = pack_->view(entry);
+    } else {
+        buffer_ = pack_->read(entry);
+        bytes_ = buffer_;
+        // The decompressed copy doesn't need the pack
+        pack_.reset();
+    }
+}
+
+namespace vfs {
+
+namespace {
+
+struct Mount {
+    std::shared_ptr<const PackFile> pack;
+    fs::path root;
+};
+
+std::mutex mounts_mutex;
+std::vector<Mount> mounts;
+
+struct Found {
+    std::shared_ptr<const PackFile> pack;
+    const PackEntry* entry;
+};
+
+std::optional<Found> find(const fs::path& path) {
+    fs::path normal = path.lexically_normal();
+    std::lock_guard lock(mounts_mutex);
+    for (auto it = mounts.rbegin(); it != mounts.rend(); ++it) {
+        fs::path relative = normal.lexically_relative(it->root);
+        if (relative.empty() || *relative.begin() == "..")
+            continue;
+        // Pack names are UTF-8 with '/' separators on every platform
+        std::string name = u8::to_string(relative.generic_u8string());
+        if (const PackEntry* entry = it->pack->find(name))
+            return Found{it->pack, entry};
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+void mount(std::shared_ptr<const PackFile> pack, const fs::path& root) {
+    std::lock_guard lock(mounts_mutex);
+    mounts.push_back({std::move(pack), root.lexically_normal()});
+}
+
+bool mount_if_exists(const fs::path& pack_path, const fs::path& root, ThreadPool* pool) {
+    std::error_code ec;
+    if (!fs::is_regular_file(pack_path, ec))
+        return false;
+    mount(std::make_shared<const PackFile>(pack_path, pool), root);
+    return true;
+}
+
+void unmount_all() {
+    std::lock_guard lock(mounts_mutex);
+    mounts.clear();
+}
+
+bool exists(const fs::path& path) {
+    std::error_code ec;
+    return find(path) || fs::is_regular_file(path, ec);
+}
+
+FileData read(const fs::path& path, MappedFile::Access access) {
+    if (auto found = find(path))
+        return FileData(std::move(found->pack), *found->entry);
+    return FileData(MappedFile(path, access));
+}
+
+FileData read_copy(const fs::path& path) {
+    // Packs are replaced by renaming a new file, never rewritten in place
+    if (auto found = find(path))
+        return FileData(std::move(found->pack), *found->entry);
+    std::ifstream file(path, std::ios::binary);
+    err::check_errno(file.is_open(), "failed to open {}: {}", path.string());
+    // Read to the end instead of trusting the size, which changes under a rewrite
+    std::vector<std::byte> buffer;
+    constexpr size_t CHUNK = 64 * 1024;
+    do {
+        size_t size = buffer.size();
+        buffer.resize(size + CHUNK);
+        file.read(reinterpret_cast<char*>(buffer.data() + size), CHUNK);
+        buffer.resize(size + size_t(file.gcount()));
+    } while (file);
+    return FileData(std::move(buffer));
+}
+
+} // namespace vfs
@@ -0,0 +1,61 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+#include "pack_file.h"
+#include "thread_pool.h"
+
+// Contents of a file read through the vfs: a mapped loose file, a view into a mapped
+// pack, or a decompressed pack entry. Whichever it is, it stays alive with this.
+class FileData {
+  public:
+    FileData() = default;
+    explicit FileData(MappedFile file);
+    explicit FileData(std::vector<std::byte> buffer);
+    FileData(std::shared_ptr<const PackFile> pack, const PackEntry& entry);
+
+    const std::byte* data() const { return bytes_.data(); }
+    size_t size() const { return bytes_.size(); }
+    std::span<const std::byte> bytes() const { return bytes_; }
+    std::string_view text() const {
+        return {reinterpret_cast<const char*>(bytes_.data()), bytes_.size()};
+    }
+
+  private:
+    MappedFile file_;
+    std::shared_ptr<const PackFile> pack_;
+    std::vector<std::byte> buffer_;
+    std::span<const std::byte> bytes_;
+};
+
+// Resolves asset paths against mounted packs before the file system, so a shipped build
+// opens one pack instead of every loose file. Paths stay ordinary file system paths;
+// those under a mount's root are looked up in its pack. Safe to use from any thread.
+namespace vfs {
+
+// Serves files under root from pack. Later mounts take precedence.
+void mount(std::shared_ptr<const PackFile> pack, const std::filesystem::path& root);
+// Mounts the pack at pack_path if there is one. pool is passed on to the PackFile.
+bool mount_if_exists(const std::filesystem::path& pack_path,
+                     const std::filesystem::path& root, ThreadPool* pool = nullptr);
+void unmount_all();
+
+bool exists(const std::filesystem::path& path);
+// The file from the first pack that has it, or else from disk
+FileData read(const std::filesystem::path& path,
+              MappedFile::Access access = MappedFile::Access::Sequential);
+// Like read, but loose files are copied into memory instead of mapped. For files that
+// may be rewritten in place while they are read, e.g. shader sources open in an
+// editor: truncating a mapped file faults the reader.
+FileData read_copy(const std::filesystem::path& path);
+
+} // namespace vfs
+
+#endif // VFS_H
@@ -0,0 +1,307 @@
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "errutils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'G', 'V', 'T'};
+constexpr uint32_t VERSION = 1;
+
+// On-disk header, native byte order
+struct PageFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height, page_size, border, levels, srgb;
+};
+
+struct LevelView {
+    int width, height, channels;
+    const uint8_t* pixels;
+
+    // RGBA texel with coordinates clamped to the level
+    void fetch(int x, int y, uint8_t* out) const {
+        x = std::clamp(x, 0, width - 1);
+        y = std::clamp(y, 0, height - 1);
+        const uint8_t* p = pixels + (size_t(y) * width + x) * channels;
+        bool gray = channels < 3;
+        out[0] = p[0];
+        out[1] = gray ? p[0] : p[1];
+        out[2] = gray ? p[0] : p[2];
+        out[3] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+    }
+};
+
+// Page table entry: slot coordinates and the level actually resident there
+uint32_t table_entry(uint32_t slot_x, uint32_t slot_y, uint32_t level) {
+    return slot_x | slot_y << 8 | level << 16;
+}
+
+} // namespace
+
+PageLayout PageLayout::for_image(uint32_t width, uint32_t height, uint32_t page_size,
+                                 uint32_t border, bool srgb) {
+    PageLayout layout{width, height, page_size, border, 1, srgb};
+    while (glm::any(glm::greaterThan(layout.level_pages(layout.levels - 1), glm::uvec2(1))))
+        ++layout.levels;
+    return layout;
+}
+
+uint32_t PageLayout::level_offset(uint32_t level) const {
+    uint32_t offset = 0;
+    for (uint32_t l = 0; l < level; l++) {
+        glm::uvec2 pages = level_pages(l);
+        offset += pages.x * pages.y;
+    }
+    return offset;
+}
+
+PageId PageLayout::page_at(uint32_t index) const {
+    uint32_t level = 0;
+    for (; level + 1 < levels && index >= level_offset(level + 1); level++) {}
+    uint32_t local = index - level_offset(level);
+    uint32_t pages_x = level_pages(level).x;
+    return {level, local % pages_x, local / pages_x};
+}
+
+void build_page_file(const TextureData& data, const fs::path& path, ThreadPool& pool,
+                     uint32_t page_size, uint32_t border) {
+    auto layout = PageLayout::for_image(uint32_t(data.width), uint32_t(data.height),
+                                        page_size, border, data.srgb);
+    err::check(layout.levels <= VirtualTexture::MAX_LEVELS &&
+                   data.mips.size() + 1 >= layout.levels,
+               "{}: need {} mip levels for a page file, have {}", path.string(),
+               layout.levels, data.mips.size() + 1);
+
+    std::ofstream file(path, std::ios::binary);
+    err::check(file.is_open(), "failed to create page file {}", path.string());
+    PageFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = layout.width;
+    header.height = layout.height;
+    header.page_size = page_size;
+    header.border = border;
+    header.levels = layout.levels;
+    header.srgb = layout.srgb;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // One row of pages at a time keeps memory bounded for huge levels
+    int stride = int(layout.stride());
+    std::vector<uint8_t> row;
+    for (uint32_t level = 0; level < layout.levels; level++) {
+        LevelView src = level == 0 ? LevelView{data.width, data.height, data.channels,
+                                               data.pixels.data()}
+                                   : LevelView{data.mips[level - 1].width,
+                                               data.mips[level - 1].height, data.channels,
+                                               data.mips[level - 1].pixels.data()};
+        glm::uvec2 pages = layout.level_pages(level);
+        row.resize(pages.x * layout.page_bytes());
+        for (uint32_t py = 0; py < pages.y; py++) {
+            pool.parallel_for(size_t(pages.x), [&](size_t px) {
+                uint8_t* out = &row[px * layout.page_bytes()];
+                int x0 = int(px * page_size) - int(border);
+                int y0 = int(py * page_size) - int(border);
+                for (int y = 0; y < stride; y++) {
+                    for (int x = 0; x < stride; x++)
+                        src.fetch(x0 + x, y0 + y, out + (size_t(y) * stride + x) * 4);
+                }
+            });
+            file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+        }
+    }
+    err::check(file.good(), "failed to write page file {}", path.string());
+}
+
+PageFile::PageFile(const fs::path& path) : file_(path, MappedFile::Access::Random) {
+    PageFileHeader header;
+    err::check(file_.size() >= sizeof(header), "{} is not a page file", path.string());
+    std::memcpy(&header, file_.data(), sizeof(header));
+    err::check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                   header.version == VERSION,
+               "{} is not a page file", path.string());
+    layout_ = PageLayout::for_image(header.width, header.height, header.page_size,
+                                    header.border, header.srgb != 0);
+    err::check(layout_.levels == header.levels, "{}: inconsistent page file header",
+               path.string());
+    data_offset_ = sizeof(header);
+    err::check(file_.size() >= data_offset_ + layout_.num_pages() * layout_.page_bytes(),
+               "{}: truncated page file", path.string());
+}
+
+std::vector<uint8_t> PageFile::read(PageId page) const {
+    // Copying out of the mapping faults the pages in on the calling thread, so reads
+    // on the pool keep the disk off the render thread
+    auto bytes = file_.bytes(data_offset_ + layout_.page_index(page) * layout_.page_bytes(),
+                             layout_.page_bytes());
+    auto* begin = reinterpret_cast<const uint8_t*>(bytes.data());
+    return std::vector<uint8_t>(begin, begin + bytes.size());
+}
+
+VirtualTexture::VirtualTexture(const fs::path& page_file, ThreadPool& pool,
+                               uint32_t slots_per_side)
+    : file_(page_file),
+      pool_(pool),
+      slots_per_side_(slots_per_side),
+      cache_(slots_per_side * slots_per_side) {
+    const PageLayout& layout = file_.layout();
+    err::check(slots_per_side > 0 && slots_per_side <= 256,
+               "virtual texture needs 1 to 256 slots per side, got {}", slots_per_side);
+    err::check(layout.levels <= MAX_LEVELS, "{}: too many levels", page_file.string());
+
+    GLsizei size = GLsizei(slots_per_side * layout.stride());
+    glCreateTextures(GL_TEXTURE_2D, 1, &physical_.reset_as_ref());
+    glTextureStorage2D(*physical_, 1, layout.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, size, size);
+    glTextureParameteri(*physical_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(*physical_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*physical_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(*physical_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    size_t table_size = layout.num_pages() * sizeof(uint32_t);
+    table_.resize(layout.num_pages());
+    feedback_data_.resize(layout.num_pages());
+    glCreateBuffers(1, &page_table_.reset_as_ref());
+    glNamedBufferStorage(*page_table_, table_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &feedback_.reset_as_ref());
+    glNamedBufferStorage(*feedback_, table_size, nullptr, 0);
+    GLuint zero = 0;
+    glClearNamedBufferData(*feedback_, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    for (auto& buffer : readback_) {
+        glCreateBuffers(1, &buffer.reset_as_ref());
+        glNamedBufferStorage(*buffer, table_size, nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    // The single coarsest page is the fallback for everything
+    PageId root{layout.levels - 1, 0, 0};
+    auto placement = cache_.insert(root, true);
+    upload(placement->slot, file_.read(root));
+    update_page_table();
+}
+
+VirtualTexture::~VirtualTexture() {
+    // Reads in flight reference file_
+    for (auto& [key, future] : loading_)
+        future.wait();
+}
+
+void VirtualTexture::update() {
+    using namespace std::chrono_literals;
+
+    cache_.begin_frame();
+    read_feedback();
+
+    bool changed = false;
+    size_t uploads = 0;
+    for (auto it = loading_.begin(); it != loading_.end() && uploads < MAX_UPLOADS_PER_FRAME;) {
+        if (it->second.wait_for(0s) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        std::vector<uint8_t> pixels = it->second.get();
+        // Fails when every slot is in use this frame; the page is requested again
+        // while it stays visible
+        if (auto placement = cache_.insert(PageId::from_key(it->first))) {
+            upload(placement->slot, pixels);
+            changed = true;
+            ++uploaded_;
+            ++uploads;
+        } else {
+            ++dropped_;
+        }
+        it = loading_.erase(it);
+    }
+    if (changed)
+        update_page_table();
+}
+
+void VirtualTexture::read_feedback() {
+    size_t oldest = next_readback_;
+    if (!fences_[oldest])
+        return;
+    GLenum status = glClientWaitSync(*fences_[oldest], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+    glGetNamedBufferSubData(*readback_[oldest], 0,
+                            GLsizeiptr(feedback_data_.size() * sizeof(uint32_t)),
+                            feedback_data_.data());
+    fences_[oldest].reset();
+
+    const PageLayout& layout = file_.layout();
+    std::vector<PageId> requested;
+    for (uint32_t i = 0; i < feedback_data_.size(); i++) {
+        if (feedback_data_[i])
+            requested.push_back(layout.page_at(i));
+    }
+    for (PageId page : cache_.touch(requested)) {
+        if (loading_.size() >= MAX_LOADS_IN_FLIGHT)
+            break;
+        if (!loading_.contains(page.key()))
+            loading_.emplace(page.key(), pool_.async([this, page] { return file_.read(page); }));
+    }
+}
+
+void VirtualTexture::upload(uint32_t slot, const std::vector<uint8_t>& pixels) {
+    GLsizei stride = GLsizei(file_.layout().stride());
+    GLint x = GLint(slot % slots_per_side_) * stride;
+    GLint y = GLint(slot / slots_per_side_) * stride;
+    glTextureSubImage2D(*physical_, 0, x, y, stride, stride, GL_RGBA, GL_UNSIGNED_BYTE,
+                        pixels.data());
+}
+
+void VirtualTexture::update_page_table() {
+    // Coarsest level first, so a missing page can take its parent's entry
+    const PageLayout& layout = file_.layout();
+    for (uint32_t level = layout.levels; level-- > 0;) {
+        glm::uvec2 pages = layout.level_pages(level);
+        for (uint32_t y = 0; y < pages.y; y++) {
+            for (uint32_t x = 0; x < pages.x; x++) {
+                PageId page{level, x, y};
+                uint32_t& entry = table_[layout.page_index(page)];
+                if (auto slot = cache_.slot(page)) {
+                    entry = table_entry(*slot % slots_per_side_, *slot / slots_per_side_,
+                                        level);
+                } else {
+                    glm::uvec2 parent_pages = layout.level_pages(level + 1);
+                    PageId parent{level + 1, std::min(x / 2, parent_pages.x - 1),
+                                  std::min(y / 2, parent_pages.y - 1)};
+                    entry = table_[layout.page_index(parent)];
+                }
+            }
+        }
+    }
+    glNamedBufferSubData(*page_table_, 0, GLsizeiptr(table_.size() * sizeof(uint32_t)),
+                         table_.data());
+}
+
+void VirtualTexture::bind(const Shader& shader, GLuint unit) const {
+    const PageLayout& layout = file_.layout();
+    glBindTextureUnit(unit, *physical_);
+    shader.set_int("vtPhysical", int(unit));
+    shader.set_uvec2("vtSize", {layout.width, layout.height});
+    shader.set_uint("vtPageSize", layout.page_size);
+    shader.set_uint("vtBorder", layout.border);
+    shader.set_int("vtLevels", int(layout.levels));
+    for (uint32_t level = 0; level < layout.levels; level++) {
+        UniformName name("vtLevelOffset[{}]", level);
+        shader.set_uint(name(""), layout.level_offset(level));
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PAGE_TABLE_BINDING, *page_table_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FEEDBACK_BINDING, *feedback_);
+}
+
+void VirtualTexture::end_frame() {
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    size_t i = next_readback_;
+    GLsizeiptr size = GLsizeiptr(feedback_data_.size() * sizeof(uint32_t));
+    glCopyNamedBufferSubData(*feedback_, *readback_[i], 0, 0, size);
+    fences_[i].reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    next_readback_ = (next_readback_ + 1) % FEEDBACK_FRAMES;
+    GLuint zero = 0;
+    glClearNamedBufferData(*feedback_, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+}
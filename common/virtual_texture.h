@@ -0,0 +1,136 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_resources.h"
+#include "mapped_file.h"
+#include "page_cache.h"
+#include "query.h"
+#include "shader.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// How an image is split into square pages. Every level down to the first that fits
+// in a single page is stored; pages carry a border of neighbouring texels (clamped at
+// the image edge) so bilinear filtering never reads across slots.
+struct PageLayout {
+    uint32_t width, height, page_size, border, levels;
+    bool srgb;
+
+    static PageLayout for_image(uint32_t width, uint32_t height, uint32_t page_size,
+                                uint32_t border, bool srgb);
+
+    glm::uvec2 level_size(uint32_t level) const {
+        return glm::max(glm::uvec2(width, height) >> level, 1u);
+    }
+    glm::uvec2 level_pages(uint32_t level) const {
+        return (level_size(level) + page_size - 1u) / page_size;
+    }
+    // Index of the first page of level among the pages of all levels
+    uint32_t level_offset(uint32_t level) const;
+    uint32_t num_pages() const { return level_offset(levels); }
+    uint32_t page_index(PageId page) const {
+        return level_offset(page.level) + page.y * level_pages(page.level).x + page.x;
+    }
+    PageId page_at(uint32_t index) const;
+
+    // Texels per side of a stored page, border included
+    uint32_t stride() const { return page_size + 2 * border; }
+    size_t page_bytes() const { return size_t(stride()) * stride() * 4; }
+};
+
+// Tiles an image and its mips (data.mips must reach the single-page level) into a
+// page file of RGBA8 pages, level by level in row-major order. Each row of pages is
+// filled on the pool.
+void build_page_file(const TextureData& data, const std::filesystem::path& path,
+                     ThreadPool& pool, uint32_t page_size = 128, uint32_t border = 4);
+
+// Read side of a page file, mapped into memory. read() may be called from any thread.
+class PageFile {
+  public:
+    explicit PageFile(const std::filesystem::path& path);
+
+    const PageLayout& layout() const { return layout_; }
+    std::vector<uint8_t> read(PageId page) const;
+
+  private:
+    MappedFile file_;
+    PageLayout layout_;
+    size_t data_offset_;
+};
+
+// Texture streamed from a page file into a fixed-size physical page texture, so its
+// memory cost depends on the cache size rather than the image size. Shaders sample it
+// through virtual_texture.glsl, which looks up the page table and records which pages
+// it wanted in a feedback buffer. That buffer is read back a few frames later, and
+// missing pages are read on the thread pool and uploaded as they arrive; until then
+// the nearest resident coarser level is used. The coarsest level is always resident.
+//
+// Per frame: update() before drawing, bind() for each program, end_frame() after.
+class VirtualTexture {
+  public:
+    static constexpr GLuint PAGE_TABLE_BINDING = 5;
+    static constexpr GLuint FEEDBACK_BINDING = 6;
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+    struct Stats {
+        size_t resident, loading, uploaded, dropped;
+    };
+
+    // slots_per_side^2 pages are kept resident (at most 256 per side)
+    VirtualTexture(const std::filesystem::path& page_file, ThreadPool& pool,
+                   uint32_t slots_per_side = 16);
+    ~VirtualTexture();
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    // Consumes finished feedback, queues page reads and uploads pages that arrived
+    void update();
+    // Binds the physical texture to unit and sets the sampling uniforms
+    void bind(const Shader& shader, GLuint unit) const;
+    // Captures this frame's feedback for readback
+    void end_frame();
+
+    const PageLayout& layout() const { return file_.layout(); }
+    GLuint physical_texture() const { return physical_.get(); }
+    Stats stats() const {
+        return {cache_.size(), loading_.size(), uploaded_, dropped_};
+    }
+
+  private:
+    static constexpr size_t FEEDBACK_FRAMES = 3;
+    static constexpr size_t MAX_LOADS_IN_FLIGHT = 32;
+    static constexpr size_t MAX_UPLOADS_PER_FRAME = 16;
+
+    void read_feedback();
+    void upload(uint32_t slot, const std::vector<uint8_t>& pixels);
+    void update_page_table();
+
+    PageFile file_;
+    ThreadPool& pool_;
+    uint32_t slots_per_side_;
+    PageCache cache_;
+
+    TextureHandle physical_;
+    BufferHandle page_table_, feedback_;
+    std::vector<uint32_t> table_;
+
+    std::array<BufferHandle, FEEDBACK_FRAMES> readback_;
+    std::array<SyncHandle, FEEDBACK_FRAMES> fences_;
+    size_t next_readback_ = 0;
+    std::vector<uint32_t> feedback_data_;
+
+    std::unordered_map<uint32_t, std::future<std::vector<uint8_t>>> loading_;
+    size_t uploaded_ = 0, dropped_ = 0;
+};
+
+#endif // VIRTUAL_TEXTURE_H
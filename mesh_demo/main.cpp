@@ -21,6 +21,9 @@
 #include "common/raii.h"
 #include "common/shader.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
+#include "common/vfs.h"
+#include "common/virtual_texture.h"
 
 namespace fs = std::filesystem;
 
@@ -33,18 +36,28 @@ const float FOV = glm::radians(45.f);
 
 const glm::vec4 BG_COLOR = glm::convertSRGBToLinear(glm::vec4{0.8f, 0.8f, 0.8f, 1.0f});
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+bool use_virtual = false;
+
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
+                  int /*mods*/) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    if (key == GLFW_KEY_V && action == GLFW_PRESS)
+        use_virtual = !use_virtual;
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     if (width && height)
         glViewport(0, 0, width, height);
 }
 
 void run(const fs::path& exe_path) {
     fs::path root = exe_path.parent_path();
+    ThreadPool pool;
+    // Built by the resources_pack target; loose files are used without it. Compressed
+    // entries are decompressed on the pool, so unmount before it goes away.
+    vfs::mount_if_exists(root / "resources.pack", root / "resources", &pool);
+    ScopeGuardFn<vfs::unmount_all> unmount;
 
     err::check_glfw(glfwInit(), "failed to init GLFW: {}");
     ScopeGuardFn<glfwTerminate> guard;
@@ -68,7 +81,18 @@ void run(const fs::path& exe_path) {
 
     Shader shader = Shader::load(root / "mesh_demo/resources/shaders/shader.vs",
                                  root / "mesh_demo/resources/shaders/shader.fs");
-    Texture texture(root / "resources/textures/earth_sphere10k.jpg", {.srgb = true});
+    Shader virtual_shader = Shader::load(root / "mesh_demo/resources/shaders/shader.vs",
+                                         root / "mesh_demo/resources/shaders/virtual.fs");
+    fs::path texture_path = root / "resources/textures/earth_sphere10k.jpg";
+    Texture texture(texture_path, {.srgb = true});
+
+    // The page file is built once next to the executable
+    fs::path page_file = root / "earth_sphere10k.pages";
+    if (!fs::exists(page_file)) {
+        build_page_file(load_texture_data(texture_path, {.srgb = true, .channels = 4}),
+                        page_file, pool);
+    }
+    VirtualTexture virtual_texture(page_file, pool);
 
     // Vertex vertices[] = {
     //     {{-0.5f, -0.5f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f}},
@@ -79,13 +103,19 @@ void run(const fs::path& exe_path) {
     // unsigned int indices[] = {0, 1, 2, 2, 3, 0};
     // Mesh mesh {vertices, indices};
 
-    Mesh mesh = make_sphere(16, 32);
-
-    shader.use();
-    texture.bind(0);
-    shader.set_int("tex", 0);
+    Mesh mesh = make_sphere<16, 32>();
 
     while (!glfwWindowShouldClose(window)) {
+        virtual_texture.update();
+        const Shader& active = use_virtual ? virtual_shader : shader;
+        active.use();
+        if (use_virtual) {
+            virtual_texture.bind(active, 0);
+        } else {
+            texture.bind(0);
+            active.set_int("tex", 0);
+        }
+
         glClearColor(BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, BG_COLOR.a);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -93,15 +123,17 @@ void run(const fs::path& exe_path) {
         float aspect = width / height;
         glm::mat4 projection = glm::perspective(FOV, aspect, ZNEAR, ZFAR);
         // glm::mat4 projection = glm::ortho(-aspect, aspect, -1.f, 1.f, ZNEAR, ZFAR);
-        shader.set_mat4("projection", projection);
+        active.set_mat4("projection", projection);
 
         glm::mat4 modelview{1};
         modelview = glm::translate(modelview, glm::vec3(0, 0, -3));
         float angle = float(glfwGetTime()) * glm::pi<float>() / 4.f;
         modelview = glm::rotate(modelview, angle, glm::vec3(0, 1, 0));
-        shader.set_mat4("modelview", modelview);
+        active.set_mat4("modelview", modelview);
 
         mesh.draw();
+        if (use_virtual)
+            virtual_texture.end_frame();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
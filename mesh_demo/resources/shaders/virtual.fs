@@ -0,0 +1,10 @@
+#version 450
+
+#include "../../../resources/shaders/virtual_texture.glsl"
+
+in vec2 v_tex_coords;
+out vec4 frag_color;
+
+void main() {
+    frag_color = SampleVirtual(v_tex_coords);
+}
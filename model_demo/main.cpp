@@ -1,5 +1,11 @@
+#include <array>
+#include <cmath>
 #include <filesystem>
+#include <format>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <print>
 #include <stdexcept>
 #include <string>
@@ -14,15 +20,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "common/assimp_loader.h"
+#include "common/clustered_lights.h"
 #include "common/compat.h"
+#include "common/deferred.h"
+#include "common/dynamic_buffer.h"
+#include "common/depth_prepass.h"
+#include "common/environment_map.h"
 #include "common/errutils.h"
 #include "common/glutils.h"
 #include "common/lights.h"
+#include "common/material_table.h"
 #include "common/mesh.h"
+#include "common/mesh_batch.h"
 #include "common/model.h"
+#include "common/occlusion_culler.h"
+#include "common/primitives.h"
+#include "common/query.h"
 #include "common/raii.h"
+#include "common/render_queue.h"
+#include "common/resources.h"
 #include "common/shader.h"
+#include "common/shader_reloader.h"
+#include "common/shader_variants.h"
+#include "common/shadow_map.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
+#include "common/vfs.h"
 
 namespace fs = std::filesystem;
 
@@ -35,18 +58,56 @@ const float FOV = glm::radians(45.f);
 
 const glm::vec4 BG_COLOR = glm::convertSRGBToLinear(glm::vec4{0.8f, 0.8f, 0.8f, 1.0f});
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+// Toggled with tab
+RenderPath render_path = RenderPath::Forward;
+// Toggled with P, O, C, M and H
+bool use_prepass = false;
+bool show_overdraw = false;
+bool use_culling = false;
+bool show_crowd = false;
+bool use_shadows = true;
+
+// Instances drawn in crowd mode
+const int CROWD_SIZE = 24;
+// Coloured point lights circling the model in the forward path
+const int NUM_POINT_LIGHTS = 12;
+// Past the material table's texture arrays
+const GLuint SHADOW_UNIT = 15;
+// And the next unit for the BRDF LUT
+const GLuint ENVIRONMENT_UNIT = 13;
+
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
+                  int /*mods*/) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
+        render_path = render_path == RenderPath::Forward ? RenderPath::Deferred
+                                                         : RenderPath::Forward;
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        use_prepass = !use_prepass;
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        show_overdraw = !show_overdraw;
+    if (key == GLFW_KEY_C && action == GLFW_PRESS)
+        use_culling = !use_culling;
+    if (key == GLFW_KEY_M && action == GLFW_PRESS)
+        show_crowd = !show_crowd;
+    if (key == GLFW_KEY_H && action == GLFW_PRESS)
+        use_shadows = !use_shadows;
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     if (width && height)
         glViewport(0, 0, width, height);
 }
 
 void run(const fs::path& exe_path) {
     fs::path root = exe_path.parent_path();
+    // Crowd mode records frame N + 1 on the pool while frame N is submitted
+    ThreadPool pool;
+    // Built by the resources_pack target; loose files are used without it. Compressed
+    // entries are decompressed on the pool, so unmount before it goes away.
+    vfs::mount_if_exists(root / "resources.pack", root / "resources", &pool);
+    ScopeGuardFn<vfs::unmount_all> unmount;
 
     err::check_glfw(glfwInit(), "failed to init GLFW: {}");
     ScopeGuardFn<glfwTerminate> guard;
@@ -68,8 +129,70 @@ void run(const fs::path& exe_path) {
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
 
-    auto shader = Shader::load(root / "resources/shaders/shader.vs",
-                               root / "resources/shaders/shader.fs");
+    DirLight lights[] = {{.direction = {-1, -1, -1}, .shadow = {.max_distance = 30.f}}};
+    ShaderReloader reloader;
+    ShaderDefines light_defines{{"NUM_DIR_LIGHTS", std::to_string(std::size(lights))},
+                                {"NUM_POINT_LIGHTS", "0"},
+                                {"NUM_SPOT_LIGHTS", "0"}};
+    // Ambient light from an environment image if there is one, baked once and cached
+    // next to the executable
+    std::optional<EnvironmentLighting> environment;
+    if (fs::path hdr = root / "resources/textures/environment.hdr"; vfs::exists(hdr)) {
+        environment.emplace(load_environment(hdr, root / "environment.ibl", pool),
+                            load_brdf_lut(root / "brdf_lut.bin", pool));
+        light_defines.append_range(EnvironmentLighting::defines());
+    }
+    // The forward path also shades with point lights, assigned to clusters on the pool
+    ClusteredLights clustered(pool);
+    std::vector<PointLight> point_lights;
+    const glm::vec3 light_colors[] = {{1, 0.2f, 0.1f}, {0.2f, 1, 0.3f}, {0.2f, 0.4f, 1}};
+    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
+        float a = 2 * glm::pi<float>() * float(i) / NUM_POINT_LIGHTS;
+        glm::vec3 position{1.5f * std::cos(a), 0.5f, -5 + 1.5f * std::sin(a)};
+        glm::vec3 color = light_colors[i % std::size(light_colors)];
+        point_lights.push_back({.position = position,
+                                .linear = 0.7f,
+                                .quadratic = 1.8f,
+                                .diffuse = color,
+                                .specular = color});
+    }
+    clustered.set_lights(point_lights, {});
+    // A small glowing sphere marks each light. They live in the resource pools and are
+    // drawn from there.
+    Resources resources;
+    Resources::Imported light_markers;
+    {
+        std::vector<std::shared_ptr<Mesh>> meshes;
+        std::vector<std::shared_ptr<Material>> marker_materials;
+        MeshSize size = sphere_size(8, 16);
+        std::vector<Vertex> vertices(size.vertices);
+        std::vector<unsigned int> indices(size.indices);
+        for (auto& light : point_lights) {
+            auto material = std::make_shared<Material>();
+            material->diffuse_color = glm::vec3(0);
+            material->specular_color = glm::vec3(0);
+            material->emissive_color = light.diffuse;
+            material->update_features();
+            write_sphere(8, 16, vertices, indices);
+            for (auto& v : vertices)
+                v.position = light.position + 0.05f * v.position;
+            meshes.push_back(std::make_shared<Mesh>(vertices, indices, material));
+            marker_materials.push_back(std::move(material));
+        }
+        light_markers =
+            resources.import(Model(std::move(meshes), std::move(marker_materials)));
+    }
+    ShaderDefines forward_defines = light_defines;
+    forward_defines.append_range(clustered.defines());
+    ShaderVariants shaders(root / "resources/shaders/shader.vs",
+                           root / "resources/shaders/shader.fs", forward_defines);
+    shaders.enable_reload(reloader);
+    DeferredRenderer deferred(root / "resources/shaders");
+    deferred.geometry_shaders().enable_reload(reloader);
+    DepthPrepass prepass(root / "resources/shaders");
+    // Samples shaded by the forward pass, to measure pre-pass savings
+    QueryRing<> samples_query(GL_SAMPLES_PASSED);
+    double last_title_time = 0;
 
     // TextureOpts opts{.srgb = true};
     // auto matl = std::make_shared<Material>();
@@ -79,10 +202,12 @@ void run(const fs::path& exe_path) {
     // Model model = Model({mesh}, {matl});
 
     // Model model = load_model(root / "resources/models/nanosuit/nanosuit.obj");
-    Model model = load_model(root / "resources/models/master_sword__hylian_shield/scene.gltf");
+    Model model = load_model(root / "resources/models/master_sword__hylian_shield/scene.gltf",
+                             DEFAULT_FLAGS, &pool);
     for (auto& mat : model.materials()) {
         mat->specular_color = glm::vec3(1);
         // mat->shininess = 50.f;
+        mat->update_features();
     }
 
     glm::mat4 modelmat{1};
@@ -92,12 +217,65 @@ void run(const fs::path& exe_path) {
     modelmat = glm::rotate(modelmat, -.45f*glm::pi<float>(), {1, 0, 0});
     modelmat = glm::scale(modelmat, glm::vec3(1.f/110.f));
 
-    shader.use();
+    MeshBatch batch(model);
+    OcclusionCuller culler(root / "resources/shaders");
 
-    DirLight lights[] = {{.direction = {-1, -1, -1}}};
-    apply_array(shader, "dirLights", "numDirLights", lights);
+    // Two sets of objects and queues are in flight in crowd mode
+    std::array<std::vector<SceneObject>, 2> crowd;
+    std::array<RenderQueue, 2> queues{RenderQueue(pool), RenderQueue(pool)};
+    size_t front = 0;
+    std::future<void> recording;
+    ScopeGuard wait_recording([&] {
+        if (recording.valid())
+            recording.wait();
+    });
+    // The crowd stands on a ground plane that receives its shadows
+    auto ground_material = std::make_shared<Material>();
+    ground_material->diffuse_color = glm::vec3(0.6f);
+    ground_material->update_features();
+    float ground_size = CROWD_SIZE;
+    auto ground_mesh = std::make_shared<Mesh>(make_quad(
+        {-ground_size, 0, ground_size}, {ground_size, 0, ground_size},
+        {ground_size, 0, -ground_size}, {-ground_size, 0, -ground_size}));
+    ground_mesh->set_material(ground_material);
+    Model ground({ground_mesh}, {ground_material});
+    std::vector<std::shared_ptr<Material>> crowd_materials = model.materials();
+    crowd_materials.push_back(ground_material);
+
+    // Crowd transforms are streamed through a persistently mapped ring, and materials
+    // are selected by index into a table instead of rebinding their textures. Small
+    // textures are packed into a shared atlas.
+    TextureAtlas atlas = TextureAtlas::from_materials(crowd_materials, {.pool = &pool});
+    MaterialTable materials(crowd_materials, MaterialTable::bindless_supported(), &atlas);
+    CascadedShadowMap shadows(root / "resources/shaders", pool);
+    ShaderDefines crowd_defines = light_defines;
+    crowd_defines.append_range(RenderQueue::per_draw_defines());
+    crowd_defines.append_range(materials.defines());
+    crowd_defines.append_range(CascadedShadowMap::defines());
+    ShaderVariants crowd_shaders(root / "resources/shaders/shader.vs",
+                                 root / "resources/shaders/shader.fs", crowd_defines);
+    crowd_shaders.enable_reload(reloader);
+    DynamicBuffer per_draw(GL_UNIFORM_BUFFER, 4 << 20);
+    glm::vec3 crowd_eye{0, 8, 14};
+    glm::mat4 crowd_view = glm::lookAt(crowd_eye, glm::vec3(0), {0, 1, 0});
+    auto record_crowd = [&](size_t slot, float angle, const glm::mat4& projection) {
+        auto& objects = crowd[slot];
+        objects.clear();
+        objects.push_back({&ground, glm::translate(glm::mat4(1), {0, -1, 0})});
+        for (int z = 0; z < CROWD_SIZE; z++) {
+            for (int x = 0; x < CROWD_SIZE; x++) {
+                glm::vec3 pos{x - CROWD_SIZE / 2, 0, z - CROWD_SIZE / 2};
+                glm::mat4 transform = glm::translate(glm::mat4(1), pos * 1.5f);
+                transform = glm::rotate(transform, angle + float(x + z), {0, 1, 0});
+                objects.push_back({&model, transform * modelmat});
+            }
+        }
+        queues[slot].record(pool, objects, crowd_view, projection);
+    };
 
     while (!glfwWindowShouldClose(window)) {
+        reloader.update();
+
         glClearColor(BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, BG_COLOR.a);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -105,17 +283,124 @@ void run(const fs::path& exe_path) {
         float aspect = width / height;
         glm::mat4 projection = glm::perspective(FOV, aspect, ZNEAR, ZFAR);
         // glm::mat4 projection = glm::ortho(-aspect, aspect, -1.f, 1.f, ZNEAR, ZFAR);
-        shader.set_mat4("projection", projection);
 
         glm::mat4 scenemat{1};
         scenemat = glm::translate(scenemat, {0, 0, -5});
         float angle = float(glfwGetTime()) * glm::pi<float>() / 4.f;
         scenemat = glm::rotate(scenemat, angle, {0, 1, 0});
-        shader.set_mat4("model", scenemat * modelmat);
-        shader.set_mat4("view", glm::mat4(1));
 
-        model.draw(&shader);
+        if (!show_crowd && recording.valid())
+            recording.get();
+
+        if (show_crowd) {
+            if (recording.valid()) {
+                recording.get();
+                front = 1 - front;
+            } else {
+                record_crowd(front, angle, projection);
+            }
+            recording = pool.async([&, slot = 1 - front, angle, projection] {
+                record_crowd(slot, angle, projection);
+            });
+            const RenderQueue& queue = queues[front];
+            lights[0].shadow.enabled = use_shadows;
+            shadows.render(lights[0], crowd[front], queue.view(), queue.projection());
+            per_draw.begin_frame();
+            queue.submit(
+                crowd_shaders,
+                [&](const Shader& shader) {
+                    shader.set_mat4("projection", queue.projection());
+                    shader.set_mat4("view", queue.view());
+                    shader.set_vec3("viewPos", crowd_eye);
+                    apply_array(shader, "dirLights", lights);
+                    shadows.apply(shader, SHADOW_UNIT);
+                    if (environment)
+                        environment->apply(shader, ENVIRONMENT_UNIT);
+                },
+                &per_draw, &materials);
+            per_draw.end_frame();
+
+            double time = glfwGetTime();
+            if (time - last_title_time > 0.5) {
+                last_title_time = time;
+                auto& stats = shadows.stats();
+                std::string title = std::format(
+                    "LearnOpenGL - shadows {}: {} draws, {} culled, {} over budget",
+                    use_shadows ? "on" : "off", stats.drawn, stats.culled, stats.skipped);
+                glfwSetWindowTitle(window, title.c_str());
+            }
+        } else if (render_path == RenderPath::Deferred) {
+            deferred.render(model, scenemat * modelmat, glm::mat4(1), projection,
+                            glm::vec3(0), {.dir = lights});
+        } else {
+            clustered.assign(glm::mat4(1), projection, ZNEAR, ZFAR, {width, height});
+            // With culling on, single-program passes take the compacted visible list
+            if (use_culling)
+                culler.cull(batch, projection * scenemat * modelmat);
+            auto draw_visible = [&] { culler.draw(batch); };
+            if (use_prepass && use_culling)
+                prepass.begin(scenemat * modelmat, glm::mat4(1), projection, draw_visible);
+            else if (use_prepass)
+                prepass.begin(model, scenemat * modelmat, glm::mat4(1), projection);
+            auto setup = [&](const Shader& shader) {
+                shader.set_mat4("projection", projection);
+                shader.set_mat4("model", scenemat * modelmat);
+                shader.set_mat4("view", glm::mat4(1));
+                shader.set_vec3("viewPos", glm::vec3(0));
+                apply_array(shader, "dirLights", lights);
+                clustered.bind(shader);
+                if (environment)
+                    environment->apply(shader, ENVIRONMENT_UNIT);
+            };
+            samples_query.begin();
+            if (show_overdraw && use_culling) {
+                prepass.draw_overdraw(scenemat * modelmat, glm::mat4(1), projection,
+                                      draw_visible);
+            } else if (show_overdraw) {
+                prepass.draw_overdraw(model, scenemat * modelmat, glm::mat4(1), projection);
+            } else {
+                if (use_culling) {
+                    for (auto& group : batch.groups()) {
+                        unsigned int features = group.material ? group.material->features : 0;
+                        const Shader& shader = shaders.get(features);
+                        shader.use();
+                        setup(shader);
+                        if (group.material)
+                            group.material->apply(shader);
+                        culler.draw(batch, group);
+                    }
+                } else {
+                    model.draw(shaders, setup);
+                }
+            }
+            samples_query.end();
+            if (use_prepass)
+                prepass.end();
+            // The light markers aren't in the pre-pass depth, so GL_EQUAL would drop them
+            if (!show_overdraw) {
+                resources.draw(shaders, [&](const Shader& shader) {
+                    setup(shader);
+                    shader.set_mat4("model", glm::mat4(1));
+                });
+            }
+
+            double time = glfwGetTime();
+            auto samples = samples_query.result();
+            if (samples && time - last_title_time > 0.5) {
+                last_title_time = time;
+                std::string title = std::format("LearnOpenGL - prepass {}: {} samples shaded",
+                                                use_prepass ? "on" : "off", *samples);
+                if (auto stats = culler.stats(); use_culling && stats)
+                    title += std::format(", {} meshes drawn, {} culled", stats->drawn,
+                                         stats->culled);
+                glfwSetWindowTitle(window, title.c_str());
+            }
+            // This frame's depth occludes the next one
+            if (use_culling)
+                culler.build_hiz(GLsizei(width), GLsizei(height));
+        }
 
+        resources.end_frame();
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
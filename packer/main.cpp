@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/compat.h"
+#include "common/errutils.h"
+#include "common/pack_file.h"
+#include "common/thread_pool.h"
+#include "common/u8tils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Formats that are compressed already; compressing them again only costs load time
+constexpr std::array PRECOMPRESSED_EXTENSIONS{".png", ".jpg", ".jpeg", ".ktx2", ".dds",
+                                              ".basis", ".zip", ".gz", ".mp3", ".ogg"};
+
+bool is_precompressed(const fs::path& path) {
+    std::string ext = u8::path_to_string(path.extension());
+    for (char& c : ext)
+        c = char(std::tolower(static_cast<unsigned char>(c)));
+    return std::ranges::contains(PRECOMPRESSED_EXTENSIONS, ext);
+}
+
+void run(const std::vector<fs::path>& args) {
+    std::optional<fs::path> input_dir, output;
+    std::string codec_name = "lz4";
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--compress" && i + 1 < args.size()) {
+            codec_name = u8::path_to_string(args[++i]);
+        } else if (!input_dir) {
+            input_dir = args[i];
+        } else if (!output) {
+            output = args[i];
+        } else {
+            err::error("unexpected argument {}", u8::path_to_string(args[i]));
+        }
+    }
+    if (!input_dir || !output)
+        err::error("usage: packer <input dir> <output pack> [--compress stored|lz4|zstd]");
+    auto parsed = parse_pack_codec(codec_name);
+    err::check(parsed.has_value(), "unknown codec {}", codec_name);
+    PackCodec codec = *parsed;
+    if (!pack_codec_supported(codec)) {
+        std::println(std::cerr, "warning: packer was built without {}, storing instead",
+                     codec_name);
+        codec = PackCodec::Stored;
+    }
+
+    std::vector<PackInput> inputs;
+    auto options = fs::directory_options::follow_directory_symlink;
+    for (const auto& dir_entry : fs::recursive_directory_iterator(*input_dir, options)) {
+        if (!dir_entry.is_regular_file())
+            continue;
+        const fs::path& path = dir_entry.path();
+        fs::path relative = path.lexically_relative(*input_dir);
+        inputs.push_back({u8::to_string(relative.generic_u8string()), path,
+                          is_precompressed(path) ? PackCodec::Stored : codec});
+    }
+
+    ThreadPool pool;
+    write_pack(inputs, *output, pool);
+
+    PackFile pack(*output);
+    uint64_t size = 0, stored_size = 0;
+    for (const PackEntry& entry : pack.entries()) {
+        size += entry.size;
+        stored_size += entry.stored_size;
+    }
+    std::println("packed {} files, {} bytes into {} bytes", pack.entries().size(), size,
+                 stored_size);
+}
+
+} // namespace
+
+int LGL_TMAIN(int argc, LGL_TCHAR* argv[]) {
+    try {
+        run(std::vector<fs::path>(argv + std::min(argc, 1), argv + argc));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Light buffers and cluster lookup for clustered forward shading. Must match the
+// packed structs and bindings in common/clustered_lights.h. The assignment compute
+// shader defines CLUSTER_ASSIGNMENT to get write access to the cluster buffers.
+
+#ifdef CLUSTER_ASSIGNMENT
+#define CLUSTER_ACCESS writeonly
+#else
+#define CLUSTER_ACCESS readonly
+#endif
+
+struct PackedPointLight {
+    vec4 position;    // xyz: position, w: range
+    vec4 attenuation; // constant, linear, quadratic
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+struct PackedSpotLight {
+    vec4 position;    // xyz: position, w: range
+    vec4 direction;   // xyz: direction, w: inner cutoff
+    vec4 attenuation; // constant, linear, quadratic, outer cutoff
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+layout(std430, binding = 0) readonly buffer PointLightBuffer {
+    PackedPointLight packedPointLights[];
+};
+layout(std430, binding = 1) readonly buffer SpotLightBuffer {
+    PackedSpotLight packedSpotLights[];
+};
+// (offset, count) into clusterLightIndices per cluster
+layout(std430, binding = 2) CLUSTER_ACCESS buffer ClusterBuffer {
+    uvec2 clusters[];
+};
+layout(std430, binding = 3) CLUSTER_ACCESS buffer ClusterIndexBuffer {
+    uint clusterLightIndices[];
+};
+
+uniform uvec3 clusterDims;
+uniform vec2 clusterTileSize;
+// slice = log(depth) * clusterZScale + clusterZBias
+uniform float clusterZScale;
+uniform float clusterZBias;
+uniform float zNear;
+uniform float zFar;
+// Indices >= this refer to spot lights
+uniform uint numClusterPointLights;
+
+PointLight UnpackPointLight(PackedPointLight l) {
+    return PointLight(l.position.xyz, l.attenuation.x, l.attenuation.y, l.attenuation.z,
+                      l.ambient.rgb, l.diffuse.rgb, l.specular.rgb);
+}
+
+SpotLight UnpackSpotLight(PackedSpotLight l) {
+    return SpotLight(l.position.xyz, l.direction.xyz, l.direction.w, l.attenuation.w,
+                     l.attenuation.x, l.attenuation.y, l.attenuation.z,
+                     l.ambient.rgb, l.diffuse.rgb, l.specular.rgb);
+}
+
+#ifndef CLUSTER_ASSIGNMENT
+// Returns (offset, count) of the lights overlapping this fragment's cluster
+uvec2 GetCluster() {
+    // Linear view depth from the perspective depth buffer value
+    float ndcZ = gl_FragCoord.z * 2.0 - 1.0;
+    float depth = 2.0 * zNear * zFar / (zFar + zNear - ndcZ * (zFar - zNear));
+    uint slice = uint(max(log(depth) * clusterZScale + clusterZBias, 0.0));
+    uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / clusterTileSize), slice),
+                        clusterDims - 1u);
+    return clusters[cluster.x + clusterDims.x * (cluster.y + clusterDims.y * cluster.z)];
+}
+#endif
@@ -0,0 +1,59 @@
+#version 430 core
+// Light accumulation for deferred shading. Built once per light type with one of
+// DIR_LIGHT, POINT_LIGHT or SPOT_LIGHT defined, or COMPOSITE to copy the
+// accumulation buffer to the screen. Output is blended additively.
+out vec4 FragColor;
+
+#include "lights.glsl"
+#include "lighting.glsl"
+#include "packing.glsl"
+
+uniform sampler2D gAlbedoAO;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecularShininess;
+uniform sampler2D gDepth;
+uniform sampler2D accumulation;
+
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+
+#if defined(DIR_LIGHT)
+uniform DirLight light;
+#elif defined(POINT_LIGHT)
+uniform PointLight light;
+#elif defined(SPOT_LIGHT)
+uniform SpotLight light;
+#endif
+
+void main()
+{
+	ivec2 coord = ivec2(gl_FragCoord.xy);
+	// Nothing was drawn here, so leave the background alone
+	float depth = texelFetch(gDepth, coord, 0).r;
+	if (depth == 1.0)
+		discard;
+#ifdef COMPOSITE
+	FragColor = vec4(texelFetch(accumulation, coord, 0).rgb, 1.0);
+#else
+	// Reconstruct world position from depth
+	vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(gDepth, 0))) * 2.0 - 1.0;
+	vec4 pos = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+	vec3 fragPos = pos.xyz / pos.w;
+
+	vec4 albedoAO = texelFetch(gAlbedoAO, coord, 0);
+	vec4 specShininess = texelFetch(gSpecularShininess, coord, 0);
+	vec3 normal = OctDecode(texelFetch(gNormal, coord, 0).xy);
+	vec3 viewDir = normalize(viewPos - fragPos);
+	// Ambient was accumulated in the geometry pass
+	Surface surface = Surface(vec3(0.0), albedoAO.rgb, specShininess.rgb, specShininess.a);
+
+#if defined(DIR_LIGHT)
+	vec3 color = CalcDirLight(light, surface, normal, viewDir);
+#elif defined(POINT_LIGHT)
+	vec3 color = CalcPointLight(light, surface, normal, fragPos, viewDir);
+#elif defined(SPOT_LIGHT)
+	vec3 color = CalcSpotLight(light, surface, normal, fragPos, viewDir);
+#endif
+	FragColor = vec4(color * albedoAO.a, 1.0);
+#endif
+}
@@ -0,0 +1,18 @@
+#version 430 core
+// Light pass for deferred shading. Light volumes are drawn as meshes; everything
+// else is a fullscreen triangle generated from gl_VertexID.
+layout (location = 0) in vec3 aPosition;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+#ifdef LIGHT_VOLUME
+	gl_Position = projection * (view * (model * vec4(aPosition, 1.0)));
+#else
+	vec2 uv = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0;
+	gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+#endif
+}
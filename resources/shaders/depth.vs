@@ -0,0 +1,16 @@
+#version 330 core
+// Position-only transform for depth pre-passes. gl_Position must be computed exactly
+// as in shader.vs so the main pass can depth test with GL_EQUAL.
+layout (location = 0) in vec3 aPosition;
+
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	vec4 position = model * vec4(aPosition, 1.0);
+	gl_Position = projection * (view * position);
+}
@@ -0,0 +1,59 @@
+#version 430 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+// Geometry pass for deferred shading (see common/deferred.h). Writes surface
+// attributes to the G-buffer, and the unattenuated ambient and emissive terms
+// straight into the light accumulation buffer.
+layout (location = 0) out vec4 AlbedoAO;
+layout (location = 1) out vec2 PackedNormal;
+layout (location = 2) out vec4 SpecularShininess;
+layout (location = 3) out vec4 Accumulation;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+#include "material.glsl"
+#include "packing.glsl"
+
+#if HAS_NORMAL_TEXTURE
+in vec4 Tangent;
+#endif
+
+#ifndef MATERIAL_TABLE
+uniform Material material;
+#endif
+// Sum of the ambient terms of all lights
+uniform vec3 sceneAmbient;
+
+void main()
+{
+	vec4 diffTex = GetTexture(material.diffuse_texture,
+		TEXTURE_BOUND(material.diffuse_texture, HAS_DIFFUSE_TEXTURE), TexCoords);
+	vec4 specTex = GetTexture(material.specular_texture,
+		TEXTURE_BOUND(material.specular_texture, HAS_SPECULAR_TEXTURE), TexCoords);
+	vec4 emissTex = GetTexture(material.emissive_texture,
+		TEXTURE_BOUND(material.emissive_texture, HAS_EMISSIVE_TEXTURE), TexCoords);
+	vec4 aoTex = GetTexture(material.ao_texture,
+		TEXTURE_BOUND(material.ao_texture, HAS_AO_TEXTURE), TexCoords);
+	float ao = aoTex.r;
+#if HAS_PBR
+	// Metallic-roughness materials are stored with their Phong terms; only their
+	// occlusion comes from the packed texture
+	ao *= GetTexture(material.orm_texture,
+		TEXTURE_BOUND(material.orm_texture, HAS_ORM_TEXTURE), TexCoords).r;
+#endif
+
+	AlbedoAO = vec4(material.diffuse_color * diffTex.rgb, ao);
+	vec3 normal = normalize(Normal);
+#if HAS_NORMAL_TEXTURE
+	normal = NormalFromMap(normal, Tangent,
+		GetTexture(material.normal_texture, true, TexCoords));
+#endif
+	PackedNormal = OctEncode(normal);
+	SpecularShininess = vec4(material.specular_color * specTex.rgb,
+							 SPECULAR_ENABLED ? material.shininess : 0.0);
+	Accumulation = vec4(sceneAmbient * material.ambient_color * diffTex.rgb * ao +
+						material.emissive_color * emissTex.rgb, 1.0);
+}
@@ -0,0 +1,38 @@
+// Image-based ambient lighting from a baked environment, see EnvironmentLighting
+
+// Specular radiance prefiltered for increasing roughness down the mip chain
+uniform samplerCube environmentMap;
+uniform float environmentMaxLod;
+// Split-sum GGX scale and bias on F0, by cos(theta) of the view direction and roughness
+uniform sampler2D brdfLut;
+// Irradiance over pi as order 2 spherical harmonics
+uniform vec3 irradianceSH[9];
+
+// Light reaching a Lambertian surface with the given normal, times albedo
+vec3 EnvironmentDiffuse(vec3 n)
+{
+    vec3 result = irradianceSH[0] * 0.282095
+        + irradianceSH[1] * (0.488603 * n.y)
+        + irradianceSH[2] * (0.488603 * n.z)
+        + irradianceSH[3] * (0.488603 * n.x)
+        + irradianceSH[4] * (1.092548 * n.x * n.y)
+        + irradianceSH[5] * (1.092548 * n.y * n.z)
+        + irradianceSH[6] * (0.315392 * (3.0 * n.z * n.z - 1.0))
+        + irradianceSH[7] * (1.092548 * n.x * n.z)
+        + irradianceSH[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+    // Order 2 rings slightly negative facing away from a bright source
+    return max(result, vec3(0.0));
+}
+
+// Prefiltered radiance along the reflection vector r for GGX roughness in [0, 1]
+vec3 EnvironmentSpecular(vec3 r, float roughness)
+{
+    return textureLod(environmentMap, r, roughness * environmentMaxLod).rgb;
+}
+
+// Directional albedo of a GGX surface with specular color f0, for the split sum
+vec3 EnvironmentBrdf(vec3 f0, float nDotV, float roughness)
+{
+    vec2 scaleBias = texture(brdfLut, vec2(nDotV, roughness)).rg;
+    return f0 * scaleBias.x + scaleBias.y;
+}
@@ -0,0 +1,76 @@
+// Phong lighting for a surface, shared by the forward and deferred shaders
+
+struct Surface {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    // Specular is disabled when <= 0
+    float shininess;
+};
+
+// shadow scales the diffuse and specular terms
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = surface.shininess > 0.0 ?
+		pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess) : 0.0;
+    // combine results
+    vec3 ambient  = light.ambient  * surface.ambient;
+    vec3 diffuse  = light.diffuse  * surface.diffuse * diff;
+    vec3 specular = light.specular * surface.specular * spec;
+    return ambient + (diffuse + specular) * shadow;
+}
+
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir)
+{
+    return CalcDirLight(light, surface, normal, viewDir, 1.0);
+}
+
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos,
+                    vec3 viewDir)
+{
+	vec3 lightDisp = light.position - fragPos;
+	float lightDist = length(lightDisp);
+	vec3 lightDir = lightDisp / lightDist;
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = surface.shininess > 0.0 ?
+		pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess) : 0.0;
+	// attenuation
+	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
+    // combine results
+    vec3 ambient  = light.ambient  * surface.ambient;
+    vec3 diffuse  = light.diffuse  * surface.diffuse * diff;
+    vec3 specular = light.specular * surface.specular * spec;
+    return ambient + (diffuse + specular) * attenuation;
+}
+
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 normal, vec3 fragPos,
+                   vec3 viewDir)
+{
+	vec3 lightDisp = light.position - fragPos;
+	float lightDist = length(lightDisp);
+	vec3 lightDir = lightDisp / lightDist;
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = surface.shininess > 0.0 ?
+		pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess) : 0.0;
+	// attenuation
+	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
+	// spotlight intensity
+	float spotCos = dot(lightDir, normalize(-light.direction));
+	float spotIntensity = smoothstep(light.outer_cuttoff, light.inner_cuttoff, spotCos);
+    // combine results
+    vec3 ambient  = light.ambient  * surface.ambient;
+    vec3 diffuse  = light.diffuse  * surface.diffuse * diff;
+    vec3 specular = light.specular * surface.specular * spec;
+    return ambient + (diffuse + specular) * attenuation * spotIntensity;
+}
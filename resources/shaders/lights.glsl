@@ -0,0 +1,34 @@
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+	float constant;
+	float linear;
+	float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+	vec3 direction;
+	float inner_cuttoff;
+	float outer_cuttoff;
+
+	float constant;
+	float linear;
+	float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
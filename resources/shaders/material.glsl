@@ -0,0 +1,141 @@
+// Material uniforms and texture sampling shared by the forward and G-buffer shaders.
+// Must match Material::apply in common/material.cpp.
+
+#ifdef MATERIAL_TABLE
+// Materials come from MaterialTable's SSBO (common/material_table.h), indexed by
+// materialIndex. Textures are bindless handles with BINDLESS_TEXTURES (the including
+// shader enables the extension), otherwise layers of the materialArrays. Array layers
+// may be atlas pages, with the texture at rect (uv offset, uv scale).
+struct Texture {
+	uvec2 handle;
+	uint layer;
+	bool bound;
+	vec4 rect;
+};
+
+// Marks bindless handles of plain 2D textures
+#define NO_LAYER 0xffffffffu
+#ifndef BINDLESS_TEXTURES
+#define MAX_TEXTURE_ARRAYS 8
+uniform sampler2DArray materialArrays[MAX_TEXTURE_ARRAYS];
+#endif
+#else
+struct Texture {
+	sampler2D texture;
+	bool bound;
+};
+#endif
+
+// Permuted builds (see ShaderVariants) define MATERIAL_FEATURES and a HAS_* macro per
+// material feature, turning texture and specular checks into compile-time constants
+#ifdef MATERIAL_FEATURES
+#ifndef HAS_DIFFUSE_TEXTURE
+#define HAS_DIFFUSE_TEXTURE 0
+#endif
+#ifndef HAS_SPECULAR_TEXTURE
+#define HAS_SPECULAR_TEXTURE 0
+#endif
+#ifndef HAS_EMISSIVE_TEXTURE
+#define HAS_EMISSIVE_TEXTURE 0
+#endif
+#ifndef HAS_AO_TEXTURE
+#define HAS_AO_TEXTURE 0
+#endif
+#ifndef HAS_SPECULAR
+#define HAS_SPECULAR 0
+#endif
+#ifndef HAS_ORM_TEXTURE
+#define HAS_ORM_TEXTURE 0
+#endif
+#define TEXTURE_BOUND(tex, feature) (feature != 0)
+#define SPECULAR_ENABLED (HAS_SPECULAR != 0)
+#else
+#define TEXTURE_BOUND(tex, feature) tex.bound
+#define SPECULAR_ENABLED (material.shininess > 0.0)
+#endif
+// Metallic-roughness shading and normal mapping are compiled in per permutation only;
+// runtime-branching builds shade every material with its Phong terms and vertex normals
+#ifndef HAS_PBR
+#define HAS_PBR 0
+#endif
+#ifndef HAS_NORMAL_TEXTURE
+#define HAS_NORMAL_TEXTURE 0
+#endif
+
+#ifdef MATERIAL_TABLE
+// Repeats within the atlas rectangle. Gradients come from the unwrapped coordinates so
+// the wrap doesn't select the smallest mip along it.
+vec4 SampleLayer(sampler2DArray array, Texture tex, vec2 texCoords) {
+	vec2 uv = tex.rect.xy + fract(texCoords) * tex.rect.zw;
+	return textureGrad(array, vec3(uv, tex.layer), dFdx(texCoords) * tex.rect.zw,
+					   dFdy(texCoords) * tex.rect.zw);
+}
+#endif
+
+vec4 GetTexture(Texture tex, bool bound, vec2 texCoords) {
+#if !defined(MATERIAL_TABLE)
+	return bound ? texture(tex.texture, texCoords) : vec4(1.0);
+#elif defined(BINDLESS_TEXTURES)
+	if (!bound)
+		return vec4(1.0);
+	if (tex.layer == NO_LAYER)
+		return texture(sampler2D(tex.handle), texCoords);
+	return SampleLayer(sampler2DArray(tex.handle), tex, texCoords);
+#else
+	// The index comes from the material, so it is uniform across each draw
+	return bound ? SampleLayer(materialArrays[tex.handle.x], tex, texCoords) : vec4(1.0);
+#endif
+}
+
+// Perturbs the interpolated vertex normal by a tangent-space normal map sample, with
+// tangent as output by shader.vs (bitangent sign in w)
+vec3 NormalFromMap(vec3 normal, vec4 tangent, vec4 mapSample) {
+	// Re-orthogonalized, since interpolation skews the frame
+	vec3 t = normalize(tangent.xyz - normal * dot(normal, tangent.xyz));
+	vec3 b = cross(normal, t) * tangent.w;
+	vec3 n = mapSample.xyz * 2.0 - 1.0;
+	return normalize(mat3(t, b, normal) * n);
+}
+
+struct Material {
+    Texture diffuse_texture;
+    Texture specular_texture;
+    Texture emissive_texture;
+    Texture ao_texture;
+    Texture orm_texture;
+    Texture normal_texture;
+	vec3 ambient_color;
+    float metallic;
+    vec3 diffuse_color;
+    float roughness;
+    vec3 specular_color;
+    vec3 emissive_color;
+    float shininess;
+};
+
+#ifdef MATERIAL_TABLE
+// Same members as Material, in MaterialTable::GpuMaterial's std430 layout
+struct MaterialEntry {
+	Texture diffuse_texture;
+	Texture specular_texture;
+	Texture emissive_texture;
+	Texture ao_texture;
+	Texture orm_texture;
+	Texture normal_texture;
+	vec3 ambient_color;
+	float metallic;
+	vec3 diffuse_color;
+	float roughness;
+	vec3 specular_color;
+	vec3 emissive_color;
+	float shininess;
+};
+
+layout(std430, binding = 7) readonly buffer MaterialBuffer {
+	MaterialEntry materials[];
+};
+uniform uint materialIndex;
+
+// Stands in for the material uniform of the non-table path
+#define material materials[materialIndex]
+#endif
@@ -0,0 +1,11 @@
+#version 330 core
+// Overdraw visualization: each shaded fragment adds a fixed amount with additive
+// blending, so brighter pixels were shaded more times
+out vec4 FragColor;
+
+uniform vec3 overdrawStep;
+
+void main()
+{
+	FragColor = vec4(overdrawStep, 1.0);
+}
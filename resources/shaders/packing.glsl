@@ -0,0 +1,24 @@
+// Octahedral unit vector encoding into two components in [-1, 1]
+
+vec2 OctWrap(vec2 v) {
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 OctEncode(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	return n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+}
+
+vec3 OctDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+// Tangent in xyz and bitangent sign in w from pack_tangent in common/tangents.h:
+// octahedral x and y at 15 bits each, and the sign in the top bit
+vec4 UnpackTangent(uint bits) {
+	vec2 e = vec2(bits & 0x7fffu, (bits >> 15) & 0x7fffu) / 32767.0 * 2.0 - 1.0;
+	return vec4(OctDecode(e), (bits & 0x80000000u) != 0u ? -1.0 : 1.0);
+}
@@ -0,0 +1,97 @@
+// Metallic-roughness lighting for materials with FEATURE_PBR. The CalcDirLight,
+// CalcPointLight and CalcSpotLight overloads take a PbrSurface, so the light loops of the
+// including shader are the same for both models. A light's diffuse color is its
+// radiance; its specular color is unused.
+
+const float PI = 3.14159265;
+
+struct PbrSurface {
+    vec3 albedo;
+    // Specular color at normal incidence
+    vec3 f0;
+    float metallic;
+    float roughness;
+    // Ambient occlusion, applied to image-based light only
+    float occlusion;
+};
+
+PbrSurface MakePbrSurface(vec3 baseColor, float metallic, float roughness, float occlusion)
+{
+    // Dielectrics reflect 4% at normal incidence
+    return PbrSurface(baseColor, mix(vec3(0.04), baseColor, metallic), metallic,
+                      clamp(roughness, 0.03, 1.0), occlusion);
+}
+
+vec3 FresnelSchlick(vec3 f0, float cosTheta)
+{
+    return f0 + (1.0 - f0) * pow(1.0 - cosTheta, 5.0);
+}
+
+// Cook-Torrance GGX specular plus Lambert diffuse for light arriving from lightDir
+vec3 CalcPbrLight(PbrSurface surface, vec3 normal, vec3 viewDir, vec3 lightDir,
+                  vec3 radiance)
+{
+    float nDotL = max(dot(normal, lightDir), 0.0);
+    if (nDotL == 0.0)
+        return vec3(0.0);
+    vec3 halfway = normalize(viewDir + lightDir);
+    float nDotV = max(dot(normal, viewDir), 1e-4);
+    float nDotH = max(dot(normal, halfway), 0.0);
+    float a = surface.roughness * surface.roughness;
+    float a2 = a * a;
+    float d = nDotH * nDotH * (a2 - 1.0) + 1.0;
+    float ndf = a2 / (PI * d * d);
+    // Height-correlated Smith visibility, with the 4 nDotL nDotV denominator folded in
+    float vis = 0.5 / (nDotL * sqrt(nDotV * nDotV * (1.0 - a2) + a2) +
+                       nDotV * sqrt(nDotL * nDotL * (1.0 - a2) + a2));
+    vec3 f = FresnelSchlick(surface.f0, max(dot(halfway, viewDir), 0.0));
+    vec3 diffuse = (1.0 - f) * (1.0 - surface.metallic) * surface.albedo / PI;
+    return (diffuse + f * ndf * vis) * radiance * nDotL;
+}
+
+vec3 CalcDirLight(DirLight light, PbrSurface surface, vec3 normal, vec3 viewDir,
+                  float shadow)
+{
+    vec3 ambient = light.ambient * surface.albedo;
+    return ambient + CalcPbrLight(surface, normal, viewDir, normalize(-light.direction),
+                                  light.diffuse) * shadow;
+}
+
+vec3 CalcPointLight(PointLight light, PbrSurface surface, vec3 normal, vec3 fragPos,
+                    vec3 viewDir)
+{
+	vec3 lightDisp = light.position - fragPos;
+	float lightDist = length(lightDisp);
+	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
+    vec3 ambient = light.ambient * surface.albedo;
+    return ambient + CalcPbrLight(surface, normal, viewDir, lightDisp / lightDist,
+                                  light.diffuse) * attenuation;
+}
+
+vec3 CalcSpotLight(SpotLight light, PbrSurface surface, vec3 normal, vec3 fragPos,
+                   vec3 viewDir)
+{
+	vec3 lightDisp = light.position - fragPos;
+	float lightDist = length(lightDisp);
+	vec3 lightDir = lightDisp / lightDist;
+	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
+	float spotCos = dot(lightDir, normalize(-light.direction));
+	float spotIntensity = smoothstep(light.outer_cuttoff, light.inner_cuttoff, spotCos);
+    vec3 ambient = light.ambient * surface.albedo;
+    return ambient + CalcPbrLight(surface, normal, viewDir, lightDir, light.diffuse) *
+                     attenuation * spotIntensity;
+}
+
+#ifdef IMAGE_BASED_LIGHTING
+// Split-sum ambient from ibl.glsl, which must be included first
+vec3 CalcEnvironmentLight(PbrSurface surface, vec3 normal, vec3 viewDir)
+{
+    float nDotV = max(dot(normal, viewDir), 1e-4);
+    vec3 specular = EnvironmentSpecular(reflect(-viewDir, normal), surface.roughness) *
+                    EnvironmentBrdf(surface.f0, nDotV, surface.roughness);
+    // Light not reflected specularly at this angle is left for diffuse
+    vec3 kd = (1.0 - FresnelSchlick(surface.f0, nDotV)) * (1.0 - surface.metallic);
+    vec3 diffuse = kd * surface.albedo * EnvironmentDiffuse(normal);
+    return (diffuse + specular) * surface.occlusion;
+}
+#endif
@@ -1,153 +1,131 @@
-#version 330 core
+#version 430 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-struct Texture {
-	sampler2D texture;
-	bool bound;
-};
-
-vec4 GetTexture(Texture tex, vec2 texCoords) {
-	return tex.bound ? texture(tex.texture, texCoords) : vec4(1.0);
-}
-
-struct Material {
-    Texture diffuse_texture;
-    Texture specular_texture;
-    Texture emissive_texture;
-    Texture ao_texture;
-	vec3 ambient_color;
-    vec3 diffuse_color;
-    vec3 specular_color;
-    vec3 emissive_color;
-    float shininess;
-};
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-	vec3 direction;
-	float inner_cuttoff;
-	float outer_cuttoff;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
+#include "material.glsl"
+#include "lights.glsl"
+#include "lighting.glsl"
+#ifdef CLUSTERED_LIGHTING
+#include "clustered.glsl"
+#endif
+#ifdef SHADOWED_DIR_LIGHT
+#include "shadow.glsl"
+#endif
+#ifdef IMAGE_BASED_LIGHTING
+#include "ibl.glsl"
+#endif
+#if HAS_PBR
+#include "pbr.glsl"
+#endif
+
+#if HAS_NORMAL_TEXTURE
+in vec4 Tangent;
+#endif
+
+#ifndef MAX_LIGHTS
 #define MAX_LIGHTS 10
+#endif
 
 uniform vec3 viewPos;
+#ifndef MATERIAL_TABLE
 uniform Material material;
-
-uniform int numDirLights, numPointLights, numSpotLights;
+#endif
+
+// Light counts can be baked in with NUM_*_LIGHTS defines to unroll the light loops
+#ifdef NUM_DIR_LIGHTS
+const int numDirLights = NUM_DIR_LIGHTS;
+#else
+uniform int numDirLights;
+#endif
+#ifdef NUM_POINT_LIGHTS
+const int numPointLights = NUM_POINT_LIGHTS;
+#else
+uniform int numPointLights;
+#endif
+#ifdef NUM_SPOT_LIGHTS
+const int numSpotLights = NUM_SPOT_LIGHTS;
+#else
+uniform int numSpotLights;
+#endif
 uniform DirLight dirLights[MAX_LIGHTS];
 uniform PointLight pointLights[MAX_LIGHTS];
 uniform SpotLight spotLights[MAX_LIGHTS];
 
-vec4 diffTex = GetTexture(material.diffuse_texture, TexCoords);
-vec4 specTex = GetTexture(material.specular_texture, TexCoords);
-vec4 emissTex = GetTexture(material.emissive_texture, TexCoords);
-vec4 aoTex = GetTexture(material.ao_texture, TexCoords);
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = material.shininess > 0.0 ?
-		pow(max(dot(viewDir, reflectDir), 0.0), material.shininess) : 0.0;
-    // combine results
-    vec3 ambient  = light.ambient  * material.ambient_color  * diffTex.rgb;
-    vec3 diffuse  = light.diffuse  * material.diffuse_color  * diffTex.rgb * diff;
-    vec3 specular = light.specular * material.specular_color * specTex.rgb * spec;
-    return ambient + diffuse + specular;
-}
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-	vec3 lightDisp = light.position - fragPos;
-	float lightDist = length(lightDisp);
-	vec3 lightDir = lightDisp / lightDist;
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = material.shininess > 0.0 ?
-		pow(max(dot(viewDir, reflectDir), 0.0), material.shininess) : 0.0;
-	// attenuation
-	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
-    // combine results
-    vec3 ambient  = light.ambient  * material.ambient_color  * diffTex.rgb;
-    vec3 diffuse  = light.diffuse  * material.diffuse_color  * diffTex.rgb * diff;
-    vec3 specular = light.specular * material.specular_color * specTex.rgb * spec;
-    return ambient + (diffuse + specular) * attenuation;
-}
-
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-	vec3 lightDisp = light.position - fragPos;
-	float lightDist = length(lightDisp);
-	vec3 lightDir = lightDisp / lightDist;
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = material.shininess > 0.0 ?
-		pow(max(dot(viewDir, reflectDir), 0.0), material.shininess) : 0.0;
-	// attenuation
-	float attenuation = 1 / (light.constant + light.linear*lightDist + light.quadratic*lightDist*lightDist);
-	// spotlight intensity
-	float spotCos = dot(lightDir, normalize(-light.direction));
-	float spotIntensity = smoothstep(light.outer_cuttoff, light.inner_cuttoff, spotCos);
-    // combine results
-    vec3 ambient  = light.ambient  * material.ambient_color  * diffTex.rgb;
-    vec3 diffuse  = light.diffuse  * material.diffuse_color  * diffTex.rgb * diff;
-    vec3 specular = light.specular * material.specular_color * specTex.rgb * spec;
-    return ambient + (diffuse + specular) * attenuation * spotIntensity;
-}
+vec4 diffTex = GetTexture(material.diffuse_texture,
+	TEXTURE_BOUND(material.diffuse_texture, HAS_DIFFUSE_TEXTURE), TexCoords);
+vec4 specTex = GetTexture(material.specular_texture,
+	TEXTURE_BOUND(material.specular_texture, HAS_SPECULAR_TEXTURE), TexCoords);
+vec4 emissTex = GetTexture(material.emissive_texture,
+	TEXTURE_BOUND(material.emissive_texture, HAS_EMISSIVE_TEXTURE), TexCoords);
+vec4 aoTex = GetTexture(material.ao_texture,
+	TEXTURE_BOUND(material.ao_texture, HAS_AO_TEXTURE), TexCoords);
+
+#if HAS_PBR
+vec4 ormTex = GetTexture(material.orm_texture,
+	TEXTURE_BOUND(material.orm_texture, HAS_ORM_TEXTURE), TexCoords);
+
+PbrSurface surface = MakePbrSurface(material.diffuse_color * diffTex.rgb,
+	material.metallic * ormTex.b, material.roughness * ormTex.g, ormTex.r);
+#else
+Surface surface = Surface(
+	material.ambient_color * diffTex.rgb,
+	material.diffuse_color * diffTex.rgb,
+	material.specular_color * specTex.rgb,
+	SPECULAR_ENABLED ? material.shininess : 0.0);
+#endif
 
 void main()
 {
 	vec3 norm = normalize(Normal);
+#if HAS_NORMAL_TEXTURE
+	norm = NormalFromMap(norm, Tangent,
+		GetTexture(material.normal_texture, true, TexCoords));
+#endif
 	vec3 viewDir = normalize(viewPos - FragPos);
 
 	vec3 color = vec3(0);
 
-	for (int i = 0; i < numDirLights; i++)
-		color += CalcDirLight(dirLights[i], norm, viewDir);
+	for (int i = 0; i < numDirLights; i++) {
+#ifdef SHADOWED_DIR_LIGHT
+		float shadow = i == SHADOWED_DIR_LIGHT ? CalcShadow(FragPos, norm) : 1.0;
+#else
+		float shadow = 1.0;
+#endif
+		color += CalcDirLight(dirLights[i], surface, norm, viewDir, shadow);
+	}
+#ifdef CLUSTERED_LIGHTING
+	// Only the point and spot lights overlapping this fragment's cluster
+	uvec2 cluster = GetCluster();
+	for (uint i = 0u; i < cluster.y; i++) {
+		uint index = clusterLightIndices[cluster.x + i];
+		if (index < numClusterPointLights)
+			color += CalcPointLight(UnpackPointLight(packedPointLights[index]), surface,
+									norm, FragPos, viewDir);
+		else
+			color += CalcSpotLight(UnpackSpotLight(packedSpotLights[index - numClusterPointLights]),
+								   surface, norm, FragPos, viewDir);
+	}
+#else
 	for (int i = 0; i < numPointLights; i++)
-		color += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+		color += CalcPointLight(pointLights[i], surface, norm, FragPos, viewDir);
 	for (int i = 0; i < numSpotLights; i++)
-		color += CalcSpotLight(spotLights[i], norm, FragPos, viewDir);
+		color += CalcSpotLight(spotLights[i], surface, norm, FragPos, viewDir);
+#endif
+#if defined(IMAGE_BASED_LIGHTING) && HAS_PBR
+	color += CalcEnvironmentLight(surface, norm, viewDir);
+#elif defined(IMAGE_BASED_LIGHTING)
+	// Phong exponent to the roughness of the GGX lobe it's closest to
+	float roughness = sqrt(sqrt(2.0 / (surface.shininess + 2.0)));
+	color += surface.diffuse * EnvironmentDiffuse(norm);
+	if (surface.shininess > 0.0)
+		color += surface.specular * EnvironmentSpecular(reflect(-viewDir, norm), roughness);
+#endif
 
 	color *= aoTex.rgb;
 	color += material.emissive_color * emissTex.rgb;
@@ -7,7 +7,26 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+// Normal-mapped permutations only
+#ifdef HAS_NORMAL_TEXTURE
+layout (location = 3) in uint aTangent;
+out vec4 Tangent;
+
+#include "packing.glsl"
+#endif
+
+// Must match depth.vs for GL_EQUAL depth testing after a pre-pass
+invariant gl_Position;
+
+#ifdef PER_DRAW_UBO
+// Streamed per draw by RenderQueue::submit through a DynamicBuffer
+layout (std140) uniform PerDraw {
+	mat4 model;
+	mat4 normalMatrix;
+};
+#else
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -16,6 +35,17 @@ void main()
 	vec4 position = model * vec4(aPosition, 1.0);
 	gl_Position = projection * (view * position);
 	FragPos = vec3(position);
+#ifdef PER_DRAW_UBO
+	Normal = mat3(normalMatrix) * aNormal;
+#else
 	Normal = transpose(inverse(mat3(model))) * aNormal;
+#endif
 	TexCoords = aTexCoords;
+#ifdef HAS_NORMAL_TEXTURE
+	// Tangents lie in the surface, so they take the model matrix rather than the normal
+	// matrix. A mirroring transform flips the bitangent.
+	vec4 tangent = UnpackTangent(aTangent);
+	float mirror = determinant(mat3(model)) < 0.0 ? -1.0 : 1.0;
+	Tangent = vec4(mat3(model) * tangent.xyz, tangent.w * mirror);
+#endif
 }
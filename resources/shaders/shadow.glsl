@@ -0,0 +1,45 @@
+// Cascaded shadow map lookup for one directional light, see CascadedShadowMap. A
+// fragment uses the first cascade containing it and is lit beyond the last one.
+
+#ifndef MAX_CASCADES
+#define MAX_CASCADES 4
+#endif
+
+struct ShadowCascade {
+    // World to shadow map texture coordinates and depth
+    mat4 matrix;
+    // World size of one texel, scaling the normal offset
+    float texelSize;
+};
+
+uniform sampler2DArrayShadow shadowMap;
+uniform ShadowCascade shadowCascades[MAX_CASCADES];
+uniform int numShadowCascades;
+uniform float shadowNormalBias;
+uniform float shadowDepthBias;
+uniform int shadowPcfRadius;
+
+// Fraction of the light reaching fragPos, filtered over (2 * shadowPcfRadius + 1)^2
+// texels
+float CalcShadow(vec3 fragPos, vec3 normal)
+{
+    for (int i = 0; i < numShadowCascades; i++) {
+        vec3 coord = (shadowCascades[i].matrix * vec4(fragPos, 1.0)).xyz;
+        if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0))))
+            continue;
+        // Offsetting along the normal keeps surfaces from shadowing themselves at
+        // grazing angles, where a depth bias alone would have to be large
+        vec3 offsetPos = fragPos + normal * (shadowNormalBias * shadowCascades[i].texelSize);
+        coord = (shadowCascades[i].matrix * vec4(offsetPos, 1.0)).xyz;
+        vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        float lit = 0.0;
+        for (int y = -shadowPcfRadius; y <= shadowPcfRadius; y++) {
+            for (int x = -shadowPcfRadius; x <= shadowPcfRadius; x++)
+                lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texel, float(i),
+                                               coord.z - shadowDepthBias));
+        }
+        int width = 2 * shadowPcfRadius + 1;
+        return lit / float(width * width);
+    }
+    return 1.0;
+}
@@ -0,0 +1,28 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+#include "lights.glsl"
+#include "lighting.glsl"
+
+uniform vec3 viewPos;
+uniform DirLight light;
+uniform float terrainHeightScale;
+
+void main()
+{
+	vec3 normal = normalize(Normal);
+	// Grass on gentle slopes, rock on steep ones, snow on high flat ground
+	float slope = 1.0 - normal.y;
+	float height = FragPos.y / terrainHeightScale;
+	vec3 color = mix(vec3(0.10, 0.20, 0.05), vec3(0.25, 0.22, 0.20),
+	                 smoothstep(0.15, 0.35, slope));
+	float snow = smoothstep(0.6, 0.75, height) * (1.0 - smoothstep(0.3, 0.5, slope));
+	color = mix(color, vec3(0.8), snow);
+	Surface surface = Surface(color, color, vec3(0.0), 0.0);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	FragColor = vec4(CalcDirLight(light, surface, normal, viewDir), 1.0);
+}
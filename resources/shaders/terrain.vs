@@ -0,0 +1,79 @@
+#version 430 core
+// CDLOD terrain: one flat grid instanced over the chunks selected by Terrain, displaced
+// by the height tile of each chunk
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+struct TerrainChunk {
+	// Level-0 sample coordinates of the first grid vertex
+	vec2 origin;
+	// Level-0 samples between grid vertices
+	float scale;
+	uint layer;
+	// Camera distances over which odd vertices slide onto even ones
+	vec2 morphRange;
+};
+
+layout(std430, binding = 8) readonly buffer TerrainChunks {
+	TerrainChunk chunks[];
+};
+
+uniform sampler2DArray terrainHeights;
+uniform float terrainTileSize;
+uniform float terrainBorder;
+uniform float terrainStride;
+// Largest level-0 sample coordinate
+uniform vec2 terrainLast;
+uniform float terrainSpacing;
+uniform float terrainHeightScale;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+
+TerrainChunk chunk;
+
+// Height at a grid coordinate of the chunk's tile, interpolated between samples
+float Height(vec2 grid)
+{
+	vec2 uv = (grid + terrainBorder + 0.5) / terrainStride;
+	return textureLod(terrainHeights, vec3(uv, chunk.layer), 0.0).r * terrainHeightScale;
+}
+
+// Grid coordinate clamped to the heightmap, collapsing the parts of edge tiles that
+// hang over it
+vec2 ClampGrid(vec2 grid)
+{
+	return min(grid, (terrainLast - chunk.origin) / chunk.scale);
+}
+
+// Rows run from +z to -z, as in make_heightfield
+vec3 WorldPos(vec2 grid)
+{
+	vec2 xz = (chunk.origin + grid * chunk.scale - 0.5 * terrainLast) * terrainSpacing;
+	return vec3(xz.x, Height(grid), -xz.y);
+}
+
+void main()
+{
+	chunk = chunks[gl_InstanceID];
+	vec2 grid = round(aTexCoords * terrainTileSize);
+
+	float dist = distance(viewPos, WorldPos(ClampGrid(grid)));
+	float morph = clamp((dist - chunk.morphRange.x) / (chunk.morphRange.y - chunk.morphRange.x),
+	                    0.0, 1.0);
+	// At morph 1 the grid matches the next coarser level's
+	grid = ClampGrid(grid - fract(grid * 0.5) * 2.0 * morph);
+
+	vec3 position = WorldPos(grid);
+	gl_Position = projection * (view * vec4(position, 1.0));
+	FragPos = position;
+
+	float dx = Height(grid + vec2(1.0, 0.0)) - Height(grid - vec2(1.0, 0.0));
+	float dy = Height(grid + vec2(0.0, 1.0)) - Height(grid - vec2(0.0, 1.0));
+	Normal = normalize(vec3(-dx, 2.0 * terrainSpacing * chunk.scale, dy));
+	TexCoords = (chunk.origin + grid * chunk.scale) / terrainLast;
+}
@@ -0,0 +1,54 @@
+// Sampling of a VirtualTexture. The page table maps every page of every level to a
+// physical slot, or to the slot of its nearest resident ancestor; each sample also
+// marks the page it wanted in the feedback buffer.
+
+#define VT_MAX_LEVELS 16
+
+layout(std430, binding = 5) readonly buffer VirtualPageTable {
+    uint vtPageTable[];
+};
+layout(std430, binding = 6) writeonly buffer VirtualFeedback {
+    uint vtFeedback[];
+};
+
+uniform sampler2D vtPhysical;
+uniform uvec2 vtSize;
+uniform uint vtPageSize;
+uniform uint vtBorder;
+uniform int vtLevels;
+uniform uint vtLevelOffset[VT_MAX_LEVELS];
+
+uvec2 VirtualLevelSize(int level) {
+    return max(vtSize >> uint(level), uvec2(1));
+}
+
+uvec2 VirtualLevelPages(int level) {
+    return (VirtualLevelSize(level) + vtPageSize - 1u) / vtPageSize;
+}
+
+uvec2 VirtualPage(int level, vec2 uv) {
+    uvec2 texel = uvec2(uv * vec2(VirtualLevelSize(level)));
+    return min(texel / vtPageSize, VirtualLevelPages(level) - 1u);
+}
+
+vec4 SampleVirtual(vec2 uv) {
+    uv = clamp(uv, 0.0, 1.0);
+    vec2 texels = uv * vec2(vtSize);
+    vec2 dx = dFdx(texels), dy = dFdy(texels);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    int level = clamp(int(floor(lod)), 0, vtLevels - 1);
+
+    uvec2 page = VirtualPage(level, uv);
+    uint index = vtLevelOffset[level] + page.y * VirtualLevelPages(level).x + page.x;
+    vtFeedback[index] = 1u;
+
+    uint entry = vtPageTable[index];
+    vec2 slot = vec2(entry & 0xffu, (entry >> 8) & 0xffu);
+    int resident = int((entry >> 16) & 0xffu);
+
+    vec2 local = uv * vec2(VirtualLevelSize(resident)) -
+                 vec2(VirtualPage(resident, uv) * vtPageSize);
+    float stride = float(vtPageSize + 2u * vtBorder);
+    vec2 physical = slot * stride + float(vtBorder) + local;
+    return textureLod(vtPhysical, physical / vec2(textureSize(vtPhysical, 0)), 0.0);
+}
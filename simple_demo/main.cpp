@@ -50,17 +50,18 @@ const char FS_SOURCE[] = R"(
     }
 )";
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
+                  int /*mods*/) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     if (width && height)
         glViewport(0, 0, width, height);
 }
 
-int LGL_TMAIN(int argc, LGL_TCHAR* argv[]) {
+int LGL_TMAIN(int /*argc*/, LGL_TCHAR* /*argv*/[]) {
     try {
         err::check_glfw(glfwInit(), "failed to init GLFW: {}");
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
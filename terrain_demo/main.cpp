@@ -0,0 +1,188 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "common/compat.h"
+#include "common/errutils.h"
+#include "common/glutils.h"
+#include "common/lights.h"
+#include "common/raii.h"
+#include "common/shader.h"
+#include "common/terrain.h"
+#include "common/terrain_tiles.h"
+#include "common/thread_pool.h"
+#include "common/vfs.h"
+
+namespace fs = std::filesystem;
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+const float ZNEAR = 1.f;
+const float ZFAR = 20000.f;
+const float FOV = glm::radians(45.f);
+
+const glm::vec4 BG_COLOR = glm::convertSRGBToLinear(glm::vec4{0.6f, 0.75f, 0.9f, 1.0f});
+
+// Heightmap samples per side and world units between them
+const uint32_t HEIGHTMAP_SIZE = 4097;
+const float SPACING = 2.f;
+const float HEIGHT_SCALE = 800.f;
+
+// Toggled with F
+bool wireframe = false;
+
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
+                  int /*mods*/) {
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+        wireframe = !wireframe;
+}
+
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
+    if (width && height)
+        glViewport(0, 0, width, height);
+}
+
+float hash_noise(int x, int y) {
+    uint32_t h = uint32_t(x) * 0x8da6b343u ^ uint32_t(y) * 0xd8163841u;
+    h = (h ^ h >> 13) * 0x5bd1e995u;
+    return float(h ^ h >> 15) / float(UINT32_MAX);
+}
+
+float value_noise(glm::vec2 p) {
+    glm::vec2 cell = glm::floor(p), f = p - cell;
+    glm::vec2 t = f * f * (3.f - 2.f * f);
+    int x = int(cell.x), y = int(cell.y);
+    return glm::mix(glm::mix(hash_noise(x, y), hash_noise(x + 1, y), t.x),
+                    glm::mix(hash_noise(x, y + 1), hash_noise(x + 1, y + 1), t.x), t.y);
+}
+
+// Ridged fractal noise, squared so valleys flatten out
+std::vector<uint16_t> generate_heightmap(uint32_t size, ThreadPool& pool) {
+    std::vector<uint16_t> heights(size_t(size) * size);
+    pool.parallel_for(size_t(size), [&](size_t y) {
+        for (uint32_t x = 0; x < size; x++) {
+            glm::vec2 p = glm::vec2(x, y) / 512.f;
+            float sum = 0, amplitude = 0.5f;
+            for (int octave = 0; octave < 9; octave++) {
+                sum += amplitude * (1 - std::abs(2 * value_noise(p) - 1));
+                p *= 2.03f;
+                amplitude *= 0.5f;
+            }
+            heights[y * size + x] = uint16_t(glm::clamp(sum * sum, 0.f, 1.f) * UINT16_MAX);
+        }
+    }, 16);
+    return heights;
+}
+
+void run(const fs::path& exe_path) {
+    fs::path root = exe_path.parent_path();
+    ThreadPool pool;
+    // Built by the resources_pack target; loose files are used without it. Compressed
+    // entries are decompressed on the pool, so unmount before it goes away.
+    vfs::mount_if_exists(root / "resources.pack", root / "resources", &pool);
+    ScopeGuardFn<vfs::unmount_all> unmount;
+
+    err::check_glfw(glfwInit(), "failed to init GLFW: {}");
+    ScopeGuardFn<glfwTerminate> guard;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = err::check_glfw(
+        glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "LearnOpenGL", nullptr, nullptr),
+        "failed to create GLFW window: {}");
+    glfwMakeContextCurrent(window);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+    err::check_glfw(gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)),
+                    "failed to load GL loader: {}");
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+
+    Shader shader = Shader::load(root / "resources/shaders/terrain.vs",
+                                 root / "resources/shaders/terrain.fs");
+
+    // The tile file is generated once next to the executable
+    fs::path tile_file = root / "terrain.tiles";
+    if (!fs::exists(tile_file)) {
+        std::cout << "Generating " << tile_file.string() << "\n";
+        build_terrain_file(generate_heightmap(HEIGHTMAP_SIZE, pool), HEIGHTMAP_SIZE,
+                           HEIGHTMAP_SIZE, tile_file, pool);
+    }
+    Terrain terrain(tile_file, pool, {.spacing = SPACING, .height_scale = HEIGHT_SCALE});
+
+    DirLight light{.direction = {-1, -0.6f, -0.4f},
+                   .ambient = glm::vec3(0.15f),
+                   .diffuse = glm::vec3(1.f, 0.95f, 0.85f)};
+    double last_title_time = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        glClearColor(BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, BG_COLOR.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto [_x, _y, width, height] = util::gl_get<float, 4>(GL_VIEWPORT);
+        float aspect = width / height;
+        glm::mat4 projection = glm::perspective(FOV, aspect, ZNEAR, ZFAR);
+
+        // Circle the middle of the map above most peaks, looking ahead and down
+        float angle = float(glfwGetTime()) * 0.05f;
+        float radius = 0.25f * SPACING * float(HEIGHTMAP_SIZE);
+        glm::vec3 eye{radius * std::cos(angle), 0.9f * HEIGHT_SCALE,
+                      -radius * std::sin(angle)};
+        glm::vec3 ahead{-std::sin(angle), -0.35f, -std::cos(angle)};
+        glm::mat4 view = glm::lookAt(eye, eye + ahead, {0, 1, 0});
+
+        terrain.update(eye, projection * view);
+
+        shader.use();
+        shader.set_mat4("projection", projection);
+        shader.set_mat4("view", view);
+        shader.set_vec3("viewPos", eye);
+        light.apply(shader, "light");
+        glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+        terrain.draw(shader, 0);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        double time = glfwGetTime();
+        if (time - last_title_time > 0.5) {
+            last_title_time = time;
+            Terrain::Stats stats = terrain.stats();
+            std::string title = std::format(
+                "LearnOpenGL - {} chunks, {} tiles resident, {} loading, {} uploaded",
+                stats.chunks, stats.resident, stats.loading, stats.uploaded);
+            glfwSetWindowTitle(window, title.c_str());
+        }
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+}
+
+int LGL_TMAIN(int argc, LGL_TCHAR* argv[]) {
+    try {
+        run(fs::canonical(argc ? argv[0] : fs::path()));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
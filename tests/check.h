@@ -0,0 +1,34 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+#include <print>
+#include <source_location>
+#include <string_view>
+
+// Just enough of a test framework for the CPU tests: CHECK reports each failed condition
+// and keeps going, and main returns test::result().
+namespace test {
+
+inline int failures = 0;
+
+inline void check(bool condition, std::string_view expression,
+                  std::source_location location = std::source_location::current()) {
+    if (condition)
+        return;
+    std::println(stderr, "{}:{}: check failed: {}", location.file_name(), location.line(),
+                 expression);
+    failures++;
+}
+
+inline int result() {
+    if (failures > 0)
+        std::println(stderr, "{} checks failed", failures);
+    return failures > 0 ? 1 : 0;
+}
+
+} // namespace test
+
+#define CHECK(...) test::check(bool(__VA_ARGS__), #__VA_ARGS__)
+
+#endif // CHECK_H
@@ -0,0 +1,150 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <print>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "common/dynamic_buffer.h"
+#include "common/lights.h"
+#include "common/material.h"
+#include "common/model.h"
+#include "common/primitives.h"
+#include "common/raii.h"
+#include "common/render_queue.h"
+#include "common/shader_variants.h"
+#include "common/thread_pool.h"
+#include "tests/check.h"
+
+// Every allocation through the global operator new, from any thread
+std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+// GCC takes the free() in a replaced operator delete for a mismatched deallocation
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+// ctest's SKIP_RETURN_CODE for machines without a GL 4.5 context
+constexpr int SKIPPED = 77;
+constexpr int WARMUP_FRAMES = 5, MEASURED_FRAMES = 20;
+
+// Records and submits a crowd through RenderQueue, then sorts and draws a model
+// through Model::draw, like model_demo's two forward paths. Once every shader
+// permutation is built and the arenas and queues have grown to a frame's size, neither
+// may allocate.
+void test_frame_allocations(ThreadPool& pool) {
+    ShaderDefines defines{{"NUM_DIR_LIGHTS", "1"},
+                          {"NUM_POINT_LIGHTS", "0"},
+                          {"NUM_SPOT_LIGHTS", "0"}};
+    ShaderVariants shaders(RESOURCES_DIR "/shaders/shader.vs",
+                           RESOURCES_DIR "/shaders/shader.fs", defines);
+    defines.append_range(RenderQueue::per_draw_defines());
+    ShaderVariants crowd_shaders(RESOURCES_DIR "/shaders/shader.vs",
+                                 RESOURCES_DIR "/shaders/shader.fs", defines);
+
+    auto matte = std::make_shared<Material>();
+    matte->diffuse_color = {0.8f, 0.3f, 0.2f};
+    matte->update_features();
+    auto shiny = std::make_shared<Material>();
+    shiny->specular_color = glm::vec3(1);
+    shiny->shininess = 32.f;
+    shiny->update_features();
+    auto cube = std::make_shared<Mesh>(make_cube());
+    cube->set_material(matte);
+    auto sphere = std::make_shared<Mesh>(make_sphere(16, 32));
+    sphere->set_material(shiny);
+    Model model({cube, sphere}, {matte, shiny});
+
+    std::vector<SceneObject> crowd;
+    for (int z = 0; z < 20; z++) {
+        for (int x = 0; x < 20; x++)
+            crowd.push_back({&model, glm::translate(glm::mat4(1), glm::vec3(x, 0, -z))});
+    }
+    RenderQueue queue(pool);
+    DynamicBuffer per_draw(GL_UNIFORM_BUFFER, 1 << 20);
+    DirLight lights[] = {{.direction = {-1, -1, -1}}};
+    glm::mat4 view = glm::lookAt(glm::vec3(10, 8, 10), glm::vec3(10, 0, -10), {0, 1, 0});
+    glm::mat4 projection = glm::perspective(glm::radians(45.f), 4.f / 3.f, 0.1f, 100.f);
+
+    auto frame = [&] {
+        queue.record(pool, crowd, view, projection);
+        per_draw.begin_frame();
+        queue.submit(crowd_shaders,
+                     [&](const Shader& shader) {
+                         shader.set_mat4("projection", projection);
+                         shader.set_mat4("view", view);
+                         apply_array(shader, "dirLights", lights);
+                     },
+                     &per_draw);
+        per_draw.end_frame();
+        model.sort_front_to_back(view);
+        model.draw(shaders, [&](const Shader& shader) {
+            shader.set_mat4("projection", projection);
+            shader.set_mat4("view", view);
+            shader.set_mat4("model", glm::mat4(1));
+            apply_array(shader, "dirLights", lights);
+        });
+        glFinish();
+    };
+    for (int i = 0; i < WARMUP_FRAMES; i++)
+        frame();
+    CHECK(!queue.packets().empty());
+    size_t before = allocations.load();
+    for (int i = 0; i < MEASURED_FRAMES; i++)
+        frame();
+    size_t allocated = allocations.load() - before;
+    if (allocated > 0)
+        std::println(stderr, "{} allocations in {} frames", allocated, MEASURED_FRAMES);
+    CHECK(allocated == 0);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+} // namespace
+
+int main() {
+    if (!glfwInit()) {
+        std::println("skipped: GLFW is unavailable");
+        return SKIPPED;
+    }
+    ScopeGuardFn<glfwTerminate> guard;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(640, 480, "draw_allocations_test", nullptr, nullptr);
+    if (!window) {
+        std::println("skipped: no GL 4.5 context");
+        return SKIPPED;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+        std::println("skipped: failed to load GL");
+        return SKIPPED;
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    ThreadPool pool(4);
+    test_frame_allocations(pool);
+    return test::result();
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common/environment_map.h"
+#include "common/thread_pool.h"
+#include "tests/check.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const glm::vec3 RADIANCE{0.5f, 1.f, 2.f};
+
+bool near(glm::vec3 a, glm::vec3 b, float tolerance) {
+    return glm::all(glm::lessThanEqual(glm::abs(a - b), glm::vec3(tolerance)));
+}
+
+// Whether every texel of every face of the given levels is near color
+bool is_constant(const CubemapData& cubemap, glm::vec3 color, float tolerance) {
+    for (auto& level : cubemap.levels) {
+        for (auto& face : level) {
+            for (size_t i = 0; i < face.size(); i += 3) {
+                if (!near({face[i], face[i + 1], face[i + 2]}, color, tolerance))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A sky of constant radiance stays constant through every step of the bake, and its
+// irradiance is the radiance itself, all in the constant band
+void test_constant_radiance(ThreadPool& pool) {
+    FloatImage equirect{64, 32, {}};
+    for (int i = 0; i < equirect.width * equirect.height; i++)
+        equirect.pixels.insert(equirect.pixels.end(), {RADIANCE.r, RADIANCE.g, RADIANCE.b});
+
+    CubemapData radiance = equirect_to_cubemap(equirect, 16, pool);
+    CHECK(radiance.levels.size() == 1);
+    generate_cubemap_mips(radiance, pool);
+    CHECK(radiance.levels.size() == 5);
+    CHECK(is_constant(radiance, RADIANCE, 1e-5f));
+
+    CubemapData specular = prefilter_specular(radiance, 4, 32, pool);
+    CHECK(specular.levels.size() == 4);
+    CHECK(is_constant(specular, RADIANCE, 1e-4f));
+
+    // Evaluated as ibl.glsl does, the constant band alone gives the radiance back
+    SH9 sh = project_irradiance(radiance, pool);
+    CHECK(near(sh[0] * 0.282095f, RADIANCE, 1e-4f));
+    bool higher_bands_zero = true;
+    for (int i = 1; i < 9; i++)
+        higher_bands_zero = higher_bands_zero && near(sh[i], glm::vec3(0), 1e-3f);
+    CHECK(higher_bands_zero);
+}
+
+// Radiance RGBE of a color, as a flat (not run-length encoded) .hdr file stores it
+std::array<uint8_t, 4> to_rgbe(glm::vec3 color) {
+    float max = std::max({color.r, color.g, color.b});
+    if (max < 1e-30f)
+        return {0, 0, 0, 0};
+    int exponent;
+    float scale = std::frexp(max, &exponent) * 256.f / max;
+    return {uint8_t(color.r * scale), uint8_t(color.g * scale), uint8_t(color.b * scale),
+            uint8_t(exponent + 128)};
+}
+
+// A sky brightening toward the top, with tint changing the horizon's color
+void write_sky(const fs::path& path, glm::vec3 tint) {
+    const int WIDTH = 64, HEIGHT = 32;
+    std::ofstream file(path, std::ios::binary);
+    file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << HEIGHT << " +X " << WIDTH << "\n";
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            float up = 1.f - float(y) / HEIGHT;
+            glm::vec3 color = glm::mix(tint, glm::vec3(0.3f, 0.5f, 4.f), up);
+            color *= 1.f + 0.25f * std::sin(float(x) * 0.2f);
+            auto rgbe = to_rgbe(color);
+            file.write(reinterpret_cast<const char*>(rgbe.data()), 4);
+        }
+    }
+}
+
+bool same_bits(const EnvironmentData& a, const EnvironmentData& b) {
+    if (std::memcmp(a.irradiance.data(), b.irradiance.data(), sizeof(SH9)) != 0 ||
+        a.specular.levels.size() != b.specular.levels.size())
+        return false;
+    for (size_t level = 0; level < a.specular.levels.size(); level++) {
+        for (size_t face = 0; face < 6; face++) {
+            if (a.specular.levels[level][face] != b.specular.levels[level][face])
+                return false;
+        }
+    }
+    return true;
+}
+
+// Overwrites the cached last texel, so a load that reads the cache gives it back
+const float MARKER = 12345.f;
+
+void mark_cache(const fs::path& cache_path) {
+    std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-std::streamoff(sizeof(float)), std::ios::end);
+    file.write(reinterpret_cast<const char*>(&MARKER), sizeof(float));
+}
+
+bool has_marker(const EnvironmentData& data) {
+    return data.specular.levels.back()[5].back() == MARKER;
+}
+
+// A bake reloads from its cache bit for bit, and the cache is baked over once it no
+// longer matches its header, the options or the source image
+void test_cache(const fs::path& dir, ThreadPool& pool) {
+    fs::path sky = dir / "sky.hdr", cache = dir / "sky.env";
+    write_sky(sky, {1.f, 0.6f, 0.2f});
+    EnvironmentOpts opts{.face_size = 16, .levels = 3, .samples = 16};
+
+    EnvironmentData baked = load_environment(sky, cache, pool, opts);
+    CHECK(fs::exists(cache));
+    CHECK(same_bits(load_environment(sky, cache, pool, opts), baked));
+    mark_cache(cache);
+    CHECK(has_marker(load_environment(sky, cache, pool, opts)));
+
+    // A header that isn't this version's
+    {
+        std::fstream file(cache, std::ios::in | std::ios::out | std::ios::binary);
+        file.write("XXXX", 4);
+    }
+    CHECK(same_bits(load_environment(sky, cache, pool, opts), baked));
+
+    mark_cache(cache);
+    EnvironmentOpts more_samples = opts;
+    more_samples.samples = 32;
+    CHECK(!has_marker(load_environment(sky, cache, pool, more_samples)));
+    CHECK(same_bits(load_environment(sky, cache, pool, opts), baked));
+
+    // The same size of image with other contents
+    mark_cache(cache);
+    write_sky(sky, {0.2f, 0.6f, 1.f});
+    EnvironmentData rebaked = load_environment(sky, cache, pool, opts);
+    CHECK(!has_marker(rebaked));
+    CHECK(!same_bits(rebaked, baked));
+}
+
+// The split-sum scale and bias reflect at most all of the light, so they sum to at
+// most one at every angle and roughness
+void test_brdf_lut(const fs::path& dir, ThreadPool& pool) {
+    BrdfLut lut = compute_brdf_lut(32, 128, pool);
+    CHECK(lut.size == 32);
+    CHECK(lut.texels.size() == 32 * 32 * 2);
+    bool bounded = true;
+    for (size_t i = 0; i < lut.texels.size(); i += 2) {
+        float scale = lut.texels[i], bias = lut.texels[i + 1];
+        bounded = bounded && scale >= 0 && bias >= 0 && scale + bias <= 1.f;
+    }
+    CHECK(bounded);
+
+    fs::path cache = dir / "brdf.lut";
+    BrdfLut computed = load_brdf_lut(cache, pool, 32, 128);
+    CHECK(computed.texels == lut.texels);
+    CHECK(load_brdf_lut(cache, pool, 32, 128).texels == lut.texels);
+}
+
+} // namespace
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / "environment_map_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    ThreadPool pool(4);
+    test_constant_radiance(pool);
+    test_cache(dir, pool);
+    test_brdf_lut(dir, pool);
+    fs::remove_all(dir);
+    return test::result();
+}
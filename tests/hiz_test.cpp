@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "common/bounds.h"
+#include "common/hiz.h"
+#include "tests/check.h"
+
+namespace {
+
+// Depth values in [0, 1) that look irregular
+std::vector<float> scrambled_depth(int width, int height) {
+    std::vector<float> depth(size_t(width) * height);
+    uint32_t state = 12345;
+    for (float& d : depth) {
+        state = state * 1664525 + 1013904223;
+        d = float(state >> 8) / float(1 << 24);
+    }
+    return depth;
+}
+
+// Each texel is the max of exactly the texels below it: texel (x, y) of a level covers
+// (x/2, y/2) of the next, with odd last rows and columns folded into the last texel
+void test_reduction(int width, int height) {
+    std::vector<float> depth = scrambled_depth(width, height);
+    HiZPyramid pyramid(depth, width, height);
+    CHECK(pyramid.num_levels() == hiz_num_levels(width, height));
+    CHECK(pyramid.level_size(0) == glm::ivec2(width, height));
+    CHECK(pyramid.level_size(pyramid.num_levels() - 1) == glm::ivec2(1, 1));
+    CHECK(pyramid.at(pyramid.num_levels() - 1, 0, 0) == std::ranges::max(depth));
+
+    for (int level = 1; level < pyramid.num_levels(); level++) {
+        glm::ivec2 src = pyramid.level_size(level - 1);
+        glm::ivec2 dst = pyramid.level_size(level);
+        CHECK(dst == glm::max(src / 2, glm::ivec2(1)));
+        std::vector<float> expected(size_t(dst.x) * dst.y, 0.f);
+        for (int y = 0; y < src.y; y++) {
+            for (int x = 0; x < src.x; x++) {
+                int dx = std::min(x / 2, dst.x - 1), dy = std::min(y / 2, dst.y - 1);
+                float& e = expected[size_t(dy) * dst.x + dx];
+                e = std::max(e, pyramid.at(level - 1, x, y));
+            }
+        }
+        bool same = true;
+        for (int y = 0; y < dst.y; y++)
+            for (int x = 0; x < dst.x; x++)
+                same = same && pyramid.at(level, x, y) == expected[size_t(y) * dst.x + x];
+        CHECK(same);
+    }
+}
+
+// A 5x3 buffer reduces to 2x1: the first texel covers columns 0-1, the second 2-4
+void test_odd_fold() {
+    std::vector<float> depth(5 * 3, 0.1f);
+    depth[2 * 5 + 4] = 0.9f;
+    depth[0] = 0.5f;
+    HiZPyramid pyramid(depth, 5, 3);
+    CHECK(pyramid.num_levels() == 3);
+    CHECK(pyramid.level_size(1) == glm::ivec2(2, 1));
+    CHECK(pyramid.at(1, 0, 0) == 0.5f);
+    CHECK(pyramid.at(1, 1, 0) == 0.9f);
+    CHECK(pyramid.at(2, 0, 0) == 0.9f);
+}
+
+// A wall 10 units away covers the left half of the screen; the right half is clear
+void test_visible() {
+    const int SIZE = 64;
+    glm::mat4 projection = glm::perspective(glm::radians(90.f), 1.f, 1.f, 100.f);
+    glm::vec4 wall = projection * glm::vec4(0, 0, -10, 1);
+    float wall_depth = wall.z / wall.w * 0.5f + 0.5f;
+    std::vector<float> depth(size_t(SIZE) * SIZE);
+    for (int y = 0; y < SIZE; y++)
+        for (int x = 0; x < SIZE; x++)
+            depth[size_t(y) * SIZE + x] = x < SIZE / 2 ? wall_depth : 1.f;
+    HiZPyramid pyramid(depth, SIZE, SIZE);
+
+    auto visible = [&](glm::vec3 min, glm::vec3 max) {
+        return pyramid.visible(Bounds{min, max}, projection);
+    };
+    // Behind the wall
+    CHECK(!visible({-15, -3, -30}, {-5, 3, -20}));
+    // In front of the wall
+    CHECK(visible({-4, -1, -8}, {-2, 1, -6}));
+    // Behind the wall but reaching into the clear half
+    CHECK(visible({-5, -3, -30}, {5, 3, -20}));
+    // Behind the clear half
+    CHECK(visible({5, -3, -30}, {15, 3, -20}));
+    // Outside the frustum
+    CHECK(!visible({200, -1, -30}, {210, 1, -20}));
+    // Crossing the near plane, so it can't be projected
+    CHECK(visible({-15, -1, -30}, {-5, 1, 5}));
+
+    // The same boxes moved by a model-view-projection instead
+    glm::mat4 model = glm::translate(glm::mat4(1), {-10, 0, -25});
+    CHECK(!pyramid.visible(Bounds{{-5, -3, -5}, {5, 3, 5}}, projection * model));
+    model = glm::translate(glm::mat4(1), {10, 0, -25});
+    CHECK(pyramid.visible(Bounds{{-5, -3, -5}, {5, 3, 5}}, projection * model));
+}
+
+} // namespace
+
+int main() {
+    test_reduction(64, 64);
+    test_reduction(7, 5);
+    test_reduction(13, 6);
+    test_reduction(5, 1);
+    test_reduction(1, 9);
+    test_reduction(1, 1);
+    test_odd_fold();
+    test_visible();
+    return test::result();
+}
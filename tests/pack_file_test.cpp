@@ -0,0 +1,133 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/pack_file.h"
+#include "common/thread_pool.h"
+#include "common/vfs.h"
+#include "tests/check.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct TestFile {
+    std::string name;
+    std::vector<std::byte> bytes;
+};
+
+// Repetitive bytes that compress well, or noise that doesn't
+std::vector<std::byte> make_bytes(size_t size, bool compressible, uint32_t seed) {
+    std::vector<std::byte> bytes(size);
+    uint32_t state = seed;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1664525u + 1013904223u;
+        bytes[i] = std::byte(compressible ? i / 64 % 7 : state >> 24);
+    }
+    return bytes;
+}
+
+void write_file(const fs::path& path, std::span<const std::byte> bytes) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+}
+
+bool equal(std::span<const std::byte> a, std::span<const std::byte> b) {
+    return std::ranges::equal(a, b);
+}
+
+// Packs files of several sizes, spanning chunks, with codec and reads them back
+void test_round_trip(const fs::path& dir, PackCodec codec, ThreadPool& pool) {
+    std::vector<TestFile> files = {
+        {"empty", {}},
+        {"small.txt", make_bytes(100, true, 1)},
+        {"textures/noise.bin", make_bytes(PACK_CHUNK_SIZE + 17, false, 2)},
+        {"textures/tiles.bin", make_bytes(3 * PACK_CHUNK_SIZE + 5, true, 3)},
+        {"models/exact.bin", make_bytes(2 * PACK_CHUNK_SIZE, true, 4)},
+    };
+    std::vector<PackInput> inputs;
+    for (const TestFile& file : files) {
+        fs::path source = dir / "loose" / file.name;
+        write_file(source, file.bytes);
+        inputs.push_back({file.name, source, codec});
+    }
+    fs::path pack_path = dir / "test.pack";
+    write_pack(inputs, pack_path, pool);
+    // Written twice: the second write replaces the pack the first PackFile maps
+    PackFile old_pack(pack_path);
+    write_pack(inputs, pack_path, pool);
+    CHECK(!fs::exists(fs::path(pack_path) += ".tmp"));
+
+    for (ThreadPool* read_pool : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        PackFile pack(pack_path, read_pool);
+        CHECK(pack.entries().size() == files.size());
+        CHECK(!pack.find("missing"));
+        CHECK(!pack.find("textures"));
+        for (const TestFile& file : files) {
+            const PackEntry* entry = pack.find(file.name);
+            CHECK(entry);
+            if (!entry)
+                continue;
+            CHECK(pack.name(*entry) == file.name);
+            CHECK(entry->size == file.bytes.size());
+            CHECK(entry->offset % PACK_ALIGNMENT == 0);
+            CHECK(equal(pack.read(*entry), file.bytes));
+            if (entry->codec == PackCodec::Stored)
+                CHECK(equal(pack.view(*entry), file.bytes));
+            if (read_pool)
+                CHECK(equal(pack.read_async(*entry).get(), file.bytes));
+        }
+        if (codec != PackCodec::Stored) {
+            // Noise doesn't shrink enough to be worth compressing
+            CHECK(pack.find("textures/noise.bin")->codec == PackCodec::Stored);
+            CHECK(pack.find("textures/tiles.bin")->codec == codec);
+            CHECK(pack.find("textures/tiles.bin")->num_chunks == 4);
+        }
+    }
+    CHECK(equal(old_pack.read(*old_pack.find("small.txt")), files[1].bytes));
+
+    // Async reads outlive the entries passed in, and the pack waits for them
+    std::vector<std::future<std::vector<std::byte>>> reads;
+    {
+        PackFile pack(pack_path, &pool);
+        for (const TestFile& file : files) {
+            PackEntry entry = *pack.find(file.name);
+            reads.push_back(pack.read_async(entry));
+        }
+    }
+    for (size_t i = 0; i < files.size(); i++)
+        CHECK(equal(reads[i].get(), files[i].bytes));
+
+    // The vfs serves mounted files from the pack, and the rest from disk
+    auto pack = std::make_shared<const PackFile>(pack_path, &pool);
+    fs::path root = dir / "mounted";
+    vfs::mount(pack, root);
+    CHECK(vfs::exists(root / "textures/tiles.bin"));
+    CHECK(!vfs::exists(root / "textures/missing.bin"));
+    CHECK(equal(vfs::read(root / "textures/tiles.bin").bytes(), files[3].bytes));
+    CHECK(equal(vfs::read_copy(root / "small.txt").bytes(), files[1].bytes));
+    CHECK(equal(vfs::read(dir / "loose/small.txt").bytes(), files[1].bytes));
+    vfs::unmount_all();
+    CHECK(!vfs::exists(root / "small.txt"));
+}
+
+} // namespace
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / "pack_file_test";
+    fs::remove_all(dir);
+    ThreadPool pool(4);
+    for (PackCodec codec : {PackCodec::Stored, PackCodec::LZ4, PackCodec::Zstd}) {
+        if (pack_codec_supported(codec))
+            test_round_trip(dir, codec, pool);
+    }
+    fs::remove_all(dir);
+    return test::result();
+}
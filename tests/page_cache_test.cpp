@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "common/page_cache.h"
+#include "tests/check.h"
+
+namespace {
+
+// Fills every slot, then checks that a full cache evicts the least recently used page
+void test_lru_eviction() {
+    PageCache cache(3);
+    const PageId a{0, 0, 0}, b{0, 1, 0}, c{0, 2, 0}, d{0, 3, 0};
+    std::array<uint32_t, 3> slots;
+    for (size_t i = 0; PageId page : {a, b, c}) {
+        auto placement = cache.insert(page);
+        CHECK(placement && !placement->evicted);
+        slots[i++] = placement->slot;
+    }
+    // Low slots are handed out first
+    CHECK(slots == std::array<uint32_t, 3>{0, 1, 2});
+    CHECK(cache.size() == 3);
+
+    // Touching a makes b the least recently used
+    cache.begin_frame();
+    PageId used[] = {a};
+    CHECK(cache.touch(used).empty());
+    cache.begin_frame();
+    auto placement = cache.insert(d);
+    CHECK(placement && placement->evicted == b);
+    CHECK(placement && placement->slot == slots[1]);
+    CHECK(!cache.slot(b));
+    CHECK(cache.slot(d) == slots[1]);
+    CHECK(cache.slot(a) == slots[0]);
+    CHECK(cache.size() == 3);
+}
+
+// Pages used in the current frame and pinned pages are never evicted
+void test_protected_pages() {
+    PageCache cache(2);
+    const PageId root{3, 0, 0}, a{0, 0, 0}, b{0, 1, 0};
+    CHECK(cache.insert(root, true));
+    CHECK(cache.insert(a));
+    // a was inserted this frame
+    CHECK(!cache.insert(b));
+
+    cache.begin_frame();
+    auto placement = cache.insert(b);
+    CHECK(placement && placement->evicted == a);
+    cache.begin_frame();
+    // The cache holds the pinned root and b, which is used this frame
+    PageId used[] = {b};
+    cache.touch(used);
+    CHECK(!cache.insert(a));
+    CHECK(cache.slot(root));
+    // Inserting a resident page is refused
+    cache.begin_frame();
+    CHECK(!cache.insert(b));
+}
+
+// touch reports missing pages coarsest level first
+void test_touch_order() {
+    PageCache cache(4);
+    const PageId resident{1, 0, 0};
+    cache.insert(resident);
+    PageId pages[] = {{0, 5, 5}, resident, {2, 0, 0}, {0, 1, 1}, {1, 1, 0}};
+    std::vector<PageId> missing = cache.touch(pages);
+    CHECK(missing.size() == 4);
+    for (size_t i = 1; i < missing.size(); i++)
+        CHECK(missing[i - 1].level >= missing[i].level);
+    CHECK(!std::ranges::contains(missing, resident));
+}
+
+void test_keys() {
+    PageId page{7, 4095, 123};
+    CHECK(PageId::from_key(page.key()) == page);
+}
+
+} // namespace
+
+int main() {
+    test_lru_eviction();
+    test_protected_pages();
+    test_touch_order();
+    test_keys();
+    return test::result();
+}
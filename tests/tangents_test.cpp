@@ -0,0 +1,172 @@
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common/primitives.h"
+#include "common/tangents.h"
+#include "common/thread_pool.h"
+#include "tests/check.h"
+
+namespace {
+
+// Round trips a tangent in every octant, on the axes and across the octahedron's fold
+void test_round_trip() {
+    for (int i = 0; i < 4096; i++) {
+        float theta = std::acos(1.f - 2.f * (float(i) + 0.5f) / 4096.f);
+        float phi = float(i) * 2.39996323f;
+        glm::vec3 t(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi),
+                    std::cos(theta));
+        float sign = i % 2 ? -1.f : 1.f;
+        glm::vec4 unpacked = unpack_tangent(pack_tangent(t, sign));
+        CHECK(glm::dot(glm::vec3(unpacked), t) > 0.99999f);
+        CHECK(unpacked.w == sign);
+    }
+    for (glm::vec3 axis : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+                           glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)})
+        CHECK(glm::dot(glm::vec3(unpack_tangent(pack_tangent(axis, 1.f))), axis) > 0.99999f);
+}
+
+// Length doesn't matter, and a zero tangent still decodes to a unit vector
+void test_unnormalized() {
+    glm::vec3 t = glm::normalize(glm::vec3(0.3f, -0.5f, -0.8f));
+    CHECK(pack_tangent(t * 7.f, 1.f) == pack_tangent(t, 1.f));
+    glm::vec4 zero = unpack_tangent(pack_tangent(glm::vec3(0), 1.f));
+    CHECK(std::abs(glm::length(glm::vec3(zero)) - 1.f) < 1e-5f);
+}
+
+// Static meshes rely on pack_tangent being usable in constant expressions
+static_assert(pack_tangent({1, 0, 0}, -1.f) >> 31 == 1);
+static_assert(pack_tangent({1, 0, 0}, 1.f) >> 31 == 0);
+
+// Whether v's generated tangent is close to tangent with the given bitangent sign
+bool has_tangent(const Vertex& v, glm::vec3 tangent, float sign, float min_dot = 0.9999f) {
+    glm::vec4 unpacked = unpack_tangent(v.tangent);
+    return glm::dot(glm::vec3(unpacked), glm::normalize(tangent)) > min_dot &&
+           unpacked.w == sign;
+}
+
+// A UV sphere's tangents follow the longitude lines, as write_sphere gives them
+// analytically. Rows next to the poles are left out: their triangles are slivers.
+void test_sphere(ThreadPool& pool) {
+    const int NLAT = 64, NLON = 128;
+    MeshSize size = sphere_size(NLAT, NLON);
+    std::vector<Vertex> expected(size.vertices);
+    std::vector<unsigned int> indices(size.indices);
+    write_sphere(NLAT, NLON, expected, indices);
+
+    std::vector<Vertex> serial = expected, parallel = expected;
+    for (size_t i = 0; i < expected.size(); i++)
+        serial[i].tangent = parallel[i].tangent = 0;
+    generate_tangents(serial, indices);
+    generate_tangents(parallel, indices, &pool);
+    bool close = true, same = true;
+    for (int i = 2; i <= NLAT - 2; i++) {
+        for (int j = 0; j <= NLON; j++) {
+            size_t v = size_t(i) * (NLON + 1) + j;
+            glm::vec4 analytic = unpack_tangent(expected[v].tangent);
+            close = close && has_tangent(serial[v], glm::vec3(analytic), analytic.w, 0.999f);
+        }
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+        same = same && serial[i].tangent == parallel[i].tangent;
+    CHECK(close);
+    CHECK(same);
+}
+
+// A quad in the xy plane facing +z, with texture coordinates from map(x, y)
+std::vector<Vertex> make_quad(glm::vec2 (*map)(glm::vec2)) {
+    std::vector<Vertex> vertices;
+    for (glm::vec2 p : {glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1)})
+        vertices.push_back({glm::vec3(p, 0), {0, 0, 1}, map(p)});
+    return vertices;
+}
+
+// On a flat quad the tangent is the direction u grows in, and the bitangent sign says
+// whether v grows along cross(normal, tangent) or against it
+void test_quad() {
+    const std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+    std::vector<Vertex> plain = make_quad([](glm::vec2 p) { return p; });
+    generate_tangents(plain, indices);
+    for (const Vertex& v : plain)
+        CHECK(has_tangent(v, {1, 0, 0}, 1.f));
+
+    // Rotated a quarter turn: u grows along +y, v along -x
+    std::vector<Vertex> rotated = make_quad([](glm::vec2 p) { return glm::vec2(p.y, -p.x); });
+    generate_tangents(rotated, indices);
+    for (const Vertex& v : rotated)
+        CHECK(has_tangent(v, {0, 1, 0}, 1.f));
+
+    // Mirrored in u, as on the second half of a symmetric model's atlas
+    std::vector<Vertex> mirrored = make_quad([](glm::vec2 p) { return glm::vec2(-p.x, p.y); });
+    generate_tangents(mirrored, indices);
+    for (const Vertex& v : mirrored)
+        CHECK(has_tangent(v, {-1, 0, 0}, -1.f));
+}
+
+// A single mirrored triangle flips the bitangent sign, wound either way
+void test_mirrored_triangle() {
+    std::vector<Vertex> vertices = {
+        {{0, 0, 0}, {0, 0, 1}, {1, 0}},
+        {{1, 0, 0}, {0, 0, 1}, {0, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {1, 1}},
+    };
+    for (auto indices : {std::vector<unsigned int>{0, 1, 2}, {0, 2, 1}}) {
+        generate_tangents(vertices, indices);
+        for (const Vertex& v : vertices)
+            CHECK(has_tangent(v, {-1, 0, 0}, -1.f));
+    }
+}
+
+// Triangles without a UV area add nothing. A vertex left with nothing gets some unit
+// tangent perpendicular to its normal rather than a zero one.
+void test_degenerate_uvs() {
+    glm::vec3 n = glm::normalize(glm::vec3(1, 2, 3));
+    std::vector<Vertex> vertices = {
+        {{0, 0, 0}, n, {0.5f, 0.5f}},
+        {{1, 0, 0}, n, {0.5f, 0.5f}},
+        {{0, 1, 0}, n, {0.5f, 0.5f}},
+    };
+    generate_tangents(vertices, std::vector<unsigned int>{0, 1, 2});
+    for (const Vertex& v : vertices) {
+        glm::vec4 t = unpack_tangent(v.tangent);
+        CHECK(std::abs(glm::length(glm::vec3(t)) - 1.f) < 1e-4f);
+        CHECK(std::abs(glm::dot(glm::vec3(t), n)) < 1e-3f);
+    }
+
+    // Sharing vertex 0 with a mapped triangle, which alone decides its tangent
+    std::vector<Vertex> shared = {
+        {{0, 0, 0}, {0, 0, 1}, {0, 0}},   {{1, 0, 0}, {0, 0, 1}, {1, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {0, 1}},   {{-1, 0, 0}, {0, 0, 1}, {0, 0}},
+        {{0, -1, 0}, {0, 0, 1}, {0, 0}},
+    };
+    generate_tangents(shared, std::vector<unsigned int>{0, 1, 2, 0, 3, 4});
+    CHECK(has_tangent(shared[0], {1, 0, 0}, 1.f));
+}
+
+// Corners are weighted by their angle, not their triangle's area or not at all. Vertex
+// 0 has a 90 degree corner whose tangent is +x and a 30 degree one whose tangent is +y.
+void test_corner_weights() {
+    const float c = std::cos(glm::radians(30.f)), s = std::sin(glm::radians(30.f));
+    std::vector<Vertex> vertices = {
+        {{0, 0, 0}, {0, 0, 1}, {0, 0}},   {{1, 0, 0}, {0, 0, 1}, {1, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {0, 1}},   {{-1, 0, 0}, {0, 0, 1}, {0, 1}},
+        {{-c, -s, 0}, {0, 0, 1}, {-s, c}},
+    };
+    generate_tangents(vertices, std::vector<unsigned int>{0, 1, 2, 0, 3, 4});
+    CHECK(has_tangent(vertices[0], {3, 1, 0}, 1.f));
+}
+
+} // namespace
+
+int main() {
+    test_round_trip();
+    test_unnormalized();
+    ThreadPool pool(4);
+    test_sphere(pool);
+    test_quad();
+    test_mirrored_triangle();
+    test_degenerate_uvs();
+    test_corner_weights();
+    return test::result();
+}
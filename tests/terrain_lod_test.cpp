@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "common/terrain_lod.h"
+#include "common/thread_pool.h"
+#include "tests/check.h"
+
+namespace {
+
+bool same_chunk(const TerrainChunk& a, const TerrainChunk& b) {
+    return a.tile == b.tile && a.morph_start == b.morph_start && a.morph_end == b.morph_end;
+}
+
+// Scrambles a tile key, for height ranges and residency that look irregular
+uint32_t hash(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x7feb352d;
+    key ^= key >> 15;
+    key *= 0x846ca68b;
+    return key ^ key >> 16;
+}
+
+struct Fixture {
+    TerrainLayout layout = TerrainLayout::for_heightmap(4097, 4097, 64, 1);
+    std::vector<HeightRange> ranges;
+    TerrainQuadtree quadtree;
+
+    Fixture() : ranges(make_ranges(layout)), quadtree(layout, ranges, 1.f, 300.f) {}
+
+    static std::vector<HeightRange> make_ranges(const TerrainLayout& layout) {
+        std::vector<HeightRange> ranges(layout.num_tiles());
+        for (uint32_t i = 0; i < ranges.size(); i++) {
+            uint16_t low = uint16_t(hash(i) % 30000);
+            ranges[i] = {low, uint16_t(low + hash(i + 1) % 30000)};
+        }
+        return ranges;
+    }
+};
+
+LodParams params_at(glm::vec3 camera, glm::vec3 target) {
+    glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.5f, 8000.f);
+    glm::mat4 view = glm::lookAt(camera, target, glm::vec3(0, 1, 0));
+    return {.camera = camera, .view_projection = projection * view};
+}
+
+// Fine tiles are resident except for a scattering, so selections stop short in places
+const auto resident = [](PageId tile) {
+    return tile.level >= 3 || hash(tile.key()) % 11 != 0;
+};
+
+// Selecting with a pool hands subtrees to other threads but must give exactly the
+// serial result, order included
+void test_parallel_matches_serial(const Fixture& fixture, ThreadPool& pool) {
+    const glm::vec3 views[][2] = {
+        {{0, 150, 0}, {500, 0, 300}},
+        {{-1800, 400, 1500}, {0, 0, 0}},
+        {{1200, 60, -1900}, {1300, 0, -1000}},
+        {{0, 3000, 0}, {0, 0, 1}},
+    };
+    for (const auto& [camera, target] : views) {
+        LodParams params = params_at(camera, target);
+        TerrainQuadtree::Selection serial = fixture.quadtree.select(params, resident);
+        TerrainQuadtree::Selection parallel = fixture.quadtree.select(params, resident, &pool);
+        CHECK(!serial.chunks.empty());
+        CHECK(std::ranges::equal(serial.chunks, parallel.chunks, same_chunk));
+        CHECK(std::ranges::equal(serial.used, parallel.used));
+        CHECK(std::ranges::equal(serial.missing, parallel.missing));
+    }
+}
+
+// Every chunk is a tile the selection went through, and missing tiles stop the split
+void test_selection(const Fixture& fixture) {
+    LodParams params = params_at({0, 150, 0}, {500, 0, 300});
+    TerrainQuadtree::Selection selection = fixture.quadtree.select(params, resident);
+    CHECK(!selection.missing.empty());
+    for (const TerrainChunk& chunk : selection.chunks) {
+        CHECK(std::ranges::contains(selection.used, chunk.tile));
+        CHECK(chunk.morph_start <= chunk.morph_end);
+    }
+    for (PageId tile : selection.missing)
+        CHECK(!resident(tile));
+    // Only the finest level is drawn right under the camera
+    auto finest = std::ranges::min(selection.chunks, {}, [](const TerrainChunk& c) {
+        return c.tile.level;
+    });
+    CHECK(finest.tile.level == 0);
+}
+
+} // namespace
+
+int main() {
+    Fixture fixture;
+    ThreadPool pool(4);
+    test_parallel_matches_serial(fixture, pool);
+    test_selection(fixture);
+    return test::result();
+}
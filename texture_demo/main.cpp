@@ -17,6 +17,7 @@
 #include "common/glutils.h"
 #include "common/shader.h"
 #include "common/texture.h"
+#include "common/vfs.h"
 
 namespace fs = std::filesystem;
 
@@ -27,12 +28,13 @@ const float ZNEAR = 0.01f;
 const float ZFAR = 100.f;
 const float FOV = glm::radians(45.f);
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
+                  int /*mods*/) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     if (width && height)
         glViewport(0, 0, width, height);
 }
@@ -41,6 +43,8 @@ int LGL_TMAIN(int argc, LGL_TCHAR* argv[]) {
     try {
         fs::path exe_path = fs::canonical(argc ? argv[0] : fs::path());
         fs::path root = exe_path.parent_path();
+        // Built by the resources_pack target; loose files are used without it
+        vfs::mount_if_exists(root / "resources.pack", root / "resources");
 
         err::check_glfw(glfwInit(), "failed to init GLFW: {}");
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);